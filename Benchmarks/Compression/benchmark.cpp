@@ -11,7 +11,7 @@ static void BM_Load_JsonToWisent(benchmark::State& state)
     const int index = state.range(0); 
     std::string path = benchmark::utilities::GetCsvPath(CsvSubDirs[index]);
 
-    SharedMemorySegments::sharedMemorySegmentsList.clear();
+    SharedMemorySegments::clearMemorySegments();
 
     for (auto _ : state) 
     {
@@ -36,7 +36,7 @@ static void BM_Load_JsonToWisent(benchmark::State& state)
 
 static void BM_LoadAndCompress_JsonToWisent(benchmark::State& state) 
 {
-    SharedMemorySegments::sharedMemorySegmentsList.clear();
+    SharedMemorySegments::clearMemorySegments();
 
     const int index = state.range(0); 
     std::string path = benchmark::utilities::GetCsvPath(CsvSubDirs[index]);
@@ -8,7 +8,7 @@
 
 static void BM_Load_Bson(benchmark::State& state)
 {
-    SharedMemorySegments::sharedMemorySegmentsList.clear();
+    SharedMemorySegments::clearMemorySegments();
 
     for (auto _ : state) 
     {    
@@ -32,7 +32,7 @@ static void BM_Load_Bson(benchmark::State& state)
 
 static void BM_Load_Json(benchmark::State& state)
 {
-    SharedMemorySegments::sharedMemorySegmentsList.clear();
+    SharedMemorySegments::clearMemorySegments();
 
     for (auto _ : state) 
     {    
@@ -55,7 +55,7 @@ static void BM_Load_Json(benchmark::State& state)
 
 static void BM_Load_JsonToWisent(benchmark::State& state) 
 {
-    SharedMemorySegments::sharedMemorySegmentsList.clear();
+    SharedMemorySegments::clearMemorySegments();
 
     for (auto _ : state) 
     {    
@@ -78,7 +78,7 @@ static void BM_Load_JsonToWisent(benchmark::State& state)
 
 static void BM_LoadAndCompress_JsonToWisent(benchmark::State& state) 
 {
-    SharedMemorySegments::sharedMemorySegmentsList.clear();
+    SharedMemorySegments::clearMemorySegments();
 
     std::unordered_map<std::string, CompressionPipeline> compressionPipelineMap =   
         benchmark::utilities::ConstructCompressionPipelineMap();
@@ -14,7 +14,7 @@ static void BM_Load_Bson(benchmark::State& state)
 
     for (auto _ : state) 
     {
-        SharedMemorySegments::sharedMemorySegmentsList.clear();
+        SharedMemorySegments::clearMemorySegments();
 
         vtune_start_task("BsonSerialize");
         benchmark::utilities::BsonSerialize(path);
@@ -42,7 +42,7 @@ static void BM_Load_Json(benchmark::State& state)
 
     for (auto _ : state) 
     {
-        SharedMemorySegments::sharedMemorySegmentsList.clear();
+        SharedMemorySegments::clearMemorySegments();
 
         vtune_start_task("JsonSerialize");
         benchmark::utilities::JsonSerialize(path);
@@ -71,7 +71,7 @@ static void BM_Load_JsonToWisent(benchmark::State& state)
 
     for (auto _ : state) 
     {
-        SharedMemorySegments::sharedMemorySegmentsList.clear();
+        SharedMemorySegments::clearMemorySegments();
 
         vtune_start_task("WisentSerialize");
         benchmark::utilities::WisentSerialize(path);
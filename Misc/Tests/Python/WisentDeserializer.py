@@ -28,6 +28,7 @@ import requests
 
 import struct
 import ctypes
+import mmap
 
 import tracemalloc
 
@@ -36,12 +37,49 @@ tracemalloc.start()
 from enum import Enum
  
 class ArgType(Enum):
+    # as WisentArgumentType in WisentHelpers.hpp
     BOOL = 0
-    LONG = 1
-    DOUBLE = 2
-    STRING = 3
-    SYMBOL = 4
-    EXPRESSION = 5
+    CHAR = 1
+    SHORT = 2
+    INT = 3
+    LONG = 4
+    FLOAT = 5
+    DOUBLE = 6
+    STRING = 7
+    SYMBOL = 8
+    EXPRESSION = 9
+    BYTE_ARRAY = 10
+
+# the numbers CompressAndLoadJson stores for the enums of Algorithms.hpp
+class PhysicalType(Enum):
+    INT64 = 0
+    DOUBLE = 1
+    BYTE_ARRAY = 2
+    BOOLEAN = 3
+
+class EncodingType(Enum):
+    PLAIN = 0
+    RLE = 1
+    BIT_PACKED = 2
+    DICTIONARY = 3
+    DELTA_BINARY_PACKED = 4
+    DELTA_LENGTH_BYTE_ARRAY = 5
+    DELTA_BYTE_ARRAY = 6
+    FRAME_OF_REFERENCE = 7
+    PATCHED_FRAME_OF_REFERENCE = 8
+    AUTO = 9
+
+class CompressionType(Enum):
+    NONE = 0
+    DELTA = 1
+    RLE = 2
+    LZ77 = 3
+    HUFFMAN = 4
+    FSE = 5
+    CUSTOM = 6
+    RLE_INT64 = 7
+    RLE_DOUBLE = 8
+    RLE_STRING = 9
     
 class Expression:
     def __init__(self, head):
@@ -60,6 +98,15 @@ class Symbol:
     def __repr__(self):
         return self.__str__()
 
+class ByteArray:
+    # page bytes in the string buffer, their length is in the page header
+    def __init__(self, offset):
+        self.offset = offset
+    def __str__(self):
+        return "<bytes at " + str(self.offset) + ">"
+    def __repr__(self):
+        return self.__str__()
+
 def argsToDictionary(expr):
     dict = {}
     for arg in expr.args:
@@ -68,8 +115,9 @@ def argsToDictionary(expr):
 
 def argsToTable(table):
     dict = {}
+    # (Table (<column> v1 v2 ...) ...)
     for column in table.args:
-        dict[column.args[0]] = column.args[1]
+        dict[column.head] = column.args
     return dict
     
 def readExpression(offset, args, argTypes, exprs, strings):
@@ -81,7 +129,10 @@ def readExpression(offset, args, argTypes, exprs, strings):
     current, peak = tracemalloc.get_traced_memory()
     print(f"Current memory usage: {current}")
     print(f"Peak memory usage: {peak}")
-    if(headStr == "Object"):
+    if(isCompressedColumn(expr)):
+        expr.args = decodeCompressedColumn(expr, strings)
+        return expr
+    elif(headStr == "Object"):
         return argsToDictionary(expr)
     elif(headStr == "List"):
         return expr.args
@@ -133,7 +184,7 @@ def readArgWithType(argType, offset, args, argTypes, exprs, strings):
         case ArgType.BOOL:
             return struct.unpack("@?", args[(offset+1)*8-1:(offset+1)*8])[0]
         case ArgType.LONG:
-            return struct.unpack("@Q", args[offset*8:(offset+1)*8])[0]
+            return struct.unpack("@q", args[offset*8:(offset+1)*8])[0]
         case ArgType.DOUBLE:
             return struct.unpack("@d", args[offset*8:(offset+1)*8])[0]
         case ArgType.STRING:
@@ -145,6 +196,138 @@ def readArgWithType(argType, offset, args, argTypes, exprs, strings):
         case ArgType.EXPRESSION:
             index = struct.unpack("@Q", args[offset*8:(offset+1)*8])[0]
             return readExpression(index, args, argTypes, exprs, strings)
+        case ArgType.BYTE_ARRAY:
+            return ByteArray(struct.unpack("@Q", args[offset*8:(offset+1)*8])[0])
+
+# compressed columns: (<column> ... (encodingType e) (compressionType c...) (pages (Page ... (pageData <bytes>)) ...))
+# int pages are decoded as decodeIntPage in Algorithms.cpp does it, compression steps are not undone here
+
+def readVarint(page, position):
+    value = 0
+    shift = 0
+    while True:
+        if(position >= len(page) or shift >= 64):
+            raise ValueError("corrupt varint")
+        byte = page[position]
+        position += 1
+        value |= (byte & 0x7F) << shift
+        if(byte & 0x80 == 0):
+            return value, position
+        shift += 7
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+def toSigned(value):
+    value &= (1 << 64) - 1
+    return value - (1 << 64) if value >= (1 << 63) else value
+
+def unpackBits(page, position, count, width):
+    # count values of width bits, least significant bit first, as BitPacking::unpack
+    byteCount = count * width // 8
+    if(len(page) - position < byteCount):
+        raise ValueError("truncated bit-packed values")
+    bits = int.from_bytes(page[position:position+byteCount], "little")
+    mask = (1 << width) - 1
+    return [(bits >> (i * width)) & mask for i in range(count)], position + byteCount
+
+def decodePlainPage(page):
+    if(len(page) % 8 != 0):
+        raise ValueError("not a page of int64 values")
+    return list(struct.unpack("@" + str(len(page) // 8) + "q", page))
+
+def decodeBitPackedPage(page):
+    # varint count, then blocks of 128 zigzag values: a width byte and the packed block
+    count, position = readVarint(page, 0)
+    values = []
+    while(len(values) < count):
+        if(position >= len(page)):
+            raise ValueError("truncated BIT_PACKED page")
+        width = page[position]
+        block, position = unpackBits(page, position + 1, 128, width)
+        values += [unzigzag(value) for value in block[:count - len(values)]]
+    if(position != len(page)):
+        raise ValueError("trailing bytes after the last BIT_PACKED block")
+    return values
+
+def decodeDeltaBinaryPackedPage(page):
+    blockSize, position = readVarint(page, 0)
+    miniblockCount, position = readVarint(page, position)
+    count, position = readVarint(page, position)
+    first, position = readVarint(page, position)
+    if(blockSize == 0 or miniblockCount == 0 or blockSize % (miniblockCount * 32) != 0):
+        raise ValueError("corrupt DELTA_BINARY_PACKED header")
+    current = unzigzag(first)
+    values = [current] if count > 0 else []
+    while(len(values) < count):
+        minDelta, position = readVarint(page, position)
+        widths = page[position:position+miniblockCount]
+        position += miniblockCount
+        for width in widths:
+            if(len(values) == count):
+                break
+            deltas, position = unpackBits(page, position, blockSize // miniblockCount, width)
+            for delta in deltas[:count - len(values)]:
+                current = toSigned(current + unzigzag(minDelta) + delta)
+                values.append(current)
+    return values
+
+def decodeFrameOfReferencePage(page, patched=False):
+    # varint count, zigzag varint reference, width byte, offsets packed in groups of 32;
+    # patched pages add a varint exception count, two width bytes, the positions and high bits
+    groups = lambda count: (count + 31) // 32 * 32
+    count, position = readVarint(page, 0)
+    reference, position = readVarint(page, position)
+    width = page[position]
+    offsets, position = unpackBits(page, position + 1, groups(count), width)
+    if(patched):
+        exceptionCount, position = readVarint(page, position)
+        positionWidth, highWidth = page[position], page[position+1]
+        positions, position = unpackBits(page, position + 2, groups(exceptionCount), positionWidth)
+        highBits, position = unpackBits(page, position, groups(exceptionCount), highWidth)
+        for i in range(exceptionCount):
+            offsets[positions[i]] |= highBits[i] << width
+    if(position != len(page)):
+        raise ValueError("trailing bytes after the FRAME_OF_REFERENCE page")
+    return [toSigned(unzigzag(reference) + offset) for offset in offsets[:count]]
+
+def decodeAutoPage(page):
+    # the page's own encoding comes first
+    encodingType = EncodingType(page[0])
+    if(encodingType == EncodingType.AUTO):
+        raise ValueError("corrupt AUTO page encoding")
+    return intPageDecoders[encodingType](page[1:])
+
+intPageDecoders = {
+    EncodingType.PLAIN: decodePlainPage,
+    EncodingType.BIT_PACKED: decodeBitPackedPage,
+    EncodingType.DELTA_BINARY_PACKED: decodeDeltaBinaryPackedPage,
+    EncodingType.FRAME_OF_REFERENCE: decodeFrameOfReferencePage,
+    EncodingType.PATCHED_FRAME_OF_REFERENCE: lambda page: decodeFrameOfReferencePage(page, patched=True),
+    EncodingType.AUTO: decodeAutoPage,
+}
+
+def isCompressedColumn(expr):
+    heads = [arg.head for arg in expr.args if isinstance(arg, Expression)]
+    return "pages" in heads and "encodingType" in heads
+
+def decodeCompressedColumn(column, strings):
+    metadata = {arg.head: arg.args for arg in column.args if isinstance(arg, Expression)}
+    physicalType = PhysicalType(metadata["physicalType"][0])
+    encodingType = EncodingType(metadata["encodingType"][0])
+    compressionTypes = [CompressionType(step).name for step in metadata["compressionType"] if step != 0]
+    if(compressionTypes or physicalType != PhysicalType.INT64 or encodingType not in intPageDecoders):
+        raise NotImplementedError("compressed column '" + column.head + "': " + physicalType.name + " pages, " 
+            + encodingType.name + " encoding, compression steps " + str(compressionTypes))
+    values = []
+    for page in metadata["pages"]:
+        header = {arg.head: arg.args[0] for arg in page.args}
+        offset = header["pageData"].offset
+        pageValues = intPageDecoders[encodingType](bytes(strings[offset:offset+header["compressedPageSize"]]))
+        if(len(pageValues) != header["numberOfValues"]):
+            raise ValueError("page of '" + column.head + "' does not hold its value count")
+        values += pageValues
+    return values
 
 def deserialize(buffer):
     argCount, exprCount = struct.unpack("@QQ", buffer[:16])
@@ -164,7 +347,39 @@ def deserialize(buffer):
     offset += exprsBufferSize
     strings = buffer[offset:]
     
-    return readArg(0, args, argTypes, exprs, strings)
+    # the loaders leave the type of the first argument unset: it always is expression 0
+    return readExpression(0, args, argTypes, exprs, strings)
+
+def deserializeFile(path):
+    # persisted Wisent file: 64-byte header, then the segment bytes (no server needed)
+    with open(path, "rb") as file:
+        buffer = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+    magic, version, headerBytes, payloadBytes = struct.unpack("@8sIIQ", buffer[:24])
+    if magic != b"WISENT\0\0" or version != 1:
+        raise ValueError("not a Wisent file (version 1): " + path)
+    return deserialize(memoryview(buffer)[headerBytes:headerBytes+payloadBytes])
+
+def readPublishedGeneration(name):
+    try:
+        directory = shared_memory.SharedMemory(name + ".generation")
+        generation = struct.unpack("@Q", directory.buf[:8])[0]
+        directory.close()
+    except FileNotFoundError:
+        generation = 0
+    return generation
+
+def openPublished(name, attempts=3):
+    # a built dataset lives in "<name>.g<generation>", published via "<name>.generation".
+    # The server retires the previous generation without knowing about this process: 
+    # once mapped it stays valid, but it can be gone between reading the directory 
+    # and opening it, then the directory is read again
+    for attempt in range(attempts):
+        generation = readPublishedGeneration(name)
+        try:
+            return shared_memory.SharedMemory(name if generation == 0 else name + ".g" + str(generation))
+        except FileNotFoundError:
+            if attempt == attempts - 1 or readPublishedGeneration(name) == generation:
+                raise
 
 def main():
     # request server to load data
@@ -177,7 +392,7 @@ def main():
     
     # deserialize the data
     remove_shm_from_resource_tracker()
-    datapackage = shared_memory.SharedMemory("datapackage")
+    datapackage = openPublished("datapackage")
     try:
         expr = deserialize(datapackage.buf)
         print(expr)
@@ -8,6 +8,15 @@ int main(int argc, char **argv) {
         ":TestCompression.*"
         ":BsonSerializerTest.*"
         ":WisentSerializerTest.*"
-        ":WisentCompressorTest.*"; 
+        ":WisentCompressorTest.*"
+        ":DatasetCacheTest.*"
+        ":MemfdMemorySegmentTest.*"
+        ":WorkerPoolTest.*"
+        ":SingleFlightTest.*"
+        ":LoadJobsTest.*"
+        ":MetricsTest.*"
+        ":SegmentStreamTest.*"
+        ":TableQueryTest.*"
+        ":PreloaderTest.*"; 
     return RUN_ALL_TESTS();
 }
\ No newline at end of file
@@ -35,7 +35,7 @@ protected:
 
 TEST_F(BsonSerializerTest, LoadAsBson) 
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName).get();
 
     void* result = bson::serializer::loadAsBson(
         MockFileName, 
@@ -49,7 +49,7 @@ TEST_F(BsonSerializerTest, LoadAsBson)
 
 TEST_F(BsonSerializerTest, LoadAsJson) 
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName).get();
 
     void* result = bson::serializer::loadAsJson(
         MockFileName, 
@@ -63,7 +63,7 @@ TEST_F(BsonSerializerTest, LoadAsJson)
 
 TEST_F(BsonSerializerTest, Unload) 
 {   
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName); 
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName).get(); 
     sharedMemory->load();
     ASSERT_TRUE(sharedMemory->isLoaded());
     
@@ -73,11 +73,11 @@ TEST_F(BsonSerializerTest, Unload)
 
 TEST_F(BsonSerializerTest, Free) 
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName); 
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName).get(); 
     sharedMemory->load();
     ASSERT_TRUE(sharedMemory->isLoaded());
     
     bson::serializer::free(MockSharedMemoryName);
     // ASSERT_EQ(SharedMemorySegments::getCurrentSharedMemory(), nullptr);
-    ASSERT_EQ(SharedMemorySegments::getSharedMemorySegments().size(), 0);
+    ASSERT_EQ(SharedMemorySegments::getMemorySegmentCount(), 0);
 }
\ No newline at end of file
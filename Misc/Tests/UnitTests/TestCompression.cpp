@@ -3,6 +3,14 @@
 #include "../../../Src/Helpers/CompressionHelpers/LZ77.hpp"
 #include "../../../Src/Helpers/CompressionHelpers/Huffman.hpp"
 #include "../../../Src/Helpers/CompressionHelpers/FSE.hpp"
+#include "../../../Src/Helpers/CompressionHelpers/RLE.hpp"
+#include "../../../Src/Helpers/CompressionHelpers/Delta.hpp"
+#include "../../../Src/Helpers/CompressionHelpers/BitPacking.hpp"
+#include "../../../Src/Helpers/CompressionHelpers/Algorithms.hpp"
+#include "../../../Src/WisentCompressor/CompressionPipeline.hpp"
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include "../../../Src/Helpers/Result.hpp"
 
 const int MockLZ77WindowSize = 64;
@@ -70,6 +78,69 @@ TEST(TestCompression, LZ77_Decompression_ReturnsDecodedData)
     // EXPECT_EQ(MockInputString, decompressedString);
 }
 
+TEST(TestCompression, LZ77_LargeInput_RoundTrips)
+{
+    // repeats further apart than a small window, and runs longer than a match
+    std::vector<uint8_t> input(MockLargeTextInput.begin(), MockLargeTextInput.begin() + 3000);
+    input.insert(input.end(), MockLargeTextInput.begin(), MockLargeTextInput.begin() + 3000);
+    input.insert(input.end(), 1000, 'x');
+    // patterns shorter than a copy chunk
+    for (std::string pattern : {"abc", "0123456789", "0123456789abcdefghij"}) 
+    {
+        for (int i = 0; i < 50; i++) 
+        {
+            input.insert(input.end(), pattern.begin(), pattern.end());
+        }
+    }
+    for (int64_t windowSize : {64, 4096, 1 << 20}) 
+    {
+        Result<std::vector<uint8_t>> compressed = wisent::algorithms::LZ77::compress(input, windowSize, 255);
+        ASSERT_TRUE(compressed.success());
+        Result<std::vector<uint8_t>> decompressed = wisent::algorithms::LZ77::decompress(compressed.getValue());
+        ASSERT_TRUE(decompressed.success());
+        EXPECT_EQ(input, decompressed.getValue());
+        if (windowSize >= 4096) 
+        {
+            // the random prefix stays (mostly) literals, the rest are a few matches
+            EXPECT_LT(compressed.getValue().size(), 3000 + 250);
+        }
+    }
+}
+
+TEST(TestCompression, LZ77_Version1Stream_StillDecodes)
+{
+    // literal 'a', literal 'b', match at offset 2 of length 4
+    const std::vector<uint8_t> version1 = {1, 'a', 1, 'b', 0, 0, 2, 4};
+    Result<std::vector<uint8_t>> decompressed = wisent::algorithms::LZ77::decompress(version1);
+    ASSERT_TRUE(decompressed.success());
+    EXPECT_EQ(decompressed.getValue(), std::vector<uint8_t>({'a', 'b', 'a', 'b', 'a', 'b'}));
+
+    Result<std::vector<uint8_t>> compressed = wisent::algorithms::LZ77::compress(MockInput);
+    ASSERT_TRUE(compressed.success());
+    std::vector<uint8_t> truncated = compressed.getValue();
+    EXPECT_EQ(truncated[0], wisent::algorithms::LZ77::FORMAT_VERSION);
+    truncated.pop_back();
+    EXPECT_FALSE(wisent::algorithms::LZ77::decompress(truncated).success());
+}
+
+TEST(TestCompression, LZ77_CorruptSizes_ReturnError)
+{
+    // declared size of 2^64 - 1, which wrapped when the copy slack was added
+    std::vector<uint8_t> hugeSize = {wisent::algorithms::LZ77::FORMAT_VERSION};
+    hugeSize.insert(hugeSize.end(), 9, 0xff);
+    hugeSize.insert(hugeSize.end(), {0x01, 0x40});
+    hugeSize.insert(hugeSize.end(), 40, 'A');
+    hugeSize.push_back(0x40);
+    ASSERT_EQ(hugeSize.size(), 53);
+    EXPECT_FALSE(wisent::algorithms::LZ77::decompress(hugeSize).success());
+
+    // 4 bytes declared, one literal and a match length that wraps with the minimum added
+    std::vector<uint8_t> wrappingMatch = {wisent::algorithms::LZ77::FORMAT_VERSION, 4, 1, 'a', 1};
+    wrappingMatch.insert(wrappingMatch.end(), 9, 0xff);
+    wrappingMatch.insert(wrappingMatch.end(), {0x01, 1});
+    EXPECT_FALSE(wisent::algorithms::LZ77::decompress(wrappingMatch).success());
+}
+
 TEST(TestCompression, Huffman_Compression_ReturnsSmallerSize)
 {
     Result<std::vector<uint8_t>> compressed = wisent::algorithms::Huffman::compress(MockInput);
@@ -92,6 +163,77 @@ TEST(TestCompression, Huffman_Decompression_ReturnsDecodedData)
     // EXPECT_EQ(MockInputString, decompressedString);
 }
 
+TEST(TestCompression, Huffman_SizeBeyondStream_ReturnsError)
+{
+    // two 1-bit codes, one byte of codes, but 2^64 - 1 bytes declared
+    std::vector<uint8_t> hugeSize = {wisent::algorithms::Huffman::FORMAT_VERSION};
+    hugeSize.insert(hugeSize.end(), 9, 0xff);
+    hugeSize.insert(hugeSize.end(), {0x01, 2, 0x11, 0x55});
+    EXPECT_FALSE(wisent::algorithms::Huffman::decompress(hugeSize).success());
+
+    hugeSize[1] = 8;    // what a byte of 1-bit codes holds
+    hugeSize.erase(hugeSize.begin() + 2, hugeSize.begin() + 11);
+    Result<std::vector<uint8_t>> decompressed = wisent::algorithms::Huffman::decompress(hugeSize);
+    ASSERT_TRUE(decompressed.success());
+    EXPECT_EQ(decompressed.getValue().size(), 8);
+}
+
+TEST(TestCompression, Huffman_SkewedInput_StaysWithinCodeLengthLimit)
+{
+    // Fibonacci frequencies would need codes as long as the alphabet
+    std::vector<uint8_t> input;
+    uint64_t previous = 1;
+    uint64_t current = 1;
+    for (uint8_t symbol = 0; symbol < 20; symbol++) 
+    {
+        input.insert(input.end(), previous, symbol);
+        uint64_t next = previous + current;
+        previous = current;
+        current = next;
+    }
+    input.push_back(255);
+    Result<std::vector<uint8_t>> compressed = wisent::algorithms::Huffman::compress(input, false);
+    ASSERT_TRUE(compressed.success());
+    std::vector<uint8_t> encoded = compressed.getValue();
+    EXPECT_EQ(encoded[0], wisent::algorithms::Huffman::FORMAT_VERSION);
+    EXPECT_LT(encoded.size(), input.size() / 2);
+
+    Result<std::vector<uint8_t>> decompressed = wisent::algorithms::Huffman::decompress(encoded);
+    ASSERT_TRUE(decompressed.success());
+    EXPECT_EQ(input, decompressed.getValue());
+
+    encoded.resize(encoded.size() / 2);
+    EXPECT_FALSE(wisent::algorithms::Huffman::decompress(encoded).success());
+}
+
+TEST(TestCompression, Huffman_FourStreams_RoundTrip)
+{
+    // sizes that do not split evenly, so the last stream is shorter
+    for (size_t size : {size_t{1024}, size_t{4097}, size_t{100003}}) 
+    {
+        std::vector<uint8_t> input(size);
+        uint32_t state = 7;
+        for (uint8_t& byte : input) 
+        {
+            state = state * 1103515245 + 12345;
+            byte = "etaoin shrdlu"[(state >> 16) % 13];
+        }
+        Result<std::vector<uint8_t>> interleaved = wisent::algorithms::Huffman::compress(input);
+        Result<std::vector<uint8_t>> single = wisent::algorithms::Huffman::compress(input, false);
+        ASSERT_TRUE(interleaved.success() && single.success());
+        std::vector<uint8_t> encoded = interleaved.getValue();
+        EXPECT_EQ(encoded[0], wisent::algorithms::Huffman::FORMAT_VERSION_FOUR_STREAMS);
+        EXPECT_LE(encoded.size(), single.getValue().size() + 16);
+
+        Result<std::vector<uint8_t>> decompressed = wisent::algorithms::Huffman::decompress(encoded);
+        ASSERT_TRUE(decompressed.success()) << decompressed.getError();
+        EXPECT_EQ(input, decompressed.getValue());
+
+        encoded.pop_back();
+        EXPECT_FALSE(wisent::algorithms::Huffman::decompress(encoded).success());
+    }
+}
+
 TEST(TestCompression, FSE_Compression_ReturnsSmallerSize) 
 {
     Result<std::vector<uint8_t>> compressed = wisent::algorithms::FSE::compress(MockInput);
@@ -142,3 +284,404 @@ TEST(TestCompression, FSE_Decompression_ReturnsDecodedData_RandomPopularSymbolsI
     EXPECT_EQ(MockLargeInputSize, decompressed.getValue().size());
     EXPECT_EQ(MockLargeSymbolInput, decompressed.getValue());
 }
+
+TEST(TestCompression, FSE_PagesOfAColumn_RepeatTheTable)
+{
+    std::vector<std::vector<uint8_t>> pages = {
+        genRandomTextInput(MockLargeInputSize), 
+        genRandomTextInput(MockLargeInputSize), 
+        genRandomPopularSymbolsInput(MockLargeInputSize),   // symbols the table lacks
+        std::vector<uint8_t>(100, 'x'), 
+        std::vector<uint8_t>()
+    };
+    wisent::algorithms::FSE::RepeatState compressionState;
+    std::vector<std::vector<uint8_t>> compressedPages;
+    for (const std::vector<uint8_t>& page : pages) 
+    {
+        Result<std::vector<uint8_t>> compressed = wisent::algorithms::FSE::compress(page, compressionState);
+        ASSERT_TRUE(compressed.success());
+        compressedPages.push_back(compressed.getValue());
+        EXPECT_EQ(compressedPages.back()[0], wisent::algorithms::FSE::FORMAT_VERSION);
+    }
+    // the second page reuses the table of the first, without a header of its own
+    EXPECT_LT(compressedPages[1].size() + 50, compressedPages[0].size());
+    EXPECT_GT(compressedPages[2].size(), compressedPages[1].size());
+
+    wisent::algorithms::FSE::RepeatState decompressionState;
+    for (size_t i = 0; i < pages.size(); i++) 
+    {
+        Result<std::vector<uint8_t>> decompressed = wisent::algorithms::FSE::decompress(compressedPages[i], decompressionState);
+        ASSERT_TRUE(decompressed.success()) << decompressed.getError();
+        EXPECT_EQ(pages[i], decompressed.getValue());
+    }
+    EXPECT_FALSE(wisent::algorithms::FSE::decompress(compressedPages[1]).success());
+
+    std::vector<uint8_t> truncated = compressedPages[0];
+    truncated.pop_back();
+    EXPECT_FALSE(wisent::algorithms::FSE::decompress(truncated).success());
+}
+
+TEST(TestCompression, FSE_Version1Stream_StillDecodes)
+{
+    const std::string text = "abracadabra abracadabra abracadabra";
+    const std::vector<uint8_t> version1 = {
+        0x00, 0x72, 0x20, 0x02, 0x61, 0x0e, 0x62, 0x05, 0x63, 0x03, 0x64, 0x03, 0x72, 
+        0x05, 0x29, 0x28, 0xe6, 0x04, 0x84, 0xaa, 0x7f, 0x02, 0x10, 0xc3, 0x19
+    };
+    Result<std::vector<uint8_t>> decompressed = wisent::algorithms::FSE::decompress(version1);
+    ASSERT_TRUE(decompressed.success());
+    EXPECT_EQ(std::vector<uint8_t>(text.begin(), text.end()), decompressed.getValue());
+}
+
+TEST(TestCompression, FSE_CorruptVersion1Header_ReturnsError)
+{
+    const std::vector<uint8_t> version1 = {
+        0x00, 0x72, 0x20, 0x02, 0x61, 0x0e, 0x62, 0x05, 0x63, 0x03, 0x64, 0x03, 0x72,
+        0x05, 0x29, 0x28, 0xe6, 0x04, 0x84, 0xaa, 0x7f, 0x02, 0x10, 0xc3, 0x19
+    };
+    // table cut short
+    std::vector<uint8_t> truncated(version1.begin(), version1.begin() + 9);
+    EXPECT_TRUE(wisent::algorithms::FSE::decompress(truncated).hasError());
+
+    // symbols past maxSymbolValue
+    std::vector<uint8_t> smallMax = version1;
+    smallMax[1] = 0x20;
+    EXPECT_TRUE(wisent::algorithms::FSE::decompress(smallMax).hasError());
+
+    // counts not adding up to the table size
+    std::vector<uint8_t> badCount = version1;
+    badCount[5] = 0x0f;
+    EXPECT_TRUE(wisent::algorithms::FSE::decompress(badCount).hasError());
+
+    // one symbol filling the table
+    std::vector<uint8_t> singleSymbol = {0x00, 0x61, 0x61, 0x20, 0x01};
+    EXPECT_TRUE(wisent::algorithms::FSE::decompress(singleSymbol).hasError());
+}
+
+TEST(TestCompression, FSE_HugeDecompressedSize_ReturnsError)
+{
+    // a Single page of 2^40 bytes 'a'
+    std::vector<uint8_t> single = {wisent::algorithms::FSE::FORMAT_VERSION, 0x02, 0x80, 0x80, 0x80, 0x80, 0x80, 0x20, 0x61};
+    EXPECT_TRUE(wisent::algorithms::FSE::decompress(single).hasError());
+
+    std::vector<uint8_t> page(1000, 'x');
+    Result<std::vector<uint8_t>> compressed = wisent::algorithms::FSE::compress(page);
+    ASSERT_TRUE(compressed.success());
+    Result<std::vector<uint8_t>> decompressed = wisent::algorithms::FSE::decompress(compressed.getValue());
+    ASSERT_TRUE(decompressed.success()) << decompressed.getError();
+    EXPECT_EQ(page, decompressed.getValue());
+}
+
+template <typename T>
+static std::vector<uint8_t> toPage(const std::vector<T>& values)
+{
+    std::vector<uint8_t> page(values.size() * sizeof(T));
+    memcpy(page.data(), values.data(), page.size());
+    return page;
+}
+
+TEST(TestCompression, TypedRLE_ConstantAndSortedPages_RoundTrip)
+{
+    std::vector<int64_t> values(100000, 42);
+    std::vector<uint8_t> constantPage = toPage(values);
+    Result<std::vector<uint8_t>> compressed = wisent::algorithms::RLEInt64::compress(constantPage);
+    ASSERT_TRUE(compressed.success());
+    EXPECT_LT(compressed.getValue().size(), 10u);
+    Result<std::vector<uint8_t>> decompressed = wisent::algorithms::RLEInt64::decompress(compressed.getValue());
+    ASSERT_TRUE(decompressed.success());
+    EXPECT_EQ(constantPage, decompressed.getValue());
+
+    // sorted, low cardinality, with negative values
+    for (size_t i = 0; i < values.size(); i++) 
+    {
+        values[i] = static_cast<int64_t>(i / 1000) - 50;
+    }
+    std::vector<uint8_t> sortedPage = toPage(values);
+    compressed = wisent::algorithms::RLEInt64::compress(sortedPage);
+    ASSERT_TRUE(compressed.success());
+    EXPECT_LT(compressed.getValue().size(), 500u);
+    decompressed = wisent::algorithms::RLEInt64::decompress(compressed.getValue());
+    ASSERT_TRUE(decompressed.success());
+    EXPECT_EQ(sortedPage, decompressed.getValue());
+
+    std::vector<double> doubles = {-0.0, 0.0, 0.0, std::nan("1"), std::nan("1"), 2.5};
+    std::vector<uint8_t> doublePage = toPage(doubles);
+    compressed = wisent::algorithms::RLEDouble::compress(doublePage);
+    ASSERT_TRUE(compressed.success());
+    decompressed = wisent::algorithms::RLEDouble::decompress(compressed.getValue());
+    ASSERT_TRUE(decompressed.success());
+    EXPECT_EQ(doublePage, decompressed.getValue());
+
+    EXPECT_FALSE(wisent::algorithms::RLEInt64::compress(std::vector<uint8_t>(7)).success());
+    std::vector<uint8_t> truncated = compressed.getValue();
+    truncated.pop_back();
+    EXPECT_FALSE(wisent::algorithms::RLEDouble::decompress(truncated).success());
+}
+
+TEST(TestCompression, TypedRLE_LowCardinalityStrings_UseDictionaryCodes)
+{
+    // a string page, as encodeStringColumn lays it out
+    std::vector<uint8_t> page;
+    const std::vector<std::string> flags = {"A", "N", "R", "N"};
+    for (int i = 0; i < 40000; i++) 
+    {
+        const std::string& value = flags[(i / 100) % flags.size()];
+        uint32_t length = value.size();
+        page.insert(page.end(), reinterpret_cast<uint8_t*>(&length), reinterpret_cast<uint8_t*>(&length) + 4);
+        page.insert(page.end(), value.begin(), value.end());
+    }
+    Result<std::vector<uint8_t>> compressed = wisent::algorithms::RLEString::compress(page);
+    ASSERT_TRUE(compressed.success());
+    EXPECT_LT(compressed.getValue().size(), 1000u);
+    Result<std::vector<uint8_t>> decompressed = wisent::algorithms::RLEString::decompress(compressed.getValue());
+    ASSERT_TRUE(decompressed.success());
+    EXPECT_EQ(page, decompressed.getValue());
+
+    page.pop_back();
+    EXPECT_FALSE(wisent::algorithms::RLEString::compress(page).success());
+}
+
+TEST(TestCompression, TypedRLE_CountsBeyondRuns_ReturnError)
+{
+    // 2^40 values declared, one run of a single zero
+    const std::vector<uint8_t> hugeCount = {0x80, 0x80, 0x80, 0x80, 0x80, 0x20, 0x01, 0x00};
+    EXPECT_TRUE(wisent::algorithms::RLEInt64::decompress(hugeCount).hasError());
+    // 2^24 values declared, within the size limit, but still one run
+    const std::vector<uint8_t> shortRuns = {0x80, 0x80, 0x80, 0x08, 0x01, 0x00};
+    EXPECT_TRUE(wisent::algorithms::RLEInt64::decompress(shortRuns).hasError());
+
+    std::vector<uint8_t> doubleRuns = {0x80, 0x80, 0x80, 0x08, 0x01};
+    doubleRuns.resize(doubleRuns.size() + sizeof(double), 0);
+    EXPECT_TRUE(wisent::algorithms::RLEDouble::decompress(doubleRuns).hasError());
+
+    // a run of 2^40 copies of "a": consistent, but far past the size limit
+    const std::vector<uint8_t> hugeRun = {
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x20, 0x01, 0x01, 'a',
+        0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x20
+    };
+    EXPECT_TRUE(wisent::algorithms::RLEString::decompress(hugeRun).hasError());
+}
+
+TEST(TestCompression, DeltaBinaryPacked_KeyAndDateColumns_PackTightly)
+{
+    // an order key with gaps and a date column of a few thousand days
+    std::vector<int64_t> orderKeys;
+    std::vector<int64_t> shipDates;
+    for (int64_t i = 0; i < 300000; i++) 
+    {
+        orderKeys.push_back(i * 4 + (i % 7 == 0 ? 3 : 1));
+        shipDates.push_back(8000 + (i * 7919) % 2500);
+    }
+
+    for (const std::vector<int64_t>* column : {&orderKeys, &shipDates}) 
+    {
+        wisent::algorithms::ColumnMetaData metaData;
+        std::vector<std::vector<uint8_t>> pages = wisent::algorithms::encodeIntColumn(
+            *column, metaData, wisent::algorithms::EncodingType::DELTA_BINARY_PACKED
+        );
+        ASSERT_EQ(metaData.encodingType, wisent::algorithms::EncodingType::DELTA_BINARY_PACKED);
+        ASSERT_EQ(pages.size(), 3u);
+        EXPECT_LT(metaData.totalUncompressedSize * 4, column->size() * sizeof(int64_t));
+
+        std::vector<int64_t> decoded;
+        for (const std::vector<uint8_t>& page : pages) 
+        {
+            Result<std::vector<int64_t>> values = wisent::algorithms::decodeIntPage(page, metaData.encodingType);
+            ASSERT_TRUE(values.success()) << values.getError();
+            decoded.insert(decoded.end(), values.value->begin(), values.value->end());
+        }
+        EXPECT_EQ(*column, decoded);
+    }
+}
+
+TEST(TestCompression, DeltaBinaryPacked_ExtremeValues_RoundTrip)
+{
+    const int64_t minimum = std::numeric_limits<int64_t>::min();
+    const int64_t maximum = std::numeric_limits<int64_t>::max();
+    std::vector<int64_t> values = {maximum, minimum, 0, -1, maximum, 5, minimum, minimum};
+    for (int64_t i = 0; i < 200; i++) 
+    {
+        values.push_back(i % 2 == 0 ? i * 1000003 : -i);
+    }
+
+    for (size_t count : {size_t{0}, size_t{1}, size_t{2}, size_t{33}, size_t{129}, values.size()}) 
+    {
+        std::vector<int64_t> prefix(values.begin(), values.begin() + count);
+        std::vector<uint8_t> encoded = wisent::algorithms::DeltaBinaryPacked::encode(prefix.data(), count);
+        Result<std::vector<int64_t>> decoded = wisent::algorithms::DeltaBinaryPacked::decode(encoded);
+        ASSERT_TRUE(decoded.success()) << decoded.getError();
+        EXPECT_EQ(prefix, decoded.getValue());
+
+        if (count > 1) 
+        {
+            encoded.pop_back();
+            EXPECT_FALSE(wisent::algorithms::DeltaBinaryPacked::decode(encoded).success());
+        }
+    }
+}
+
+TEST(TestCompression, DeltaBinaryPacked_HugeHeaderCounts_ReturnError)
+{
+    // block size 2^40, one miniblock, 2^37 values, one block of width 0
+    std::vector<uint8_t> page = {0x80, 0x80, 0x80, 0x80, 0x80, 0x20, 0x01, 0x80, 0x80, 0x80, 0x80, 0x80, 0x04, 0x00, 0x00, 0x00};
+    EXPECT_FALSE(wisent::algorithms::DeltaBinaryPacked::decode(page).success());
+
+    // the block layout encode() writes, with 2^37 values
+    page = {0x80, 0x01, 0x04, 0x80, 0x80, 0x80, 0x80, 0x80, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    EXPECT_FALSE(wisent::algorithms::DeltaBinaryPacked::decode(page).success());
+    DecompressionPipeline pipeline({}, {}, wisent::algorithms::EncodingType::DELTA_BINARY_PACKED);
+    EXPECT_FALSE(pipeline.decompressIntPage(page).success());
+}
+
+TEST(TestCompression, BitPacking_EveryWidth_RoundTrips)
+{
+    const size_t count = 4 * wisent::algorithms::BitPacking::GROUP_SIZE;
+    std::vector<uint64_t> values(count);
+    std::vector<uint64_t> unpacked(count);
+    for (uint8_t width = 0; width <= 64; width++) 
+    {
+        const uint64_t mask = width == 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+        for (size_t i = 0; i < count; i++) 
+        {
+            values[i] = (static_cast<uint64_t>(rand()) << 40 ^ static_cast<uint64_t>(rand()) << 20 ^ rand()) & mask;
+        }
+        values[count - 1] = mask;
+        std::vector<uint8_t> packed(
+            wisent::algorithms::BitPacking::packedSize(count, width) + wisent::algorithms::BitPacking::READ_PADDING
+        );
+        wisent::algorithms::BitPacking::pack(values.data(), count, width, packed.data());
+        wisent::algorithms::BitPacking::unpack(packed.data(), count, width, unpacked.data());
+        ASSERT_EQ(values, unpacked) << "width " << static_cast<int>(width);
+    }
+}
+
+TEST(TestCompression, BitPacked_IntColumn_RoundTrips)
+{
+    std::vector<int64_t> column;
+    for (int64_t i = 0; i < 200000; i++) 
+    {
+        column.push_back(i % 1000 - 500);
+    }
+    column[12345] = std::numeric_limits<int64_t>::min();
+
+    wisent::algorithms::ColumnMetaData metaData;
+    std::vector<std::vector<uint8_t>> pages = wisent::algorithms::encodeIntColumn(
+        column, metaData, wisent::algorithms::EncodingType::BIT_PACKED
+    );
+    ASSERT_EQ(metaData.encodingType, wisent::algorithms::EncodingType::BIT_PACKED);
+    // 10 bits per value, except for the block holding the outlier
+    EXPECT_LT(metaData.totalUncompressedSize * 5, column.size() * sizeof(int64_t));
+
+    std::vector<int64_t> decoded;
+    for (const std::vector<uint8_t>& page : pages) 
+    {
+        Result<std::vector<int64_t>> values = wisent::algorithms::decodeIntPage(page, metaData.encodingType);
+        ASSERT_TRUE(values.success()) << values.getError();
+        decoded.insert(decoded.end(), values.value->begin(), values.value->end());
+    }
+    EXPECT_EQ(column, decoded);
+
+    std::vector<uint8_t> truncated = pages.back();
+    truncated.pop_back();
+    EXPECT_FALSE(wisent::algorithms::BitPacking::decode(truncated).success());
+}
+
+TEST(TestCompression, BitPacking_HugeCount_ReturnsError)
+{
+    // 2^28 values in 2^21 blocks of width 0: 2 MiB claiming 2 GiB
+    std::vector<uint8_t> page = {0x80, 0x80, 0x80, 0x80, 0x01};
+    page.resize(page.size() + (uint64_t{1} << 28) / wisent::algorithms::BitPacking::BLOCK_SIZE, 0);
+    Result<std::vector<int64_t>> values = wisent::algorithms::BitPacking::decode(page);
+    ASSERT_FALSE(values.success());
+    EXPECT_NE(values.getError().find("exceeds limit"), std::string::npos);
+}
+
+TEST(TestCompression, FrameOfReference_PricesWithOutliers_PatchTheOutliers)
+{
+    // prices in cents, with one in a thousand far out of range
+    std::vector<int64_t> prices;
+    for (int64_t i = 0; i < 150000; i++) 
+    {
+        prices.push_back(i % 1000 == 999 ? 1000000000 + i : 90000 + (i * 7919) % 10000);
+    }
+
+    size_t encodedSizes[2];
+    const wisent::algorithms::EncodingType encodings[2] = {
+        wisent::algorithms::EncodingType::FRAME_OF_REFERENCE,
+        wisent::algorithms::EncodingType::PATCHED_FRAME_OF_REFERENCE
+    };
+    for (int e = 0; e < 2; e++) 
+    {
+        wisent::algorithms::ColumnMetaData metaData;
+        std::vector<std::vector<uint8_t>> pages = wisent::algorithms::encodeIntColumn(prices, metaData, encodings[e]);
+        ASSERT_EQ(metaData.encodingType, encodings[e]);
+        encodedSizes[e] = metaData.totalUncompressedSize;
+
+        std::vector<int64_t> decoded;
+        for (const std::vector<uint8_t>& page : pages) 
+        {
+            Result<std::vector<int64_t>> values = wisent::algorithms::decodeIntPage(page, encodings[e]);
+            ASSERT_TRUE(values.success()) << values.getError();
+            decoded.insert(decoded.end(), values.value->begin(), values.value->end());
+        }
+        EXPECT_EQ(prices, decoded);
+
+        std::vector<uint8_t> truncated = pages.front();
+        truncated.pop_back();
+        EXPECT_FALSE(wisent::algorithms::decodeIntPage(truncated, encodings[e]).success());
+    }
+    // 30 bits per value for the range, 14 once the outliers are patched
+    EXPECT_LT(encodedSizes[0] * 2, prices.size() * sizeof(int64_t));
+    EXPECT_LT(encodedSizes[1] * 2, encodedSizes[0]);
+
+    std::vector<int64_t> constant(1000, -7);
+    wisent::algorithms::ColumnMetaData metaData;
+    std::vector<std::vector<uint8_t>> pages = wisent::algorithms::encodeIntColumn(
+        constant, metaData, wisent::algorithms::EncodingType::PATCHED_FRAME_OF_REFERENCE
+    );
+    Result<std::vector<int64_t>> values = wisent::algorithms::decodeIntPage(pages[0], metaData.encodingType);
+    ASSERT_TRUE(values.success()) << values.getError();
+    EXPECT_EQ(constant, values.getValue());
+}
+
+TEST(TestCompression, AutoEncoding_PicksAnEncodingPerPage)
+{
+    // a page each of sorted keys, of small values in no order, and of prices with outliers
+    const size_t pageValues = wisent::algorithms::DEFAULT_PAGE_SIZE / sizeof(int64_t);
+    std::vector<int64_t> column;
+    for (size_t i = 0; i < pageValues; i++) 
+    {
+        column.push_back(-5000000 + static_cast<int64_t>(i) * 3);
+    }
+    for (size_t i = 0; i < pageValues; i++) 
+    {
+        column.push_back(static_cast<int64_t>(i * 7919 % 1000));
+    }
+    for (size_t i = 0; i < pageValues; i++) 
+    {
+        column.push_back(i % 1000 == 999 ? 1000000000 : 90000 + static_cast<int64_t>(i * 7919 % 10000));
+    }
+
+    wisent::algorithms::ColumnMetaData metaData;
+    std::vector<std::vector<uint8_t>> pages = wisent::algorithms::encodeIntColumn(
+        column, metaData, wisent::algorithms::EncodingType::AUTO
+    );
+    ASSERT_EQ(metaData.encodingType, wisent::algorithms::EncodingType::AUTO);
+    ASSERT_EQ(pages.size(), 3u);
+    EXPECT_EQ(pages[0][0], static_cast<uint8_t>(wisent::algorithms::EncodingType::DELTA_BINARY_PACKED));
+    EXPECT_EQ(pages[1][0], static_cast<uint8_t>(wisent::algorithms::EncodingType::FRAME_OF_REFERENCE));
+    EXPECT_EQ(pages[2][0], static_cast<uint8_t>(wisent::algorithms::EncodingType::PATCHED_FRAME_OF_REFERENCE));
+
+    std::vector<int64_t> decoded;
+    for (const std::vector<uint8_t>& page : pages) 
+    {
+        Result<std::vector<int64_t>> values = wisent::algorithms::decodeIntPage(page, metaData.encodingType);
+        ASSERT_TRUE(values.success()) << values.getError();
+        decoded.insert(decoded.end(), values.value->begin(), values.value->end());
+    }
+    EXPECT_EQ(column, decoded);
+
+    std::vector<uint8_t> nested = pages[0];
+    nested[0] = static_cast<uint8_t>(wisent::algorithms::EncodingType::AUTO);
+    EXPECT_FALSE(wisent::algorithms::decodeIntPage(nested, metaData.encodingType).success());
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/ServerHelpers/DatasetCache.hpp"
+#include "../../../Src/WisentSerializer/WisentSerializer.hpp"
+#include "../../../Src/Helpers/ISharedMemorySegment.hpp"
+#include "helpers/unitTestHelpers.hpp"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class DatasetCacheTest : public ::testing::Test
+{
+  protected:
+    const std::string MockFirstName = "MockFirstDataset";
+    const std::string MockSecondName = "MockSecondDataset";
+    const std::string MockCsvPrefix = "";
+    const std::string MockFileName = "MockCacheFileName.json";
+    const std::string MockFileContent = R"({"Name": "string", "Values": [1, 2, 3, 4, 5, 6, 7, 8]})";
+
+    size_t datasetBytes = 0;
+
+    void SetUp() override
+    {
+        createTempFile(MockFileName, MockFileContent);
+        load(MockFirstName);
+        datasetBytes = SharedMemorySegments::findMemorySegment(MockFirstName)->getSize();
+    }
+
+    void TearDown() override
+    {
+        SharedMemorySegments::clearMemorySegments();
+        std::remove(MockFileName.c_str());
+    }
+
+    void load(std::string const &name)
+    {
+        Result<WisentRootExpression*> result = wisent::serializer::load(
+            MockFileName,
+            name,
+            MockCsvPrefix
+        );
+        ASSERT_TRUE(result.success());
+    }
+};
+
+TEST_F(DatasetCacheTest, Admit_WithinBudget_NothingEvicted)
+{
+    DatasetCache datasetCache(2 * datasetBytes, "");
+    load(MockSecondName);
+
+    ASSERT_TRUE(datasetCache.admit(MockFirstName).empty());
+    ASSERT_TRUE(datasetCache.admit(MockSecondName).empty());
+    ASSERT_EQ(datasetCache.getLoadedBytes(), 2 * datasetBytes);
+}
+
+TEST_F(DatasetCacheTest, Admit_OverBudget_LeastRecentlyUsedEvicted)
+{
+    DatasetCache datasetCache(datasetBytes, "");
+    datasetCache.admit(MockFirstName);
+    load(MockSecondName);
+
+    std::vector<std::string> evicted = datasetCache.admit(MockSecondName);
+    ASSERT_EQ(evicted, std::vector<std::string>{MockFirstName});
+    ASSERT_FALSE(SharedMemorySegments::findMemorySegment(MockFirstName));
+    ASSERT_EQ(datasetCache.getLoadedBytes(), datasetBytes);
+
+    // transparently rebuilt on the next access
+    load(MockFirstName);
+    evicted = datasetCache.admit(MockFirstName);
+    ASSERT_EQ(evicted, std::vector<std::string>{MockSecondName});
+}
+
+TEST_F(DatasetCacheTest, Admit_OverBudget_LeasedDatasetKept)
+{
+    DatasetCache datasetCache(datasetBytes, "");
+    datasetCache.admit(MockFirstName);
+    load(MockSecondName);
+    {
+        DatasetCache::Lease lease = datasetCache.lease(MockFirstName);
+        ASSERT_TRUE(datasetCache.admit(MockSecondName).empty());
+        ASSERT_TRUE(SharedMemorySegments::findMemorySegment(MockFirstName));
+    }
+    SharedMemorySegments::SegmentHandle handle = SharedMemorySegments::findMemorySegment(MockFirstName);
+    ASSERT_TRUE(datasetCache.admit(MockSecondName).empty());
+    handle.release();
+    ASSERT_EQ(datasetCache.admit(MockSecondName), std::vector<std::string>{MockFirstName});
+}
+
+TEST_F(DatasetCacheTest, Admit_OverBudget_EvictedDatasetPersisted)
+{
+    const std::string MockPersistFolder = "MockCachePersistFolder";
+    DatasetCache datasetCache(datasetBytes, MockPersistFolder);
+    datasetCache.admit(MockFirstName);
+    load(MockSecondName);
+
+    ASSERT_EQ(datasetCache.admit(MockSecondName), std::vector<std::string>{MockFirstName});
+    std::string filePath = wisent::serializer::getPersistedFilePath(MockFirstName, MockPersistFolder);
+    ASSERT_TRUE(std::filesystem::exists(filePath));
+
+    Result<WisentRootExpression*> restored = wisent::serializer::loadPersisted(filePath, MockFirstName);
+    ASSERT_TRUE(restored.success());
+    ASSERT_EQ(datasetCache.admit(MockFirstName), std::vector<std::string>{MockSecondName});
+
+    std::filesystem::remove_all(MockPersistFolder);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/ServerHelpers/LoadJobs.hpp"
+#include "../../../Include/json.h"
+#include <chrono>
+#include <string>
+#include <thread>
+
+using json = nlohmann::json;
+
+static json waitForJob(
+    LoadJobs &loadJobs, 
+    uint64_t id
+) {
+    for (int attempt = 0; attempt < 500; attempt++) 
+    {
+        json status = json::parse(loadJobs.getStatus(id));
+        std::string phase = status["phase"];
+        if (phase == "done" || phase == "failed" || phase == "cancelled") 
+        {
+            return status;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return json::parse(loadJobs.getStatus(id));
+}
+
+TEST(LoadJobsTest, Start_FinishedJobReportsDone)
+{
+    LoadJobs loadJobs;
+    uint64_t id = loadJobs.start("MockDataset", [](LoadProgress &progress) {
+        progress.addTotalBytes(100);
+        progress.addProcessedBytes(100);
+        progress.addProcessedRows(2);
+        return makeResult<WisentRootExpression*>(nullptr);
+    });
+
+    json status = waitForJob(loadJobs, id);
+    ASSERT_EQ(status["phase"], "done");
+    ASSERT_EQ(status["name"], "MockDataset");
+    ASSERT_EQ(status["bytesProcessed"], 100);
+    ASSERT_EQ(status["rowsProcessed"], 2);
+    ASSERT_FALSE(status.contains("error"));
+}
+
+TEST(LoadJobsTest, StartAndWatch_FutureHoldsFinalStatus)
+{
+    LoadJobs loadJobs(0);   // finished jobs are dropped right away
+    std::shared_future<std::string> done = loadJobs.startAndWatch("MockDataset", [](LoadProgress &progress) {
+        progress.addProcessedRows(2);
+        return makeResult<WisentRootExpression*>(nullptr);
+    });
+    std::shared_future<std::string> failed = loadJobs.startAndWatch("MockFailing", [](LoadProgress &progress) {
+        return makeError<WisentRootExpression*>("failed to read: MockFailing");
+    });
+
+    json doneStatus = json::parse(done.get());
+    ASSERT_EQ(doneStatus["phase"], "done");
+    ASSERT_EQ(doneStatus["rowsProcessed"], 2);
+    json failedStatus = json::parse(failed.get());
+    ASSERT_EQ(failedStatus["phase"], "failed");
+    ASSERT_EQ(failedStatus["error"], "failed to read: MockFailing");
+}
+
+TEST(LoadJobsTest, Cancel_RunningJobReportsCancelled)
+{
+    LoadJobs loadJobs;
+    uint64_t id = loadJobs.start("MockDataset", [](LoadProgress &progress) {
+        while (!progress.isCancelRequested()) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return makeError<WisentRootExpression*>("load cancelled: MockDataset");
+    });
+
+    ASSERT_TRUE(loadJobs.cancel(id));
+    json status = waitForJob(loadJobs, id);
+    ASSERT_EQ(status["phase"], "cancelled");
+    ASSERT_EQ(status["error"], "load cancelled: MockDataset");
+}
+
+TEST(LoadJobsTest, Start_BeyondMaxRunningJobs_Refused)
+{
+    LoadJobs loadJobs(256, 1);
+    auto waitForCancel = [](LoadProgress &progress) {
+        while (!progress.isCancelRequested()) 
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return makeError<WisentRootExpression*>("load cancelled: MockDataset");
+    };
+    uint64_t id = loadJobs.start("MockDataset", waitForCancel);
+    ASSERT_NE(id, 0u);
+    ASSERT_EQ(loadJobs.start("MockRefused", waitForCancel), 0u);
+    ASSERT_FALSE(loadJobs.startAndWatch("MockRefused", waitForCancel).valid());
+
+    // a finished job frees its place (it counts as finished just after its final status is set)
+    ASSERT_TRUE(loadJobs.cancel(id));
+    waitForJob(loadJobs, id);
+    uint64_t next = 0;
+    for (int attempt = 0; attempt < 500 && next == 0; attempt++) 
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        next = loadJobs.start("MockNext", [](LoadProgress & /*progress*/) {
+            return makeResult<WisentRootExpression*>(nullptr);
+        });
+    }
+    ASSERT_NE(next, 0u);
+    ASSERT_EQ(waitForJob(loadJobs, next)["phase"], "done");
+}
+
+TEST(LoadJobsTest, UnknownId_NotFound)
+{
+    LoadJobs loadJobs;
+    ASSERT_FALSE(loadJobs.cancel(42));
+    ASSERT_EQ(loadJobs.getStatus(42), "");
+    ASSERT_EQ(json::parse(loadJobs.getStatuses()).size(), 0);
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/ISharedMemorySegment.hpp"
+#include "../../../Src/Helpers/ServerHelpers/FdPassingServer.hpp"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace SharedMemorySegments;
+
+class MemfdMemorySegmentTest : public ::testing::Test
+{
+  protected:
+    const std::string MockMemfdName = "MockMemfdSegment";
+    const std::string MockSocketPath = "MockFdPassing.sock";
+    const std::string MockContent = "immutable wisent payload";
+
+    ISharedMemorySegment *buildSealedSegment()
+    {
+        ISharedMemorySegment *segment = registerMemorySegment(MockMemfdName, makeMemfdMemorySegment(MockMemfdName)).get();
+        void *base = sharedMemoryMalloc(segment, MockContent.size());
+        memcpy(base, MockContent.data(), MockContent.size());
+        EXPECT_TRUE(sealMemfdMemorySegment(MockMemfdName));
+        return segment;
+    }
+
+    void TearDown() override
+    {
+        clearMemorySegments();
+    }
+};
+
+TEST_F(MemfdMemorySegmentTest, Seal_ContentsKeptAndWritesRefused)
+{
+    ISharedMemorySegment *segment = buildSealedSegment();
+    ASSERT_TRUE(segment->isLoaded());
+    ASSERT_EQ(std::string(reinterpret_cast<char *>(segment->getBaseAddress()), segment->getSize()), MockContent);
+
+    int fileDescriptor = getMemfdFileDescriptor(findMemorySegment(MockMemfdName));
+    ASSERT_GE(fileDescriptor, 0);
+    ASSERT_LT(pwrite(fileDescriptor, "x", 1, 0), 0);
+    ASSERT_EQ(mmap(nullptr, MockContent.size(), PROT_WRITE, MAP_SHARED, fileDescriptor, 0), MAP_FAILED);
+}
+
+TEST_F(MemfdMemorySegmentTest, GetMemfdFileDescriptor_Unsealed_ReturnsInvalid)
+{
+    ISharedMemorySegment *segment = registerMemorySegment(MockMemfdName, makeMemfdMemorySegment(MockMemfdName)).get();
+    sharedMemoryMalloc(segment, MockContent.size());
+    ASSERT_EQ(getMemfdFileDescriptor(findMemorySegment(MockMemfdName)), -1);
+}
+
+TEST_F(MemfdMemorySegmentTest, ReceiveMemfd_OutlivesErasedSegment)
+{
+    buildSealedSegment();
+    FdPassingServer fdPassingServer;
+    ASSERT_TRUE(fdPassingServer.start(MockSocketPath));
+
+    size_t size = 0;
+    int fileDescriptor = receiveMemfd(MockSocketPath, MockMemfdName, size);
+    ASSERT_GE(fileDescriptor, 0);
+    ASSERT_EQ(size, MockContent.size());
+    ASSERT_EQ(receiveMemfd(MockSocketPath, "MockUnknownName", size), -1);
+    fdPassingServer.stop();
+
+    ASSERT_TRUE(eraseMemorySegment(MockMemfdName));
+    void *mapped = mmap(nullptr, MockContent.size(), PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    ASSERT_NE(mapped, MAP_FAILED);
+    ASSERT_EQ(std::string(reinterpret_cast<char *>(mapped), MockContent.size()), MockContent);
+    munmap(mapped, MockContent.size());
+    close(fileDescriptor);
+}
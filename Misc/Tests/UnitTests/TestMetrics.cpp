@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/Metrics.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(MetricsTest, Counter_SumsIncrementsOfAllThreads)
+{
+    Metrics::Counter &counter = Metrics::getCounter("test_counter_total", "Test counter");
+    uint64_t before = counter.getValue();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 32; i++)
+    {
+        threads.emplace_back([]() {
+            Metrics::Counter &sameCounter = Metrics::getCounter("test_counter_total", "Test counter");
+            for (int j = 0; j < 1000; j++)
+            {
+                sameCounter.add();
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    ASSERT_EQ(counter.getValue() - before, 32000u);
+}
+
+TEST(MetricsTest, Histogram_RendersCumulativeBuckets)
+{
+    Metrics::Histogram &histogram = Metrics::getHistogram(
+        "test_duration_seconds",
+        "Test histogram",
+        {{"endpoint", "/test"}}
+    );
+    histogram.observe(0.0005);
+    histogram.observe(0.003);
+    histogram.observe(1000.0);
+    ASSERT_EQ(histogram.getCount(), 3u);
+    ASSERT_NEAR(histogram.getSum(), 1000.0035, 1e-6);
+
+    std::string output = Metrics::renderPrometheus();
+    ASSERT_NE(output.find("# TYPE test_duration_seconds histogram\n"), std::string::npos);
+    ASSERT_NE(output.find("test_duration_seconds_bucket{endpoint=\"/test\",le=\"0.001\"} 1\n"), std::string::npos);
+    ASSERT_NE(output.find("test_duration_seconds_bucket{endpoint=\"/test\",le=\"0.004\"} 2\n"), std::string::npos);
+    ASSERT_NE(output.find("test_duration_seconds_bucket{endpoint=\"/test\",le=\"+Inf\"} 3\n"), std::string::npos);
+    ASSERT_NE(output.find("test_duration_seconds_count{endpoint=\"/test\"} 3\n"), std::string::npos);
+}
+
+TEST(MetricsTest, Gauge_EscapesLabelValues)
+{
+    Metrics::setGauge("test_gauge_bytes", "Test gauge", []() {
+        return std::vector<std::pair<Metrics::Labels, double>>{
+            {{{"name", "a\"b"}}, 42.0}
+        };
+    });
+    std::string output = Metrics::renderPrometheus();
+    ASSERT_NE(output.find("# TYPE test_gauge_bytes gauge\n"), std::string::npos);
+    ASSERT_NE(output.find("test_gauge_bytes{name=\"a\\\"b\"} 42\n"), std::string::npos);
+}
@@ -1,5 +1,8 @@
 #include "gtest/gtest.h"
 #include "../../../Src/Helpers/ISharedMemorySegment.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
 
 const std::string MockSharedMemoryName = "MockSharedMemoryName";
 const std::string MockDifferentName = "MockDifferentName";
@@ -7,68 +10,79 @@ const size_t MockSharedMemorySize = 1024;
 
 using namespace SharedMemorySegments;
 
+namespace
+{
+    std::atomic<int> factoryCalls{0};
+
+    std::shared_ptr<ISharedMemorySegment> makeCountedMemorySegment(std::string const &name)
+    {
+        factoryCalls++;
+        return makeMemorySegment(name);
+    }
+}
+
 TEST(MockSharedMemorySegmentsTest, CreateOrGetMemorySegment_UniqueName_NewSegmentGetsCreated) 
 {
-    ASSERT_EQ(getSharedMemorySegments().size(), 0);
-    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName);
-    ASSERT_EQ(getSharedMemorySegments().size(), 1);
+    ASSERT_EQ(getMemorySegmentCount(), 0);
+    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName).get();
+    ASSERT_EQ(getMemorySegmentCount(), 1);
 
     ASSERT_NE(mockSharedMemory, nullptr);
     ASSERT_EQ(mockSharedMemory->isLoaded(), false);
 
-    getSharedMemorySegments().clear();
+    clearMemorySegments();
     setCurrentSharedMemory(nullptr);
 }
 
 TEST(MockSharedMemorySegmentsTest, CreateOrGetMemorySegment_DuplicatedName_SegmentGetsReturned) 
 {
-    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName).get();
 
     setCurrentSharedMemory(mockSharedMemory);
     sharedMemoryMalloc(MockSharedMemorySize);
     auto initialSegmentPointer = getCurrentSharedMemory()->getBaseAddress(); 
 
-    ISharedMemorySegment *mockSharedMemoryDuplicated = createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *mockSharedMemoryDuplicated = createOrGetMemorySegment(MockSharedMemoryName).get();
     setCurrentSharedMemory(mockSharedMemoryDuplicated);
-    ASSERT_EQ(getSharedMemorySegments().size(), 1);
+    ASSERT_EQ(getMemorySegmentCount(), 1);
     ASSERT_EQ(getCurrentSharedMemory()->getBaseAddress(), initialSegmentPointer);
 
-    getSharedMemorySegments().clear();
+    clearMemorySegments();
     setCurrentSharedMemory(nullptr);
 }
 
 TEST(MockSharedMemorySegmentsTest, CreateOrGetMemorySegment_DifferentName_NewSegmentGetsCreated) 
 {
-    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName).get();
     
     setCurrentSharedMemory(mockSharedMemory);
     sharedMemoryMalloc(MockSharedMemorySize);
     auto initialSegmentPointer = getCurrentSharedMemory()->getBaseAddress(); 
 
-    ISharedMemorySegment *mockSharedMemoryNotDuplicated = createOrGetMemorySegment(MockDifferentName);
+    ISharedMemorySegment *mockSharedMemoryNotDuplicated = createOrGetMemorySegment(MockDifferentName).get();
     setCurrentSharedMemory(mockSharedMemoryNotDuplicated);
     sharedMemoryMalloc(MockSharedMemorySize);
-    ASSERT_EQ(getSharedMemorySegments().size(), 2);
+    ASSERT_EQ(getMemorySegmentCount(), 2);
     ASSERT_NE(getCurrentSharedMemory()->getBaseAddress(), initialSegmentPointer);
 
-    getSharedMemorySegments().clear();
+    clearMemorySegments();
     setCurrentSharedMemory(nullptr);
 }
 
 TEST(MockSharedMemorySegmentsTest, SetCurrentSharedMemory_SetsSegmentPointer) 
 {
-    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName).get();
     ASSERT_EQ(getCurrentSharedMemory(), nullptr);
     setCurrentSharedMemory(mockSharedMemory);
     ASSERT_NE(getCurrentSharedMemory(), nullptr);
 
-    getSharedMemorySegments().clear();
+    clearMemorySegments();
     setCurrentSharedMemory(nullptr);
 }
 
 TEST(MockSharedMemorySegmentsTest, SharedMemoryMalloc_AllocatesMemorySize) 
 {
-    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName).get();
     setCurrentSharedMemory(mockSharedMemory);
 
     void *sharedMemoryPtr = sharedMemoryMalloc(MockSharedMemorySize);
@@ -76,19 +90,90 @@ TEST(MockSharedMemorySegmentsTest, SharedMemoryMalloc_AllocatesMemorySize)
     ASSERT_EQ(getCurrentSharedMemory()->getSize(), MockSharedMemorySize);
     ASSERT_EQ(getCurrentSharedMemory()->getBaseAddress(), sharedMemoryPtr);
 
-    getSharedMemorySegments().clear();
+    clearMemorySegments();
     setCurrentSharedMemory(nullptr);
 }
 
 TEST(MockSharedMemorySegmentsTest, SharedMemoryRealloc_ReturnsNewSize) 
 {
-    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName).get();
     setCurrentSharedMemory(mockSharedMemory);
 
     void *sharedMemoryPtr = sharedMemoryMalloc(MockSharedMemorySize);
     sharedMemoryRealloc(getCurrentSharedMemory()->getBaseAddress(), MockSharedMemorySize*2);
     ASSERT_EQ(getCurrentSharedMemory()->getSize(), MockSharedMemorySize*2);
 
-    getSharedMemorySegments().clear();
+    clearMemorySegments();
     setCurrentSharedMemory(nullptr);
 }
+
+TEST(MockSharedMemorySegmentsTest, SharedMemoryMalloc_ExplicitSegment_IgnoresCurrentSegment) 
+{
+    ISharedMemorySegment *mockSharedMemory = createOrGetMemorySegment(MockSharedMemoryName).get();
+
+    void *sharedMemoryPtr = sharedMemoryMalloc(mockSharedMemory, MockSharedMemorySize);
+    ASSERT_EQ(getCurrentSharedMemory(), nullptr);
+    ASSERT_EQ(mockSharedMemory->getBaseAddress(), sharedMemoryPtr);
+    sharedMemoryRealloc(mockSharedMemory, sharedMemoryPtr, MockSharedMemorySize*2);
+    ASSERT_EQ(mockSharedMemory->getSize(), MockSharedMemorySize*2);
+
+    clearMemorySegments();
+}
+
+TEST(MockSharedMemorySegmentsTest, FindMemorySegment_CountsReferences) 
+{
+    createOrGetMemorySegment(MockSharedMemoryName);
+    ASSERT_EQ(getReferenceCount(MockSharedMemoryName), 0);
+    {
+        SegmentHandle handle = findMemorySegment(MockSharedMemoryName);
+        SegmentHandle otherHandle = findMemorySegment(MockSharedMemoryName);
+        ASSERT_TRUE(handle);
+        ASSERT_EQ(getReferenceCount(MockSharedMemoryName), 2);
+    }
+    ASSERT_EQ(getReferenceCount(MockSharedMemoryName), 0);
+    ASSERT_FALSE(findMemorySegment(MockDifferentName));
+
+    clearMemorySegments();
+}
+
+TEST(MockSharedMemorySegmentsTest, EraseMemorySegment_Referenced_SegmentIsKept) 
+{
+    createOrGetMemorySegment(MockSharedMemoryName);
+    SegmentHandle handle = findMemorySegment(MockSharedMemoryName);
+
+    ASSERT_FALSE(eraseMemorySegment(MockSharedMemoryName));
+    ASSERT_EQ(getMemorySegmentCount(), 1);
+
+    handle.release();
+    ASSERT_TRUE(eraseMemorySegment(MockSharedMemoryName));
+    ASSERT_EQ(getMemorySegmentCount(), 0);
+}
+
+TEST(MockSharedMemorySegmentsTest, CreateOrGetMemorySegment_ConcurrentThreads_SingleSegmentGetsCreated) 
+{
+    const size_t ThreadCount = 8;
+    std::vector<ISharedMemorySegment *> segments(ThreadCount);
+    std::vector<std::thread> threads;
+    factoryCalls = 0;
+    setMemorySegmentFactory(makeCountedMemorySegment);
+    for (size_t i = 0; i < ThreadCount; ++i) 
+    {
+        threads.emplace_back([&segments, i]() {
+            segments[i] = createOrGetMemorySegment(MockSharedMemoryName).get();
+        });
+    }
+    for (std::thread &thread : threads) 
+    {
+        thread.join();
+    }
+    setMemorySegmentFactory(makeMemorySegment);
+    ASSERT_EQ(getMemorySegmentCount(), 1);
+    // the threads that lost the race did not open a segment of their own
+    ASSERT_EQ(factoryCalls, 1);
+    for (ISharedMemorySegment *segment : segments) 
+    {
+        ASSERT_EQ(segment, segments[0]);
+    }
+
+    clearMemorySegments();
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/ServerHelpers/Preloader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void waitUntilFinished(Preloader &preloader)
+{
+    for (int attempt = 0; attempt < 500 && !preloader.isFinished(); attempt++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+TEST(PreloaderTest, Parse_SortsByPriority)
+{
+    Result<PreloadManifest> manifest = PreloadManifest::parse(R"({
+        "parallelism": 2,
+        "datasets": [
+            {"name": "low", "path": "low.json"},
+            {"name": "high", "path": "high.json", "loader": "compress", "priority": 5}
+        ]
+    })");
+    ASSERT_TRUE(manifest.success()) << manifest.getError();
+    ASSERT_EQ(manifest.value->parallelism, 2u);
+    ASSERT_EQ(manifest.value->datasets[0].name, "high");
+    ASSERT_EQ(manifest.value->datasets[1].loader, "serialize");
+
+    ASSERT_FALSE(PreloadManifest::parse(R"({"datasets": [{"name": "noPath"}]})").success());
+    ASSERT_FALSE(PreloadManifest::parse(R"({"datasets": [{"name": "a", "path": "a", "loader": "bson"}]})").success());
+    ASSERT_FALSE(PreloadManifest::parse(R"({"datasets": [{"name": "a", "path": "a"}, {"name": "a", "path": "b"}]})").success());
+}
+
+TEST(PreloaderTest, Start_LoadsAllWithinParallelism)
+{
+    Result<PreloadManifest> manifest = PreloadManifest::parse(R"({
+        "parallelism": 2,
+        "datasets": [
+            {"name": "a", "path": "a"}, {"name": "b", "path": "b"}, {"name": "c", "path": "c"},
+            {"name": "d", "path": "d"}, {"name": "broken", "path": "broken"}
+        ]
+    })");
+    ASSERT_TRUE(manifest.success());
+
+    std::atomic<int> running{0};
+    std::atomic<int> maximumRunning{0};
+    Preloader preloader;
+    preloader.start(manifest.getValue(), [&](PreloadEntry const &entry, LoadProgress & /*progress*/) {
+        int now = ++running;
+        int seen = maximumRunning;
+        while (now > seen && !maximumRunning.compare_exchange_weak(seen, now)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        running--;
+        return entry.name == "broken"
+            ? makeError<WisentRootExpression*>("no such file")
+            : makeResult<WisentRootExpression*>(nullptr);
+    });
+    waitUntilFinished(preloader);
+
+    ASSERT_TRUE(preloader.isFinished());
+    ASSERT_LE(maximumRunning.load(), 2);
+    ASSERT_TRUE(preloader.isWarm("a"));
+    ASSERT_FALSE(preloader.isWarm("broken"));
+    ASSERT_FALSE(preloader.isWarm("unknown"));
+
+    nlohmann::json status = preloader.getStatus();
+    ASSERT_TRUE(status["ready"].get<bool>());
+    ASSERT_EQ(status["failed"], 1);
+    ASSERT_EQ(status["datasets"]["broken"]["state"], "failed");
+    ASSERT_EQ(status["datasets"]["broken"]["error"], "no such file");
+}
+
+TEST(PreloaderTest, Destructor_CancelsRunningLoads)
+{
+    Result<PreloadManifest> manifest = PreloadManifest::parse(R"({"datasets": [{"name": "slow", "path": "slow"}]})");
+    ASSERT_TRUE(manifest.success());
+    {
+        Preloader preloader;
+        preloader.start(manifest.getValue(), [](PreloadEntry const & /*entry*/, LoadProgress &progress) {
+            while (!progress.isCancelRequested())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return makeError<WisentRootExpression*>("load cancelled: slow");
+        });
+        ASSERT_FALSE(preloader.getStatus()["ready"].get<bool>());
+    }
+}
+
+TEST(PreloaderTest, BatchTurns_StartByPriorityWithinParallelism)
+{
+    size_t const datasetCount = 6;
+    BatchTurns turns(2, datasetCount);
+    std::mutex mutex;
+    std::vector<size_t> started;
+    std::atomic<int> running{0};
+    std::atomic<int> maximumRunning{0};
+    std::vector<std::thread> loads;
+    // started back to front, so the turns and not the threads decide the order
+    for (size_t index = datasetCount; index-- > 0;)
+    {
+        loads.emplace_back([&, index]() {
+            LoadProgress progress;
+            ASSERT_TRUE(turns.waitForTurn(index, progress));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                started.push_back(index);
+            }
+            int now = ++running;
+            int seen = maximumRunning;
+            while (now > seen && !maximumRunning.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            running--;
+            turns.finish();
+        });
+    }
+    for (std::thread &load : loads)
+    {
+        load.join();
+    }
+    ASSERT_LE(maximumRunning.load(), 2);
+    ASSERT_EQ(started.size(), datasetCount);
+    // the first two may swap, after that a turn only frees once one of them finished
+    ASSERT_EQ(std::max(started[0], started[1]), 1u);
+    for (size_t position = 2; position < datasetCount; position++)
+    {
+        ASSERT_EQ(started[position], position);
+    }
+}
+
+TEST(PreloaderTest, BatchTurns_CancelledWhileWaiting_GivesUpTurn)
+{
+    BatchTurns turns(1, 3);
+    LoadProgress first;
+    ASSERT_TRUE(turns.waitForTurn(0, first));
+
+    LoadProgress cancelled;
+    cancelled.requestCancel();
+    ASSERT_FALSE(turns.waitForTurn(1, cancelled));
+
+    turns.finish();
+    LoadProgress last;
+    ASSERT_TRUE(turns.waitForTurn(2, last));
+    turns.finish();
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/ServerHelpers/SegmentStream.hpp"
+#include "../../../Src/WisentSerializer/WisentSerializer.hpp"
+#include "helpers/unitTestHelpers.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+class SegmentStreamTest : public ::testing::Test
+{
+  protected:
+    const std::string MockSharedMemoryName = "MockStreamedMemory";
+    const std::string MockCsvFileName = "MockStreamedCsv.csv";
+    const std::string MockCsvFileContent = "Name,Age\nAlice,30\nBob,25";
+    const std::string MockFileName = "MockStreamedFile.json";
+    const std::string MockFileContent = R"({"data": "MockStreamedCsv.csv"})";
+
+    void SetUp() override
+    {
+        createTempFile(MockCsvFileName, MockCsvFileContent);
+        createTempFile(MockFileName, MockFileContent);
+        ASSERT_TRUE(wisent::serializer::load(MockFileName, MockSharedMemoryName, "").success());
+    }
+
+    void TearDown() override
+    {
+        wisent::serializer::free(MockSharedMemoryName);
+        std::remove(MockCsvFileName.c_str());
+        std::remove(MockFileName.c_str());
+    }
+
+    std::vector<char> readStream(
+        SegmentStream const &stream,
+        uint64_t offset,
+        uint64_t bytes
+    ) {
+        std::vector<char> streamed;
+        stream.write(offset, bytes, [&streamed](char const *data, size_t size) {
+            streamed.insert(streamed.end(), data, data + size);
+            return true;
+        });
+        return streamed;
+    }
+};
+
+TEST_F(SegmentStreamTest, Write_MatchesPersistedFile)
+{
+    const std::string MockPersistFolder = "MockStreamPersistFolder";
+    Result<std::shared_ptr<SegmentStream>> opened = SegmentStream::open(MockSharedMemoryName);
+    ASSERT_TRUE(opened.success());
+    std::shared_ptr<SegmentStream> stream = opened.getValue();
+
+    Result<std::string> persisted = wisent::serializer::persist(MockSharedMemoryName, MockPersistFolder);
+    ASSERT_TRUE(persisted.success());
+    std::ifstream persistedFile(persisted.getValue(), std::ios::binary);
+    std::vector<char> persistedBytes((std::istreambuf_iterator<char>(persistedFile)), std::istreambuf_iterator<char>());
+
+    ASSERT_EQ(stream->getFileBytes(), persistedBytes.size());
+    ASSERT_EQ(readStream(*stream, 0, stream->getFileBytes()), persistedBytes);
+    // ranges crossing the copied prefix and the mapping
+    ASSERT_EQ(
+        readStream(*stream, 60, 40),
+        std::vector<char>(persistedBytes.begin() + 60, persistedBytes.begin() + 100)
+    );
+    std::filesystem::remove_all(MockPersistFolder);
+}
+
+TEST_F(SegmentStreamTest, Layout_CoversSectionsAndTables)
+{
+    Result<std::shared_ptr<SegmentStream>> opened = SegmentStream::open(MockSharedMemoryName);
+    ASSERT_TRUE(opened.success());
+    nlohmann::json layout = opened.getValue()->getLayout();
+
+    uint64_t sectionBytes = 0;
+    for (auto const &[name, section] : layout["sections"].items())
+    {
+        sectionBytes += section["bytes"].get<uint64_t>();
+    }
+    ASSERT_EQ(sectionBytes, layout["bytes"].get<uint64_t>());
+
+    ASSERT_EQ(layout["tables"].size(), 1u);
+    nlohmann::json const &table = layout["tables"][0];
+    ASSERT_EQ(table["columns"], nlohmann::json({"Name", "Age"}));
+    ASSERT_EQ(table["arguments"]["bytes"].get<uint64_t>(), 4 * sizeof(WisentArgumentValue));
+
+    ASSERT_FALSE(opened.getValue()->getSection("tables").success());
+}
+
+TEST_F(SegmentStreamTest, Open_UnknownSegment_ReturnsError)
+{
+    size_t segmentCount = SharedMemorySegments::getMemorySegmentCount();
+    ASSERT_FALSE(SegmentStream::open("MockUnknownStreamedMemory").success());
+    ASSERT_EQ(SharedMemorySegments::getMemorySegmentCount(), segmentCount);
+}
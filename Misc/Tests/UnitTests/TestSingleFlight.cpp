@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/ServerHelpers/SingleFlight.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(SingleFlightTest, Run_ConcurrentCalls_FunctionRunsOnce)
+{
+    SingleFlight<int> singleFlight;
+    std::atomic<int> runCount{0};
+    std::atomic<bool> started{false};
+
+    std::vector<int> results(8, 0);
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() {
+        results[0] = singleFlight.run("MockDataset", [&]() {
+            started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            return ++runCount;
+        });
+    });
+    while (!started) 
+    {
+        std::this_thread::yield();
+    }
+    for (size_t i = 1; i < results.size(); i++) 
+    {
+        threads.emplace_back([&, i]() {
+            results[i] = singleFlight.run("MockDataset", [&]() { return ++runCount; });
+        });
+    }
+    for (std::thread &thread : threads) 
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(runCount, 1);
+    for (int result : results) 
+    {
+        ASSERT_EQ(result, 1);
+    }
+    ASSERT_EQ(singleFlight.getInFlightCount(), 0);
+}
+
+TEST(SingleFlightTest, Run_SequentialCalls_FunctionRunsEachTime)
+{
+    SingleFlight<int> singleFlight;
+    int runCount = 0;
+    ASSERT_EQ(singleFlight.run("MockDataset", [&]() { return ++runCount; }), 1);
+    ASSERT_EQ(singleFlight.run("MockDataset", [&]() { return ++runCount; }), 2);
+    ASSERT_EQ(singleFlight.run("MockOtherDataset", [&]() { return ++runCount; }), 3);
+}
+
+TEST(SingleFlightTest, Run_Throws_ExceptionPropagatedAndKeyReleased)
+{
+    SingleFlight<int> singleFlight;
+    ASSERT_THROW(
+        singleFlight.run("MockDataset", []() -> int { throw std::runtime_error("MockError"); }), 
+        std::runtime_error
+    );
+    ASSERT_EQ(singleFlight.getInFlightCount(), 0);
+    ASSERT_EQ(singleFlight.run("MockDataset", []() { return 7; }), 7);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/ServerHelpers/TableQuery.hpp"
+#include "../../../Src/Helpers/ISharedMemorySegment.hpp"
+#include "../../../Src/WisentSerializer/WisentSerializer.hpp"
+#include "helpers/unitTestHelpers.hpp"
+#include <cstring>
+#include <string>
+
+class TableQueryTest : public ::testing::Test
+{
+  protected:
+    const std::string MockSharedMemoryName = "MockQueriedMemory";
+    const std::string MockCsvFileName = "MockQueriedCsv.csv";
+    const std::string MockCsvFileContent = "Name,Age\nAlice,30\nBob,25\nCarol,41.5";
+    const std::string MockFileName = "MockQueriedFile.json";
+    const std::string MockFileContent = R"({"data": "MockQueriedCsv.csv"})";
+
+    void SetUp() override
+    {
+        createTempFile(MockCsvFileName, MockCsvFileContent);
+        createTempFile(MockFileName, MockFileContent);
+        ASSERT_TRUE(wisent::serializer::load(MockFileName, MockSharedMemoryName, "").success());
+    }
+
+    void TearDown() override
+    {
+        wisent::serializer::free(MockSharedMemoryName);
+        std::remove(MockCsvFileName.c_str());
+        std::remove(MockFileName.c_str());
+    }
+
+    Result<TableQueryResult> query(std::string const &body)
+    {
+        Result<TableQuery> parsed = TableQuery::parse(body);
+        EXPECT_TRUE(parsed.success()) << parsed.getError();
+        return runTableQuery(MockSharedMemoryName, parsed.getValue());
+    }
+};
+
+TEST_F(TableQueryTest, Aggregate_OverFilteredRows)
+{
+    Result<TableQueryResult> result = query(R"({
+        "table": "data",
+        "columns": ["Age"],
+        "where": [{"column": "Age", "op": "<", "value": 40}],
+        "aggregate": "sum"
+    })");
+    ASSERT_TRUE(result.success()) << result.getError();
+    ASSERT_EQ(result.value->rowCount, 2u);
+    ASSERT_EQ(result.value->aggregates["sum"]["Age"].get<int64_t>(), 55);
+
+    result = query(R"({"table": "data", "columns": ["Age"], "aggregate": "max"})");
+    ASSERT_TRUE(result.success()) << result.getError();
+    ASSERT_DOUBLE_EQ(result.value->aggregates["max"]["Age"].get<double>(), 41.5);
+}
+
+TEST_F(TableQueryTest, Projection_ReturnsSelectedRows)
+{
+    Result<TableQueryResult> result = query(R"({
+        "table": "data/Table",
+        "columns": ["Name"],
+        "where": [{"column": "Name", "op": "==", "value": "Bob"}]
+    })");
+    ASSERT_TRUE(result.success()) << result.getError();
+    std::string const &rows = result.value->rows;
+
+    uint64_t header[2];
+    memcpy(header, rows.data(), sizeof(header));
+    ASSERT_EQ(header[0], 1u);
+    ASSERT_EQ(header[1], 1u);
+    uint32_t nameBytes;
+    memcpy(&nameBytes, rows.data() + sizeof(header), sizeof(nameBytes));
+    size_t offset = sizeof(header) + sizeof(nameBytes);
+    ASSERT_EQ(rows.substr(offset, nameBytes), "Name");
+    offset += nameBytes;
+    ASSERT_EQ(static_cast<uint8_t>(rows[offset]), ARGUMENT_TYPE_STRING);
+    offset += 1 + sizeof(uint64_t) + sizeof(uint64_t);
+    ASSERT_STREQ(rows.data() + offset, "Bob");
+}
+
+TEST_F(TableQueryTest, UnknownColumnOrTable_ReturnsError)
+{
+    ASSERT_FALSE(query(R"({"table": "data", "columns": ["Height"]})").success());
+    ASSERT_FALSE(query(R"({"table": "other", "columns": ["Age"]})").success());
+
+    size_t segmentCount = SharedMemorySegments::getMemorySegmentCount();
+    Result<TableQuery> parsed = TableQuery::parse(R"({"table": "data", "columns": ["Age"]})");
+    ASSERT_FALSE(runTableQuery("MockUnknownQueriedMemory", parsed.getValue()).success());
+    ASSERT_EQ(SharedMemorySegments::getMemorySegmentCount(), segmentCount);
+    ASSERT_FALSE(TableQuery::parse(R"({"columns": ["Age"], "aggregate": "median"})").success());
+    ASSERT_FALSE(TableQuery::parse(R"({"columns": ["Name"], "where": [{"column": "Name", "op": "<", "value": "B"}]})").success());
+}
@@ -1,6 +1,160 @@
 #include <gtest/gtest.h>
-#include "../../Src/Helpers/ISharedMemorySegment.hpp"
+#include "../../../Src/WisentCompressor/WisentCompressor.hpp"
+#include "../../../Src/WisentCompressor/CompressedColumn.hpp"
+#include "../../../Src/WisentSerializer/WisentSerializer.hpp"
+#include "../../../Src/Helpers/ServerHelpers/TableQuery.hpp"
+#include "../../../Src/Helpers/ISharedMemorySegment.hpp"
 #include "helpers/unitTestHelpers.hpp"
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+class WisentCompressorTest : public ::testing::Test
+{
+  protected:
+    const std::string MockSharedMemoryName = "MockCompressedMemory";
+    const std::string MockCsvFileName = "MockCompressedCsv.csv";
+    const std::string MockFileName = "MockCompressedFile.json";
+    const std::string MockFileContent = R"({"data": "MockCompressedCsv.csv"})";
+    static constexpr int64_t RowCount = 300000;     // three int pages
 
+    void SetUp() override
+    {
+        std::string csv = "Key,Amount\n";
+        for (int64_t row = 0; row < RowCount; row++)
+        {
+            csv += std::to_string(row * 3 + 1) + "," + std::to_string(row % 1000 - 200) + "\n";
+        }
+        createTempFile(MockCsvFileName, csv);
+        createTempFile(MockFileName, MockFileContent);
+    }
+
+    void TearDown() override
+    {
+        wisent::serializer::free(MockSharedMemoryName);
+        std::remove(MockCsvFileName.c_str());
+        std::remove(MockFileName.c_str());
+    }
+
+    // both columns compressed, each with its own pipeline steps
+    void load(
+        std::vector<std::string> const &keySteps,
+        std::vector<std::string> const &amountSteps
+    ) {
+        std::unordered_map<std::string, CompressionPipeline> pipelines;
+        CompressionPipeline::Builder keyPipeline;
+        for (std::string const &step : keySteps)
+        {
+            keyPipeline.addStep(step);
+        }
+        CompressionPipeline::Builder amountPipeline;
+        for (std::string const &step : amountSteps)
+        {
+            amountPipeline.addStep(step);
+        }
+        pipelines["Key"] = keyPipeline.build();
+        pipelines["Amount"] = amountPipeline.build();
+        Result<WisentRootExpression *> loaded = wisent::compressor::CompressAndLoadJson(
+            MockFileName,
+            MockSharedMemoryName,
+            "",
+            pipelines
+        );
+        ASSERT_TRUE(loaded.success()) << loaded.getError();
+    }
+
+    Result<TableQueryResult> query(std::string const &body)
+    {
+        Result<TableQuery> parsed = TableQuery::parse(body);
+        EXPECT_TRUE(parsed.success()) << parsed.getError();
+        return runTableQuery(MockSharedMemoryName, parsed.getValue());
+    }
+
+    // sum of Key and Amount over the rows with Amount >= minimum
+    void expectFilteredSums(int64_t minimum)
+    {
+        Result<TableQueryResult> result = query(R"({
+            "table": "data",
+            "columns": ["Key", "Amount"],
+            "where": [{"column": "Amount", "op": ">=", "value": )" + std::to_string(minimum) + R"(}],
+            "aggregate": "sum"
+        })");
+        ASSERT_TRUE(result.success()) << result.getError();
+        int64_t keySum = 0;
+        int64_t amountSum = 0;
+        uint64_t rows = 0;
+        for (int64_t row = 0; row < RowCount; row++)
+        {
+            if (row % 1000 - 200 >= minimum)
+            {
+                keySum += row * 3 + 1;
+                amountSum += row % 1000 - 200;
+                rows++;
+            }
+        }
+        ASSERT_EQ(result.value->rowCount, rows);
+        ASSERT_EQ(result.value->aggregates["sum"]["Key"].get<int64_t>(), keySum);
+        ASSERT_EQ(result.value->aggregates["sum"]["Amount"].get<int64_t>(), amountSum);
+    }
+};
+
+TEST_F(WisentCompressorTest, DeltaBinaryPackedPages_ReadBackThroughTheLoader)
+{
+    load({"delta_binary_packed", "fse"}, {"delta_binary_packed", "lz77", "huffman"});
+    expectFilteredSums(790);
+
+    Result<TableQueryResult> result = query(R"({"table": "data", "columns": ["Key"], "aggregate": "max"})");
+    ASSERT_TRUE(result.success()) << result.getError();
+    ASSERT_EQ(result.value->aggregates["max"]["Key"].get<int64_t>(), (RowCount - 1) * 3 + 1);
+}
+
+TEST_F(WisentCompressorTest, BitPackedPages_ReadBackThroughTheLoader)
+{
+    // Amount is negative for a fifth of the rows: zigzag keeps those narrow
+    load({"bit_packed", "fse"}, {"bit_packed"});
+    expectFilteredSums(-200);
+    expectFilteredSums(500);
+
+    Result<TableQueryResult> result = query(R"({"table": "data", "columns": ["Amount"], "aggregate": "min"})");
+    ASSERT_TRUE(result.success()) << result.getError();
+    ASSERT_EQ(result.value->aggregates["min"]["Amount"].get<int64_t>(), -200);
+}
+
+TEST_F(WisentCompressorTest, FrameOfReferencePages_ReadBackThroughTheLoader)
+{
+    load({"frame_of_reference"}, {"patched_frame_of_reference", "huffman"});
+    expectFilteredSums(0);
+}
+
+TEST_F(WisentCompressorTest, AutoPages_ReadBackThroughTheLoader)
+{
+    load({"auto", "fse"}, {"auto"});
+    expectFilteredSums(-200);
+    expectFilteredSums(700);
+}
+
+TEST_F(WisentCompressorTest, CorruptPage_ReturnsError)
+{
+    load({"delta_binary_packed"}, {"plain"});
+    SharedMemorySegments::SegmentHandle handle = SharedMemorySegments::createOrGetPublishedMemorySegment(MockSharedMemoryName);
+    ASSERT_TRUE(handle && handle->isLoaded());
+    WisentRootExpression *root = reinterpret_cast<WisentRootExpression *>(handle->getBaseAddress());
+
+    // the first page of the first compressed column the tree holds
+    for (uint64_t expression = 0; expression < root->expressionCount; expression++)
+    {
+        if (!wisent::compressor::isCompressedColumn(root, expression))
+        {
+            continue;
+        }
+        Result<wisent::compressor::CompressedColumn> column = wisent::compressor::readCompressedColumn(root, expression);
+        ASSERT_TRUE(column.success()) << column.getError();
+        ASSERT_EQ(column.value->pages.size(), 3u);
+        ASSERT_TRUE(wisent::compressor::decodeCompressedColumn(root, expression).success());
+        wisent::compressor::CompressedPage const &page = column.value->pages.front();
+        getStringBuffer(root)[page.dataOffset + page.dataBytes / 2] ^= 0x5A;
+        break;
+    }
+    handle.release();
+    ASSERT_FALSE(query(R"({"table": "data", "columns": ["Key", "Amount"], "aggregate": "sum"})").success());
+}
@@ -4,6 +4,9 @@
 #include "../../../Src/Helpers/Result.hpp"
 #include "helpers/unitTestHelpers.hpp"
 #include <string>
+#include <filesystem>
+#include <thread>
+#include <vector>
 
 class WisentSerializerTest : public ::testing::Test 
 {
@@ -36,7 +39,7 @@ class WisentSerializerTest : public ::testing::Test
 
 TEST_F(WisentSerializerTest, WisentLoad) 
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName).get();
 
     Result<WisentRootExpression*> result = wisent::serializer::load(
         MockFileName, 
@@ -50,22 +53,22 @@ TEST_F(WisentSerializerTest, WisentLoad)
 }
 
 TEST_F(WisentSerializerTest, WisentUnload) {
-
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName);
-
     Result<WisentRootExpression*> result = wisent::serializer::load(
         MockFileName, 
         MockSharedMemoryName, 
         MockCsvPrefix
     );
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetPublishedMemorySegment(MockSharedMemoryName).get();
 
     wisent::serializer::unload(MockSharedMemoryName);
     ASSERT_FALSE(sharedMemory->isLoaded());
-    ASSERT_EQ(SharedMemorySegments::getSharedMemorySegments().size(), 1);
+    ASSERT_TRUE(SharedMemorySegments::findMemorySegment(MockSharedMemoryName));
+
+    wisent::serializer::free(MockSharedMemoryName);
 }
 
 TEST_F(WisentSerializerTest, WisentFree) {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName);
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName).get();
 
     Result<WisentRootExpression*> result = wisent::serializer::load(
         MockFileName, 
@@ -74,5 +77,215 @@ TEST_F(WisentSerializerTest, WisentFree) {
     );
 
     wisent::serializer::free(MockSharedMemoryName);
-    ASSERT_EQ(SharedMemorySegments::getSharedMemorySegments().size(), 0);
+    ASSERT_EQ(SharedMemorySegments::getMemorySegmentCount(), 0);
+}
+
+TEST_F(WisentSerializerTest, WisentForceReload_PublishesNewGeneration) {
+    Result<WisentRootExpression*> result = wisent::serializer::load(
+        MockFileName, 
+        MockSharedMemoryName, 
+        MockCsvPrefix
+    );
+    ASSERT_TRUE(result.success());
+    // the first build is published like any other
+    ASSERT_EQ(SharedMemorySegments::getPublishedGeneration(MockSharedMemoryName), 1);
+    WisentRootExpression *previousRoot = result.getValue();
+    uint64_t previousExpressionCount = previousRoot->expressionCount;
+
+    Result<WisentRootExpression*> reloaded = wisent::serializer::load(
+        MockFileName, 
+        MockSharedMemoryName, 
+        MockCsvPrefix, 
+        false, 
+        false, 
+        true
+    );
+    ASSERT_TRUE(reloaded.success());
+    ASSERT_NE(reloaded.getValue(), previousRoot);
+    ASSERT_EQ(SharedMemorySegments::getPublishedGeneration(MockSharedMemoryName), 2);
+
+    // readers of the previous generation are not torn down by the reload
+    ASSERT_EQ(previousRoot->expressionCount, previousExpressionCount);
+    ISharedMemorySegment *published = SharedMemorySegments::createOrGetPublishedMemorySegment(MockSharedMemoryName).get();
+    ASSERT_EQ(published->getBaseAddress(), reloaded.getValue());
+
+    wisent::serializer::free(MockSharedMemoryName);
+    ASSERT_EQ(SharedMemorySegments::getMemorySegmentCount(), 0);
+}
+
+TEST_F(WisentSerializerTest, WisentPublish_NothingStaged_ReturnsEmptyHandle) {
+    ASSERT_FALSE(SharedMemorySegments::publishMemorySegment(MockSharedMemoryName));
+
+    // staged, but nothing built into it
+    SharedMemorySegments::createStagingMemorySegment(MockSharedMemoryName).release();
+    ASSERT_FALSE(SharedMemorySegments::publishMemorySegment(MockSharedMemoryName));
+    ASSERT_EQ(SharedMemorySegments::getPublishedGeneration(MockSharedMemoryName), 0);
+    ASSERT_EQ(SharedMemorySegments::getMemorySegmentCount(), 0);
+}
+
+TEST_F(WisentSerializerTest, WisentLoad_IgnoresCurrentSegmentOfThread) {
+    const std::string MockOtherSharedMemoryName = "MockOtherSharedMemory";
+    ISharedMemorySegment *otherSharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockOtherSharedMemoryName).get();
+    SharedMemorySegments::setCurrentSharedMemory(otherSharedMemory);
+
+    Result<WisentRootExpression*> result = wisent::serializer::load(
+        MockFileName, 
+        MockSharedMemoryName, 
+        MockCsvPrefix
+    );
+    ASSERT_TRUE(result.success());
+    ASSERT_FALSE(otherSharedMemory->isLoaded());
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName).get();
+    ASSERT_EQ(sharedMemory->getBaseAddress(), result.getValue());
+
+    SharedMemorySegments::setCurrentSharedMemory(nullptr);
+    wisent::serializer::free(MockSharedMemoryName);
+    SharedMemorySegments::takeMemorySegment(MockOtherSharedMemoryName);
+}
+
+TEST_F(WisentSerializerTest, WisentLoad_ConcurrentDatasets) {
+    const std::vector<std::string> MockSharedMemoryNames = {"MockConcurrent0", "MockConcurrent1", "MockConcurrent2", "MockConcurrent3"};
+    std::vector<Result<WisentRootExpression*>> results(MockSharedMemoryNames.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < MockSharedMemoryNames.size(); i++) 
+    {
+        threads.emplace_back([&, i]() {
+            results[i] = wisent::serializer::load(
+                MockFileName, 
+                MockSharedMemoryNames[i], 
+                MockCsvPrefix
+            );
+        });
+    }
+    for (std::thread &thread : threads) 
+    {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < MockSharedMemoryNames.size(); i++) 
+    {
+        ASSERT_TRUE(results[i].success());
+        ASSERT_EQ(results[i].getValue()->expressionCount, results[0].getValue()->expressionCount);
+        ASSERT_EQ(results[i].getValue()->stringBufferBytesWritten, results[0].getValue()->stringBufferBytesWritten);
+    }
+    for (std::string const &name : MockSharedMemoryNames) 
+    {
+        wisent::serializer::free(name);
+    }
+    ASSERT_EQ(SharedMemorySegments::getMemorySegmentCount(), 0);
+}
+
+TEST_F(WisentSerializerTest, WisentLoad_ReportsProgress) {
+    LoadProgress progress;
+    progress.start();
+    Result<WisentRootExpression*> result = wisent::serializer::load(
+        MockFileName, 
+        MockSharedMemoryName, 
+        MockCsvPrefix, 
+        false, 
+        false, 
+        false, 
+        &progress
+    );
+    ASSERT_TRUE(result.success());
+    ASSERT_EQ(progress.getPhase(), LoadPhase::Building);
+    ASSERT_GT(progress.getTotalBytes(), 0);
+    ASSERT_EQ(progress.getProcessedBytes(), progress.getTotalBytes());
+    ASSERT_EQ(progress.getProcessedRows(), 2);
+
+    wisent::serializer::free(MockSharedMemoryName);
+}
+
+TEST_F(WisentSerializerTest, WisentLoad_RecordsProfile) {
+    LoadProgress progress;
+    progress.start();
+    Result<WisentRootExpression*> result = wisent::serializer::load(
+        MockFileName, 
+        MockSharedMemoryName, 
+        MockCsvPrefix, 
+        false, 
+        false, 
+        false, 
+        &progress
+    );
+    ASSERT_TRUE(result.success());
+    auto phases = progress.getProfile().getPhaseTimings();
+    ASSERT_EQ(phases["count pass"].count, 1);
+    ASSERT_EQ(phases["build pass"].count, 1);
+    ASSERT_GT(phases["csv parse"].count, 0);
+    ASSERT_GT(progress.getProfile().getCounters()["segment bytes"], 0);
+    ASSERT_GT(progress.getProfile().getPeakResidentSetBytes(), 0);
+
+    wisent::serializer::free(MockSharedMemoryName);
+}
+
+TEST_F(WisentSerializerTest, WisentLoad_Cancelled_ReturnsError) {
+    LoadProgress progress;
+    progress.requestCancel();
+    Result<WisentRootExpression*> result = wisent::serializer::load(
+        MockFileName, 
+        MockSharedMemoryName, 
+        MockCsvPrefix, 
+        false, 
+        false, 
+        false, 
+        &progress
+    );
+    ASSERT_FALSE(result.success());
+    // cancelled while counting: the empty segment of the lookup is not kept
+    ASSERT_FALSE(SharedMemorySegments::findMemorySegment(MockSharedMemoryName));
+    ASSERT_EQ(SharedMemorySegments::getPublishedGeneration(MockSharedMemoryName), 0);
+}
+
+TEST_F(WisentSerializerTest, WisentPersistAndLoadPersisted) {
+    const std::string MockPersistFolder = "MockPersistFolder";
+    const std::string MockPersistedName = "MockPersistedMemory";
+
+    Result<WisentRootExpression*> result = wisent::serializer::load(
+        MockFileName, 
+        MockSharedMemoryName, 
+        MockCsvPrefix
+    );
+    ASSERT_TRUE(result.success());
+    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(MockSharedMemoryName).get();
+    std::vector<char> loadedBytes(
+        reinterpret_cast<char *>(sharedMemory->getBaseAddress()) + sizeof(WisentRootExpression), 
+        reinterpret_cast<char *>(sharedMemory->getBaseAddress()) + sharedMemory->getSize()
+    );
+
+    Result<std::string> persisted = wisent::serializer::persist(MockSharedMemoryName, MockPersistFolder);
+    ASSERT_TRUE(persisted.success());
+    size_t segmentCount = SharedMemorySegments::getMemorySegmentCount();
+    ASSERT_FALSE(wisent::serializer::persist("MockUnknownPersistedMemory", MockPersistFolder).success());
+    ASSERT_EQ(SharedMemorySegments::getMemorySegmentCount(), segmentCount);
+    wisent::serializer::free(MockSharedMemoryName);
+
+    Result<WisentRootExpression*> restored = wisent::serializer::loadPersisted(
+        persisted.getValue(), 
+        MockPersistedName
+    );
+    ASSERT_TRUE(restored.success());
+    WisentRootExpression *root = restored.getValue();
+    ASSERT_EQ(root->originalAddress, nullptr);
+    ASSERT_EQ(
+        std::vector<char>(root->arguments, root->arguments + loadedBytes.size()), 
+        loadedBytes
+    );
+
+    wisent::serializer::free(MockPersistedName);
+    std::filesystem::remove_all(MockPersistFolder);
+}
+
+TEST_F(WisentSerializerTest, WisentLoadPersisted_InvalidFile_ReturnsError) {
+    const std::string MockInvalidFileName = "MockInvalidFile.wisent";
+    createTempFile(MockInvalidFileName, std::string(128, 'x'));
+
+    Result<WisentRootExpression*> restored = wisent::serializer::loadPersisted(
+        MockInvalidFileName, 
+        MockSharedMemoryName
+    );
+    ASSERT_FALSE(restored.success());
+
+    SharedMemorySegments::takeMemorySegment(MockSharedMemoryName);
+    std::remove(MockInvalidFileName.c_str());
 }
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+#include "../../../Src/Helpers/ServerHelpers/WorkerPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+TEST(WorkerPoolTest, Submit_ReturnsTaskResult)
+{
+    WorkerPool workerPool(2);
+    std::future<int> future = workerPool.submit([]() { return 42; });
+    ASSERT_EQ(future.get(), 42);
+}
+
+TEST(WorkerPoolTest, Submit_BoundsConcurrentTasks)
+{
+    const size_t MockWorkerCount = 2;
+    WorkerPool workerPool(MockWorkerCount);
+    std::atomic<size_t> running{0};
+    std::atomic<size_t> maxRunning{0};
+
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 8; i++) 
+    {
+        futures.push_back(workerPool.submit([&]() {
+            size_t nowRunning = ++running;
+            size_t previousMax = maxRunning;
+            while (nowRunning > previousMax && !maxRunning.compare_exchange_weak(previousMax, nowRunning)) 
+            {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            running--;
+        }));
+    }
+    for (std::future<void> &future : futures) 
+    {
+        future.get();
+    }
+    ASSERT_EQ(workerPool.getWorkerCount(), MockWorkerCount);
+    ASSERT_LE(maxRunning, MockWorkerCount);
+    ASSERT_GE(maxRunning, 1u);
+}
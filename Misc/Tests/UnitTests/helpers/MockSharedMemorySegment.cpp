@@ -31,9 +31,7 @@ class MockSharedMemorySegment : public ISharedMemorySegment
     {
         assert(isLoaded());
         assert(pointer == getBaseAddress());
-        unload();
-        memory.resize(size);
-        load();
+        memory.resize(size);    // keeps the contents, like the real segments
         return getBaseAddress();
     }
 
@@ -84,51 +82,8 @@ class MockSharedMemorySegment : public ISharedMemorySegment
 
 namespace SharedMemorySegments
 {
-    std::unordered_map<std::string, std::unique_ptr<ISharedMemorySegment>> &getSharedMemorySegments()
-    {
-        return sharedMemorySegmentsList;
-    }
-
-    ISharedMemorySegment *getCurrentSharedMemory() 
-    {
-        return currentSharedMemoryPtr;
-    }
-
-    void setCurrentSharedMemory(ISharedMemorySegment *sharedMemory) 
-    {
-        currentSharedMemoryPtr = sharedMemory;
-    }
-
-    void *sharedMemoryMalloc(size_t size) 
+    std::shared_ptr<ISharedMemorySegment> makeMemorySegment(std::string const &name) 
     {
-        return getCurrentSharedMemory()->malloc(size);
-    }
-
-    void *sharedMemoryRealloc(void *pointer, size_t size) 
-    {
-        return getCurrentSharedMemory()->realloc(pointer, size);
-    }
-
-    void sharedMemoryFree(void *pointer) 
-    {
-        if (getCurrentSharedMemory() == nullptr) 
-        {
-            std::cerr << "Cannot free memory as currentSharedMemory is nullptr" << std::endl;
-        }
-        getCurrentSharedMemory()->free(pointer);
-    }
-
-    ISharedMemorySegment *createOrGetMemorySegment(std::string const &name) 
-    {
-        auto it = getSharedMemorySegments().find(name);
-        if (it != getSharedMemorySegments().end()) 
-        {
-            return it->second.get();
-        }
-
-        std::unique_ptr<MockSharedMemorySegment> newSegment = std::make_unique<MockSharedMemorySegment>(name);
-        MockSharedMemorySegment *newSegmentPtr = newSegment.get();
-        getSharedMemorySegments().insert(std::make_pair(name, std::move(newSegment)));
-        return newSegmentPtr;
+        return std::make_shared<MockSharedMemorySegment>(name);
     }
 }
@@ -14,19 +14,22 @@ template <class T> struct SharedMemoryAllocator
 {
     typedef T value_type;
 
-    SharedMemoryAllocator() 
-        : pointer(nullptr), size(0) 
+    // allocates in the given segment, whatever segment other threads build into
+    explicit SharedMemoryAllocator(ISharedMemorySegment *sharedMemory) 
+        : sharedMemory(sharedMemory), pointer(nullptr), size(0) 
     {}
 
     template <class U>
     SharedMemoryAllocator(const SharedMemoryAllocator<U> &other)
-        : pointer(other.pointer)
+        : sharedMemory(other.sharedMemory)
+        , pointer(other.pointer)
         , size(other.size)
     {}
 
     template <class U>
     SharedMemoryAllocator(SharedMemoryAllocator<U> &&other)
-        : pointer(std::move(other.pointer))
+        : sharedMemory(other.sharedMemory)
+        , pointer(std::move(other.pointer))
         , size(std::move(other.size))
     {}
 
@@ -55,11 +58,11 @@ template <class T> struct SharedMemoryAllocator
             {
                 return static_cast<T *>(pointer);
             }
-            pointer = SharedMemorySegments::sharedMemoryRealloc(pointer, newSize);
+            pointer = SharedMemorySegments::sharedMemoryRealloc(sharedMemory, pointer, newSize);
         }
         else 
         {
-            pointer = SharedMemorySegments::sharedMemoryMalloc(newSize);
+            pointer = SharedMemorySegments::sharedMemoryMalloc(sharedMemory, newSize);
         }
 
         if (pointer == nullptr) 
@@ -76,6 +79,7 @@ template <class T> struct SharedMemoryAllocator
     }
 
 private:
+    ISharedMemorySegment *sharedMemory;
     void *pointer;
     size_t size;
 };
@@ -142,7 +146,7 @@ void *bson::serializer::loadAsBson(
     bool disableCsvHandling, 
     bool forceReload)
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
 
     if (!forceReload && sharedMemory->exists() && !sharedMemory->isLoaded()) 
     {
@@ -154,10 +158,10 @@ void *bson::serializer::loadAsBson(
         {
             return sharedMemory->getBaseAddress();
         }
+        sharedMemory.release();
         free(sharedMemoryName);
         sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
     }
-    SharedMemorySegments::setCurrentSharedMemory(sharedMemory);
 
     json j = load(
         path, 
@@ -166,7 +170,7 @@ void *bson::serializer::loadAsBson(
     );
     std::vector<std::uint8_t> v = json::to_bson(j);
 
-    void *base = SharedMemorySegments::sharedMemoryMalloc(v.size() + 1);
+    void *base = SharedMemorySegments::sharedMemoryMalloc(sharedMemory.get(), v.size() + 1);
     memcpy(base, v.data(), v.size());
     reinterpret_cast<char *>(base)[v.size()] = '\0';
     return base;
@@ -185,7 +189,7 @@ void *bson::serializer::loadAsJson(
     bool disableCsvHandling, 
     bool forceReload)
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
 
     if (!forceReload && sharedMemory->exists() && !sharedMemory->isLoaded()) 
     {
@@ -197,10 +201,10 @@ void *bson::serializer::loadAsJson(
         {
             return sharedMemory->getBaseAddress();
         }
+        sharedMemory.release();
         free(sharedMemoryName);
         sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
     }
-    SharedMemorySegments::setCurrentSharedMemory(sharedMemory);
 
     json j = load(
         path, 
@@ -211,7 +215,7 @@ void *bson::serializer::loadAsJson(
     ostream << j;
 
     std::string str = ostream.str();
-    void *base = SharedMemorySegments::sharedMemoryMalloc(str.size() + 1);
+    void *base = SharedMemorySegments::sharedMemoryMalloc(sharedMemory.get(), str.size() + 1);
     memcpy(base, str.data(), str.size());
     reinterpret_cast<char *>(base)[str.size()] = '\0';
     return base;
@@ -223,14 +227,16 @@ void *bson::serializer::loadAsJson(
 
 void bson::serializer::unload(std::string const &sharedMemoryName)
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
     assert(sharedMemory->isLoaded());
     sharedMemory->unload();
 }
 
 void bson::serializer::free(std::string const &sharedMemoryName)
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
-    sharedMemory->erase();
-    SharedMemorySegments::getSharedMemorySegments().erase(sharedMemoryName);
+    SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+    if (!SharedMemorySegments::eraseMemorySegment(sharedMemoryName)) 
+    {
+        std::cerr << "Error: Shared memory segment is still referenced." << std::endl;
+    }
 }
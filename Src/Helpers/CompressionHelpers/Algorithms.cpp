@@ -1,24 +1,318 @@
 #include "RLE.hpp"
 #include "LZ77.hpp"
 #include "Delta.hpp"
+#include "BitPacking.hpp"
 #include "FSE.hpp"
 #include "Huffman.hpp"
 #include "Algorithms.hpp"
+#include "Varint.hpp"
+#include <cstring>
 #include <stdexcept>
 #include <unordered_set>
+#include <utility>
+
+namespace
+{
+    using wisent::algorithms::BitPacking;
+
+    using wisent::algorithms::DeltaBinaryPacked;
+    using wisent::algorithms::EncodingType;
+    using wisent::algorithms::readVarint;
+    using wisent::algorithms::unzigzag;
+    using wisent::algorithms::writeVarint;
+    using wisent::algorithms::zigzag;
+
+    size_t roundUpToGroup(size_t count) 
+    {
+        return (count + BitPacking::GROUP_SIZE - 1) / BitPacking::GROUP_SIZE * BitPacking::GROUP_SIZE;
+    }
+
+    // count values (padded to whole groups with zeros) at width bits each
+    void appendPacked(std::vector<uint8_t>& output, std::vector<uint64_t> values, uint8_t width) 
+    {
+        values.resize(roundUpToGroup(values.size()), 0);
+        size_t position = output.size();
+        output.resize(position + BitPacking::packedSize(values.size(), width));
+        BitPacking::pack(values.data(), values.size(), width, output.data() + position);
+    }
+
+    // values holds roundUpToGroup(count) entries; the page may end right after the packed bytes
+    bool readPacked(const uint8_t*& position, const uint8_t* end, size_t count, uint8_t width, uint64_t* values) 
+    {
+        const size_t groupBytes = BitPacking::packedSize(BitPacking::GROUP_SIZE, width);
+        if (width > 64 || static_cast<size_t>(end - position) < BitPacking::packedSize(roundUpToGroup(count), width)) 
+        {
+            return false;
+        }
+        uint8_t padded[BitPacking::GROUP_SIZE / 8 * 64 + BitPacking::READ_PADDING] = {};
+        for (size_t group = 0; group < roundUpToGroup(count); group += BitPacking::GROUP_SIZE) 
+        {
+            const uint8_t* source = position;
+            if (static_cast<size_t>(end - position) < groupBytes + BitPacking::READ_PADDING) 
+            {
+                memcpy(padded, position, groupBytes);
+                source = padded;
+            }
+            BitPacking::unpack(source, BitPacking::GROUP_SIZE, width, values + group);
+            position += groupBytes;
+        }
+        return true;
+    }
+
+    // every width from the 90th percentile up, costed with its exceptions
+    uint8_t choosePatchedWidth(
+        const size_t (&widthCounts)[65],
+        size_t count,
+        uint8_t rangeWidth,
+        size_t& bestBits
+    ) {
+        const uint8_t positionWidth = BitPacking::requiredBits(count > 0 ? count - 1 : 0);
+        uint8_t width = rangeWidth;
+        size_t fitting = 0;
+        bestBits = count * rangeWidth;
+        for (uint8_t candidate = 0; candidate < rangeWidth; candidate++) 
+        {
+            fitting += widthCounts[candidate];
+            if (fitting * 10 < count * 9) 
+            {
+                continue;
+            }
+            const size_t exceptions = count - fitting;
+            const size_t bits = count * candidate + exceptions * (positionWidth + rangeWidth - candidate);
+            if (bits < bestBits) 
+            {
+                bestBits = bits;
+                width = candidate;
+            }
+        }
+        return width;
+    }
+
+    /*
+     * FRAME_OF_REFERENCE pages: varint value count, zigzag varint reference
+     * (the page minimum), a width byte, then value - reference packed at the
+     * width of the page's range, in groups of 32.
+     *
+     * PATCHED_FRAME_OF_REFERENCE pages pack to a narrower width, starting
+     * from the one 90% of the values fit in, and append the exceptions: a
+     * varint count, the widths of their positions and of their high bits,
+     * then the packed positions and the packed high bits.
+     */
+    std::vector<uint8_t> encodeFrameOfReference(
+        const int64_t* values,
+        size_t count,
+        int64_t minimum,
+        int64_t maximum,
+        bool patched
+    ) {
+        const uint64_t reference = static_cast<uint64_t>(minimum);
+        const uint8_t rangeWidth = BitPacking::requiredBits(static_cast<uint64_t>(maximum) - reference);
+        std::vector<uint64_t> offsets(count);
+        size_t widthCounts[65] = {};
+        for (size_t i = 0; i < count; i++) 
+        {
+            offsets[i] = static_cast<uint64_t>(values[i]) - reference;
+            widthCounts[BitPacking::requiredBits(offsets[i])]++;
+        }
+
+        size_t patchedBits;
+        const uint8_t width = patched ? choosePatchedWidth(widthCounts, count, rangeWidth, patchedBits) : rangeWidth;
+        const uint8_t positionWidth = BitPacking::requiredBits(count > 0 ? count - 1 : 0);
+
+        std::vector<uint8_t> output;
+        writeVarint(output, count);
+        writeVarint(output, zigzag(minimum));
+        output.push_back(width);
+
+        std::vector<uint64_t> positions;
+        std::vector<uint64_t> highBits;
+        const uint64_t mask = width == 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+        for (size_t i = 0; i < count && width < rangeWidth; i++) 
+        {
+            if (offsets[i] > mask) 
+            {
+                positions.push_back(i);
+                highBits.push_back(offsets[i] >> width);
+                offsets[i] &= mask;
+            }
+        }
+        appendPacked(output, std::move(offsets), width);
+        if (patched) 
+        {
+            const uint8_t highWidth = rangeWidth - width;
+            writeVarint(output, positions.size());
+            output.push_back(positionWidth);
+            output.push_back(highWidth);
+            appendPacked(output, std::move(positions), positionWidth);
+            appendPacked(output, std::move(highBits), highWidth);
+        }
+        return output;
+    }
+
+    Result<std::vector<int64_t>> decodeFrameOfReference(const std::vector<uint8_t>& page, bool patched) 
+    {
+        Result<std::vector<int64_t>> result;
+        const uint8_t* position = page.data();
+        const uint8_t* end = position + page.size();
+        uint64_t count;
+        uint64_t reference;
+        if (!readVarint(position, end, count) || !readVarint(position, end, reference) || position == end) 
+        {
+            return makeError<std::vector<int64_t>>("FrameOfReference: corrupt header");
+        }
+        const uint8_t width = *position++;
+        // no larger than a PLAIN page, as encodeIntColumn writes them
+        if (count > wisent::algorithms::DEFAULT_PAGE_SIZE / wisent::algorithms::SIZE_OF_INT64) 
+        {
+            return makeError<std::vector<int64_t>>("FrameOfReference: corrupt value count");
+        }
+
+        std::vector<int64_t> output(roundUpToGroup(count));
+        uint64_t* values = reinterpret_cast<uint64_t*>(output.data());
+        if (!readPacked(position, end, count, width, values)) 
+        {
+            return makeError<std::vector<int64_t>>("FrameOfReference: truncated values");
+        }
+
+        if (patched) 
+        {
+            uint64_t exceptionCount;
+            if (!readVarint(position, end, exceptionCount) || static_cast<size_t>(end - position) < 2 || exceptionCount > count) 
+            {
+                return makeError<std::vector<int64_t>>("FrameOfReference: corrupt exception header");
+            }
+            const uint8_t positionWidth = *position++;
+            const uint8_t highWidth = *position++;
+            std::vector<uint64_t> positions(roundUpToGroup(exceptionCount));
+            std::vector<uint64_t> highBits(roundUpToGroup(exceptionCount));
+            if (!readPacked(position, end, exceptionCount, positionWidth, positions.data()) 
+                || !readPacked(position, end, exceptionCount, highWidth, highBits.data()) 
+                || (exceptionCount > 0 && width >= 64)) 
+            {
+                return makeError<std::vector<int64_t>>("FrameOfReference: truncated exceptions");
+            }
+            for (size_t i = 0; i < exceptionCount; i++) 
+            {
+                if (positions[i] >= count) 
+                {
+                    return makeError<std::vector<int64_t>>("FrameOfReference: exception outside the page");
+                }
+                values[positions[i]] |= highBits[i] << width;
+            }
+        }
+        if (position != end) 
+        {
+            return makeError<std::vector<int64_t>>("FrameOfReference: trailing bytes after the page");
+        }
+
+        const uint64_t minimum = static_cast<uint64_t>(unzigzag(reference));
+        for (size_t i = 0; i < output.size(); i++) 
+        {
+            values[i] += minimum;
+        }
+        output.resize(count);
+        result.value = std::move(output);
+        return result;
+    }
+
+    /*
+     * AUTO pages: the encoding with the fewest estimated bits, from the
+     * widths the encoders would pick - of the page's range (FOR, PFOR), of
+     * the zigzag codes per BIT_PACKED block and of the deltas above each
+     * block's smallest per DELTA_BINARY_PACKED miniblock. Headers are left
+     * out; ties go to the encoding listed first, the cheaper one to decode.
+     */
+    EncodingType chooseIntEncoding(
+        const int64_t* values,
+        size_t count,
+        int64_t minimum,
+        int64_t maximum
+    ) {
+        const uint64_t reference = static_cast<uint64_t>(minimum);
+        const uint8_t rangeWidth = BitPacking::requiredBits(static_cast<uint64_t>(maximum) - reference);
+        size_t widthCounts[65] = {};
+        for (size_t i = 0; i < count; i++) 
+        {
+            widthCounts[BitPacking::requiredBits(static_cast<uint64_t>(values[i]) - reference)]++;
+        }
+        size_t patchedBits;
+        choosePatchedWidth(widthCounts, count, rangeWidth, patchedBits);
+
+        size_t bitPackedBits = 0;
+        for (size_t start = 0; start < count; start += BitPacking::BLOCK_SIZE) 
+        {
+            uint64_t bits = 0;
+            for (size_t i = start; i < std::min(start + BitPacking::BLOCK_SIZE, count); i++) 
+            {
+                bits |= zigzag(values[i]);
+            }
+            bitPackedBits += BitPacking::BLOCK_SIZE * BitPacking::requiredBits(bits);
+        }
+
+        constexpr size_t MINIBLOCK_SIZE = DeltaBinaryPacked::BLOCK_SIZE / DeltaBinaryPacked::MINIBLOCK_COUNT;
+        size_t deltaBits = 0;
+        for (size_t start = 1; start < count; start += DeltaBinaryPacked::BLOCK_SIZE) 
+        {
+            const size_t blockEnd = std::min(start + DeltaBinaryPacked::BLOCK_SIZE, count);
+            int64_t minDelta = INT64_MAX;
+            for (size_t i = start; i < blockEnd; i++) 
+            {
+                minDelta = std::min(minDelta, static_cast<int64_t>(static_cast<uint64_t>(values[i]) - static_cast<uint64_t>(values[i - 1])));
+            }
+            for (size_t miniblock = start; miniblock < blockEnd; miniblock += MINIBLOCK_SIZE) 
+            {
+                uint64_t bits = 0;
+                for (size_t i = miniblock; i < std::min(miniblock + MINIBLOCK_SIZE, blockEnd); i++) 
+                {
+                    bits |= static_cast<uint64_t>(values[i]) - static_cast<uint64_t>(values[i - 1]) - static_cast<uint64_t>(minDelta);
+                }
+                deltaBits += MINIBLOCK_SIZE * BitPacking::requiredBits(bits);
+            }
+        }
+
+        const std::pair<EncodingType, size_t> candidates[] = {
+            {EncodingType::FRAME_OF_REFERENCE, count * rangeWidth},
+            {EncodingType::BIT_PACKED, bitPackedBits},
+            {EncodingType::DELTA_BINARY_PACKED, deltaBits},
+            {EncodingType::PATCHED_FRAME_OF_REFERENCE, patchedBits},
+            {EncodingType::PLAIN, count * 64}
+        };
+        std::pair<EncodingType, size_t> best = candidates[0];
+        for (const std::pair<EncodingType, size_t>& candidate : candidates) 
+        {
+            if (candidate.second < best.second) 
+            {
+                best = candidate;
+            }
+        }
+        return best.first;
+    }
+}
 
 namespace wisent::algorithms
 {
     std::vector<std::vector<uint8_t>> encodeIntColumn(
         const std::vector<int64_t>& column,
-        ColumnMetaData& columnMetaData
+        ColumnMetaData& columnMetaData,
+        EncodingType encodingType
     ) {
         std::vector<std::vector<uint8_t>> pages;
         size_t totalValues = 0;
         size_t totalUncompressedSize = 0;
 
+        switch (encodingType) 
+        {
+            case EncodingType::BIT_PACKED:
+            case EncodingType::DELTA_BINARY_PACKED:
+            case EncodingType::FRAME_OF_REFERENCE:
+            case EncodingType::PATCHED_FRAME_OF_REFERENCE:
+            case EncodingType::AUTO:
+                break;
+            default:
+                encodingType = EncodingType::PLAIN;
+        }
         columnMetaData.physicalType = PhysicalType::INT64;
-        columnMetaData.encodingType = EncodingType::PLAIN;
+        columnMetaData.encodingType = encodingType;
 
         size_t startIndex = 0;
         while (startIndex < column.size()) 
@@ -30,15 +324,19 @@ namespace wisent::algorithms
             int64_t minVal = column[startIndex];
             int64_t maxVal = column[startIndex];
 
+            // pages hold as many values as a PLAIN page would, whatever the encoding
             while (endIndex < column.size() && bytesInPage + SIZE_OF_INT64 <= DEFAULT_PAGE_SIZE) 
             {
                 int64_t value = column[endIndex];
                 minVal = std::min(minVal, value);
                 maxVal = std::max(maxVal, value);
 
-                for (size_t b = 0; b < SIZE_OF_INT64; ++b) 
+                if (encodingType == EncodingType::PLAIN) 
                 {
-                    pageBuffer.push_back(static_cast<uint8_t>((value >> (8 * b)) & 0xFF));
+                    for (size_t b = 0; b < SIZE_OF_INT64; ++b) 
+                    {
+                        pageBuffer.push_back(static_cast<uint8_t>((value >> (8 * b)) & 0xFF));
+                    }
                 }
 
                 bytesInPage += SIZE_OF_INT64;
@@ -55,6 +353,42 @@ namespace wisent::algorithms
                 column.begin() + endIndex
             ).size();
 
+            const int64_t* pageValues = column.data() + startIndex;
+            const EncodingType pageEncoding = encodingType == EncodingType::AUTO 
+                ? chooseIntEncoding(pageValues, numValues, minVal, maxVal) 
+                : encodingType;
+            switch (pageEncoding) 
+            {
+                case EncodingType::BIT_PACKED:
+                    pageBuffer = BitPacking::encode(pageValues, numValues);
+                    break;
+                case EncodingType::DELTA_BINARY_PACKED:
+                    pageBuffer = DeltaBinaryPacked::encode(pageValues, numValues);
+                    break;
+                case EncodingType::FRAME_OF_REFERENCE:
+                case EncodingType::PATCHED_FRAME_OF_REFERENCE:
+                    // the page's range sets the width; patched pages narrow it when outliers stretch it
+                    pageBuffer = encodeFrameOfReference(
+                        pageValues, 
+                        numValues, 
+                        *pageStats.minInt, 
+                        *pageStats.maxInt, 
+                        pageEncoding == EncodingType::PATCHED_FRAME_OF_REFERENCE
+                    );
+                    break;
+                default:
+                    if (encodingType == EncodingType::AUTO) 
+                    {
+                        pageBuffer.resize(numValues * SIZE_OF_INT64);
+                        memcpy(pageBuffer.data(), pageValues, pageBuffer.size());
+                    }
+                    break;
+            }
+            if (encodingType == EncodingType::AUTO) 
+            {
+                pageBuffer.insert(pageBuffer.begin(), static_cast<uint8_t>(pageEncoding));
+            }
+
             PageHeader pageHeader;
             pageHeader.pageType = PageType::DATA_PAGE;
             pageHeader.numberOfValues = static_cast<uint32_t>(numValues);
@@ -63,12 +397,12 @@ namespace wisent::algorithms
             pageHeader.compressedPageSize = pageHeader.uncompressedPageSize;
             pageHeader.pageStatistics = pageStats;
 
+            totalValues += numValues;
+            totalUncompressedSize += pageBuffer.size();
+
             pages.push_back(std::move(pageBuffer));
             columnMetaData.pageHeaders.push_back(std::move(pageHeader));
 
-            totalValues += numValues;
-            totalUncompressedSize += bytesInPage;
-
             startIndex = endIndex;
         }
 
@@ -78,6 +412,45 @@ namespace wisent::algorithms
         return pages;
     };
 
+    Result<std::vector<int64_t>> decodeIntPage(
+        const std::vector<uint8_t>& page,
+        EncodingType encodingType
+    ) {
+        if (encodingType == EncodingType::AUTO) 
+        {
+            // the page's own encoding comes first; it is never AUTO again
+            if (page.empty() || page[0] == static_cast<uint8_t>(EncodingType::AUTO)) 
+            {
+                return makeError<std::vector<int64_t>>("decodeIntPage: corrupt page encoding");
+            }
+            return decodeIntPage(
+                std::vector<uint8_t>(page.begin() + 1, page.end()), 
+                static_cast<EncodingType>(page[0])
+            );
+        }
+        if (encodingType == EncodingType::DELTA_BINARY_PACKED) 
+        {
+            return DeltaBinaryPacked::decode(page);
+        }
+        if (encodingType == EncodingType::BIT_PACKED) 
+        {
+            return BitPacking::decode(page);
+        }
+        if (encodingType == EncodingType::FRAME_OF_REFERENCE || encodingType == EncodingType::PATCHED_FRAME_OF_REFERENCE) 
+        {
+            return decodeFrameOfReference(page, encodingType == EncodingType::PATCHED_FRAME_OF_REFERENCE);
+        }
+        if (encodingType != EncodingType::PLAIN || page.size() % SIZE_OF_INT64 != 0) 
+        {
+            return makeError<std::vector<int64_t>>("decodeIntPage: not an int64 page of a supported encoding");
+        }
+        Result<std::vector<int64_t>> result;
+        std::vector<int64_t> values(page.size() / SIZE_OF_INT64);
+        memcpy(values.data(), page.data(), page.size());
+        result.value = std::move(values);
+        return result;
+    }
+
     std::vector<std::vector<uint8_t>> encodeDoubleColumn(
         const std::vector<double>& column,
         ColumnMetaData& columnMetaData
@@ -220,7 +593,8 @@ namespace wisent::algorithms
 
     std::vector<uint8_t> performCompression(
         CompressionType type,
-        const std::vector<uint8_t>& buffer
+        const std::vector<uint8_t>& buffer,
+        PageCodecState* state
     ) {
         switch (type) 
         {
@@ -237,6 +611,13 @@ namespace wisent::algorithms
                     buffer
                 );
             case CompressionType::FSE:
+                if (state != nullptr) 
+                {
+                    return compressWith<FSE>(
+                        buffer, 
+                        state->fse
+                    );
+                }
                 return compressWith<FSE>(
                     buffer
                 );
@@ -244,6 +625,18 @@ namespace wisent::algorithms
                 return compressWith<Huffman>(
                     buffer
                 );
+            case CompressionType::RLE_INT64:
+                return compressWith<RLEInt64>(
+                    buffer
+                );
+            case CompressionType::RLE_DOUBLE:
+                return compressWith<RLEDouble>(
+                    buffer
+                );
+            case CompressionType::RLE_STRING:
+                return compressWith<RLEString>(
+                    buffer
+                );
             default:
                 throw std::invalid_argument("Unsupported compression type");
         }
@@ -251,7 +644,8 @@ namespace wisent::algorithms
 
     std::vector<uint8_t> performDecompression(
         CompressionType type,
-        const std::vector<uint8_t>& buffer
+        const std::vector<uint8_t>& buffer,
+        PageCodecState* state
     ) {
         switch (type) 
         {
@@ -268,6 +662,13 @@ namespace wisent::algorithms
                     buffer
                 );
             case CompressionType::FSE:
+                if (state != nullptr) 
+                {
+                    return decompressWith<FSE>(
+                        buffer, 
+                        state->fse
+                    );
+                }
                 return decompressWith<FSE>(
                     buffer
                 );
@@ -275,6 +676,18 @@ namespace wisent::algorithms
                 return decompressWith<Huffman>(
                     buffer
                 );
+            case CompressionType::RLE_INT64:
+                return decompressWith<RLEInt64>(
+                    buffer
+                );
+            case CompressionType::RLE_DOUBLE:
+                return decompressWith<RLEDouble>(
+                    buffer
+                );
+            case CompressionType::RLE_STRING:
+                return decompressWith<RLEString>(
+                    buffer
+                );
             default:
                 throw std::invalid_argument("Unsupported compression type");
         }
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <stdexcept>
 #include <optional>
+#include "FSE.hpp"
 
 namespace wisent::algorithms
 {
@@ -71,6 +72,9 @@ namespace wisent::algorithms
         DELTA_BINARY_PACKED,        // 4
         DELTA_LENGTH_BYTE_ARRAY,    // 5
         DELTA_BYTE_ARRAY,           // 6 
+        FRAME_OF_REFERENCE,         // 7
+        PATCHED_FRAME_OF_REFERENCE, // 8
+        AUTO,                       // 9    each int page picks one of the above
     };
 
     enum class PhysicalType : size_t {
@@ -90,7 +94,11 @@ namespace wisent::algorithms
         LZ77,
         HUFFMAN,
         FSE, 
-        CUSTOM
+        CUSTOM,
+        // typed RLE over the values of PLAIN pages (the numbers above are persisted)
+        RLE_INT64,
+        RLE_DOUBLE,
+        RLE_STRING
     };
 
     // (excluding page header expressions)
@@ -130,9 +138,19 @@ namespace wisent::algorithms
         return pages;
     }; 
 
+    // int pages are PLAIN, BIT_PACKED, DELTA_BINARY_PACKED, FRAME_OF_REFERENCE or
+    // PATCHED_FRAME_OF_REFERENCE; other encodings fall back to PLAIN. AUTO pages
+    // pick the smallest of these from their statistics and start with its byte
     std::vector<std::vector<uint8_t>> encodeIntColumn(
         const std::vector<int64_t>& column,
-        ColumnMetaData& columnChunkMetaData
+        ColumnMetaData& columnChunkMetaData,
+        EncodingType encodingType = EncodingType::PLAIN
+    ); 
+
+    // the values of a page of encodeIntColumn, once decompressed
+    Result<std::vector<int64_t>> decodeIntPage(
+        const std::vector<uint8_t>& page,
+        EncodingType encodingType
     ); 
 
     std::vector<std::vector<uint8_t>> encodeDoubleColumn(
@@ -145,6 +163,21 @@ namespace wisent::algorithms
         ColumnMetaData& columnChunkMetaData
     ); 
 
+    // pipeline steps that name an encoding choose how int columns are encoded
+    static const std::unordered_map<std::string, EncodingType> encodingAliases = 
+    {
+        {"plain", EncodingType::PLAIN},
+        {"bit_packed", EncodingType::BIT_PACKED},
+        {"bitpacked", EncodingType::BIT_PACKED},
+        {"delta_binary_packed", EncodingType::DELTA_BINARY_PACKED},
+        {"deltabinarypacked", EncodingType::DELTA_BINARY_PACKED},
+        {"frame_of_reference", EncodingType::FRAME_OF_REFERENCE},
+        {"for", EncodingType::FRAME_OF_REFERENCE},
+        {"patched_frame_of_reference", EncodingType::PATCHED_FRAME_OF_REFERENCE},
+        {"pfor", EncodingType::PATCHED_FRAME_OF_REFERENCE},
+        {"auto", EncodingType::AUTO}
+    };
+
     // =================== Compression algorithms ===================
     
     static const std::unordered_map<std::string, CompressionType> compressionAliases = 
@@ -158,7 +191,11 @@ namespace wisent::algorithms
         {"finitestateentropy", CompressionType::FSE},
         {"delta", CompressionType::DELTA},
         {"de", CompressionType::DELTA}, 
-        {"custom", CompressionType::CUSTOM}
+        {"custom", CompressionType::CUSTOM},
+        {"rle_int64", CompressionType::RLE_INT64},
+        {"rle_double", CompressionType::RLE_DOUBLE},
+        {"rle_string", CompressionType::RLE_STRING},
+        {"rle_dictionary", CompressionType::RLE_STRING}
     };
 
     static const std::unordered_map<CompressionType, std::string> compressionTypeNames = 
@@ -169,7 +206,10 @@ namespace wisent::algorithms
         {CompressionType::LZ77, "lz77"},
         {CompressionType::FSE, "fse"},
         {CompressionType::DELTA, "delta"}, 
-        {CompressionType::CUSTOM, "custom"}
+        {CompressionType::CUSTOM, "custom"},
+        {CompressionType::RLE_INT64, "rle_int64"},
+        {CompressionType::RLE_DOUBLE, "rle_double"},
+        {CompressionType::RLE_STRING, "rle_string"}
     };
 
     static std::string compressionTypeToString(CompressionType type)
@@ -188,11 +228,18 @@ namespace wisent::algorithms
         return it->second;
     }; 
 
-    template <typename codec>
+    // what the codecs carry from one page of a column to the next
+    struct PageCodecState 
+    {
+        FSE::RepeatState fse;
+    };
+
+    template <typename codec, typename... Arguments>
     std::vector<uint8_t> compressWith(
-        std::vector<uint8_t> const &data
+        std::vector<uint8_t> const &data, 
+        Arguments&... arguments
     ) {
-        auto result = codec::compress(data);
+        auto result = codec::compress(data, arguments...);
 
         if (!result.success()) 
         {
@@ -202,16 +249,19 @@ namespace wisent::algorithms
         return result.getValue();
     }; 
 
+    // pages of a column compressed with one state decompress with one state, in order
     std::vector<uint8_t> performCompression(
         CompressionType type,
-        const std::vector<uint8_t>& buffer
+        const std::vector<uint8_t>& buffer,
+        PageCodecState* state = nullptr
     ); 
 
-    template <typename codec>
+    template <typename codec, typename... Arguments>
     std::vector<uint8_t> decompressWith(
-        std::vector<uint8_t> const &data
+        std::vector<uint8_t> const &data, 
+        Arguments&... arguments
     ) {
-        auto result = codec::decompress(data);
+        auto result = codec::decompress(data, arguments...);
 
         if (!result.success()) 
         {
@@ -223,6 +273,7 @@ namespace wisent::algorithms
 
     std::vector<uint8_t> performDecompression(
         CompressionType type,
-        const std::vector<uint8_t>& buffer
+        const std::vector<uint8_t>& buffer,
+        PageCodecState* state = nullptr
     ); 
 }
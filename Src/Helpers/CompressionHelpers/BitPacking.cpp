@@ -1,79 +1,253 @@
 #include "BitPacking.hpp"
-#include <stdexcept>
-
-uint8_t wisent::algorithms::BitPacking::requiredBits(int64_t maxValue) 
+#include "Varint.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITPACKING_AVX2 1
+#endif
+
+namespace
 {
-    if (maxValue < 0) 
-        throw std::invalid_argument("BitPacking only supports non-negative values.");
-
-    return (maxValue == 0) 
-            ? 1 
-            : static_cast<uint8_t>(std::ceil(std::log2(maxValue + 1)));
-}
+    using wisent::algorithms::BitPacking;
 
-std::vector<uint8_t> wisent::algorithms::BitPacking::pack(
-    const std::vector<int64_t>& values, 
-    uint8_t bitsPerValue
-) {
-    if (bitsPerValue > 64 || bitsPerValue == 0)
-        throw std::invalid_argument("bitsPerValue must be between 1 and 64");
+    using PackKernel = void (*)(const uint64_t*, uint8_t*);
+    using UnpackKernel = void (*)(const uint8_t*, uint64_t*);
 
-    std::vector<uint8_t> output;
-    uint64_t bitBuffer = 0;
-    uint8_t bitCount = 0;
+    constexpr uint64_t widthMask(unsigned width)
+    {
+        return width == 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1;
+    }
 
-    for (int64_t value : values) 
+    template <unsigned Width>
+    void packGroup(const uint64_t* values, uint8_t* output)
     {
-        if (value < 0 || (static_cast<uint64_t>(value) >> bitsPerValue))
-            throw std::invalid_argument("Value too large for specified bit width");
+        if constexpr (Width > 0)
+        {
+            uint64_t buffer = 0;
+#pragma GCC unroll 32
+            for (unsigned i = 0; i < BitPacking::GROUP_SIZE; i++)
+            {
+                const uint64_t value = values[i] & widthMask(Width);
+                const unsigned used = i * Width % 64;
+                buffer |= value << used;
+                if (used + Width >= 64)
+                {
+                    memcpy(output, &buffer, sizeof(buffer));
+                    output += sizeof(buffer);
+                    buffer = used + Width > 64 ? value >> ((64 - used) % 64) : 0;
+                }
+            }
+            // 32 * Width bits end half way into a word for odd widths
+            if (BitPacking::GROUP_SIZE * Width % 64 != 0)
+            {
+                memcpy(output, &buffer, 4);
+            }
+        }
+    }
 
-        bitBuffer = (bitBuffer << bitsPerValue) | static_cast<uint64_t>(value);
-        bitCount += bitsPerValue;
+    template <unsigned Width>
+    void unpackGroup(const uint8_t* input, uint64_t* values)
+    {
+#pragma GCC unroll 32
+        for (unsigned i = 0; i < BitPacking::GROUP_SIZE; i++)
+        {
+            const unsigned bit = i * Width;
+            const unsigned shift = bit % 8;
+            uint64_t low;
+            memcpy(&low, input + bit / 8, sizeof(low));
+            uint64_t value = low >> shift;
+            if (shift + Width > 64)
+            {
+                uint64_t high;
+                memcpy(&high, input + bit / 8 + sizeof(low), sizeof(high));
+                value |= high << ((64 - shift) % 64);
+            }
+            values[i] = value & widthMask(Width);
+        }
+    }
 
-        while (bitCount >= 8) 
+#ifdef BITPACKING_AVX2
+    /*
+     * Four values per step: the 8 dwords from the one holding the first value
+     * are permuted so every 64-bit lane holds the two dwords its value starts
+     * in, then shifted and masked. A value of at most 32 bits starting
+     * anywhere in a dword always ends in the next one.
+     */
+    template <unsigned Width>
+    __attribute__((target("avx2"))) void unpackGroupAvx2(const uint8_t* input, uint64_t* values)
+    {
+        const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(widthMask(Width)));
+#pragma GCC unroll 8
+        for (unsigned step = 0; step < BitPacking::GROUP_SIZE / 4; step++)
         {
-            bitCount -= 8;
-            output.push_back(static_cast<uint8_t>((bitBuffer >> bitCount) & 0xFF));
+            const unsigned firstBit = 4 * step * Width;
+            const unsigned offset = firstBit % 32;
+            unsigned dwords[4];
+            unsigned shifts[4];
+            for (unsigned lane = 0; lane < 4; lane++)
+            {
+                dwords[lane] = (offset + lane * Width) / 32;
+                shifts[lane] = (offset + lane * Width) % 32;
+            }
+            const __m256i words = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(input + firstBit / 32 * 4)
+            );
+            const __m256i permutation = _mm256_setr_epi32(
+                dwords[0], dwords[0] + 1, dwords[1], dwords[1] + 1,
+                dwords[2], dwords[2] + 1, dwords[3], dwords[3] + 1
+            );
+            const __m256i shiftCounts = _mm256_setr_epi64x(shifts[0], shifts[1], shifts[2], shifts[3]);
+            __m256i lanes = _mm256_permutevar8x32_epi32(words, permutation);
+            lanes = _mm256_and_si256(_mm256_srlv_epi64(lanes, shiftCounts), mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(values + 4 * step), lanes);
         }
     }
+#endif
 
-    if (bitCount > 0) 
+    template <size_t... Widths>
+    std::array<PackKernel, sizeof...(Widths)> makePackKernels(std::index_sequence<Widths...>)
     {
-        output.push_back(static_cast<uint8_t>((bitBuffer << (8 - bitCount)) & 0xFF));
+        return {&packGroup<Widths>...};
     }
 
-    return output;
+#ifdef BITPACKING_AVX2
+    template <size_t... Widths>
+    std::array<UnpackKernel, sizeof...(Widths)> makeAvx2UnpackKernels(std::index_sequence<Widths...>)
+    {
+        return {&unpackGroupAvx2<Widths>...};
+    }
+#endif
+
+    template <size_t... Widths>
+    std::array<UnpackKernel, sizeof...(Widths)> makeUnpackKernels(std::index_sequence<Widths...>)
+    {
+        std::array<UnpackKernel, sizeof...(Widths)> kernels = {&unpackGroup<Widths>...};
+#ifdef BITPACKING_AVX2
+        __builtin_cpu_init();   // this runs during static initialisation
+        if (__builtin_cpu_supports("avx2"))
+        {
+            const auto avx2Kernels = makeAvx2UnpackKernels(std::make_index_sequence<33>());
+            std::copy(avx2Kernels.begin() + 1, avx2Kernels.end(), kernels.begin() + 1);
+        }
+#endif
+        return kernels;
+    }
+
+    const std::array<PackKernel, 65> packKernels = makePackKernels(std::make_index_sequence<65>());
+    const std::array<UnpackKernel, 65> unpackKernels = makeUnpackKernels(std::make_index_sequence<65>());
 }
 
-std::vector<int64_t> wisent::algorithms::BitPacking::unpack(
-    const std::vector<uint8_t>& buffer, 
-    size_t valueCount, 
-    uint8_t bitsPerValue
+uint8_t wisent::algorithms::BitPacking::requiredBits(uint64_t maxValue)
+{
+    return maxValue == 0 ? 0 : static_cast<uint8_t>(64 - __builtin_clzll(maxValue));
+}
+
+void wisent::algorithms::BitPacking::pack(
+    const uint64_t* values,
+    size_t count,
+    uint8_t bitWidth,
+    uint8_t* output
 ) {
-    if (bitsPerValue > 64 || bitsPerValue == 0)
-        throw std::invalid_argument("bitsPerValue must be between 1 and 64");
+    const PackKernel kernel = packKernels[bitWidth];
+    for (size_t group = 0; group < count / GROUP_SIZE; group++)
+    {
+        kernel(values + group * GROUP_SIZE, output + packedSize(group * GROUP_SIZE, bitWidth));
+    }
+}
 
-    std::vector<int64_t> output;
-    uint64_t bitBuffer = 0;
-    uint8_t bitCount = 0;
-    size_t byteIndex = 0;
+void wisent::algorithms::BitPacking::unpack(
+    const uint8_t* input,
+    size_t count,
+    uint8_t bitWidth,
+    uint64_t* values
+) {
+    const UnpackKernel kernel = unpackKernels[bitWidth];
+    for (size_t group = 0; group < count / GROUP_SIZE; group++)
+    {
+        kernel(input + packedSize(group * GROUP_SIZE, bitWidth), values + group * GROUP_SIZE);
+    }
+}
+
+std::vector<uint8_t> wisent::algorithms::BitPacking::encode(const int64_t* values, size_t count)
+{
+    std::vector<uint8_t> output;
+    writeVarint(output, count);
 
-    for (size_t i = 0; i < valueCount; ++i) 
+    uint64_t block[BLOCK_SIZE];
+    for (size_t start = 0; start < count; start += BLOCK_SIZE)
     {
-        while (bitCount < bitsPerValue && byteIndex < buffer.size()) 
+        const size_t blockCount = std::min(BLOCK_SIZE, count - start);
+        uint64_t bits = 0;
+        for (size_t i = 0; i < blockCount; i++)
         {
-            bitBuffer = (bitBuffer << 8) | buffer[byteIndex++];
-            bitCount += 8;
+            block[i] = zigzag(values[start + i]);
+            bits |= block[i];
         }
+        std::fill(block + blockCount, block + BLOCK_SIZE, 0);
 
-        if (bitCount < bitsPerValue)
-            throw std::runtime_error("Not enough bits to unpack");
-
-        bitCount -= bitsPerValue;
-        int64_t value = static_cast<int64_t>((bitBuffer >> bitCount) & ((1ULL << bitsPerValue) - 1));
-        output.push_back(value);
+        const uint8_t width = requiredBits(bits);
+        output.push_back(width);
+        size_t position = output.size();
+        output.resize(position + packedSize(BLOCK_SIZE, width));
+        pack(block, BLOCK_SIZE, width, output.data() + position);
     }
-
     return output;
 }
 
+Result<std::vector<int64_t>> wisent::algorithms::BitPacking::decode(const std::vector<uint8_t>& input)
+{
+    Result<std::vector<int64_t>> result;
+    const uint8_t* position = input.data();
+    const uint8_t* end = position + input.size();
+    uint64_t count;
+    // every block takes at least its width byte
+    if (!readVarint(position, end, count) || count / BLOCK_SIZE + (count % BLOCK_SIZE != 0) > static_cast<uint64_t>(end - position))
+        return makeError<std::vector<int64_t>>("BitPacking: corrupt header");
+    if (count > MAX_DECOMPRESSED_SIZE / sizeof(int64_t))
+        return makeError<std::vector<int64_t>>("BitPacking: decompressed size exceeds limit");
+
+    std::vector<int64_t> output(count);
+    uint64_t block[BLOCK_SIZE];
+    uint8_t padded[BLOCK_SIZE / 8 * 64 + READ_PADDING];
+    for (size_t start = 0; start < count; start += BLOCK_SIZE)
+    {
+        if (position == end)
+            return makeError<std::vector<int64_t>>("BitPacking: truncated page");
+        const uint8_t width = *position++;
+        const size_t bytes = packedSize(BLOCK_SIZE, width);
+        if (width > 64 || static_cast<size_t>(end - position) < bytes)
+            return makeError<std::vector<int64_t>>("BitPacking: corrupt block");
+
+        const uint8_t* source = position;
+        if (static_cast<size_t>(end - position) < bytes + READ_PADDING)
+        {
+            // the last blocks of the page: unpack from a copy with slack
+            memcpy(padded, position, bytes);
+            std::fill(padded + bytes, padded + sizeof(padded), 0);
+            source = padded;
+        }
+        position += bytes;
+
+        // int64_t and uint64_t may alias: full blocks decode in place
+        const size_t blockCount = std::min<uint64_t>(BLOCK_SIZE, count - start);
+        uint64_t* values = blockCount == BLOCK_SIZE ? reinterpret_cast<uint64_t*>(output.data() + start) : block;
+        unpack(source, BLOCK_SIZE, width, values);
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+        {
+            values[i] = static_cast<uint64_t>(unzigzag(values[i]));
+        }
+        if (values == block)
+        {
+            memcpy(output.data() + start, block, blockCount * sizeof(uint64_t));
+        }
+    }
+    if (position != end)
+        return makeError<std::vector<int64_t>>("BitPacking: trailing bytes after the last block");
+
+    result.value = std::move(output);
+    return result;
+}
@@ -2,27 +2,65 @@
 #ifndef BITPACKING_HPP
 #define BITPACKING_HPP
 
+#include "../../Helpers/Result.hpp"
+#include <cstddef>
 #include <cstdint>
 #include <vector>
-#include <cmath>
 
 namespace wisent::algorithms
 {
     struct BitPacking
     {
-        static uint8_t requiredBits(int64_t maxValue);
-        
-        static std::vector<uint8_t> pack(
-            const std::vector<int64_t>& values, 
-            uint8_t bitsPerValue
+        /*
+         * Kernels: values of bitWidth bits packed LSB first, in groups of 32
+         * (4 * bitWidth bytes, so every group starts on a byte). There is one
+         * kernel per width from 0 to 64; unpacking widths up to 32 uses AVX2
+         * shifts and masks when the CPU has them, the rest are scalar.
+         */
+        static constexpr size_t GROUP_SIZE = 32;
+        // unpack() reads up to this many bytes past the packed values
+        static constexpr size_t READ_PADDING = 32;
+
+        static uint8_t requiredBits(uint64_t maxValue);
+
+        static size_t packedSize(size_t count, uint8_t bitWidth)
+        {
+            return count / 8 * bitWidth;
+        }
+
+        // count is a multiple of GROUP_SIZE; bits above bitWidth are dropped
+        static void pack(
+            const uint64_t* values,
+            size_t count,
+            uint8_t bitWidth,
+            uint8_t* output
+        );
+
+        static void unpack(
+            const uint8_t* input,
+            size_t count,
+            uint8_t bitWidth,
+            uint64_t* values
+        );
+
+        /*
+         * BIT_PACKED int64 pages: varint value count, then per block of 128
+         * values a width byte and the zigzagged values packed at that width
+         * (the last block is padded with zeros).
+         */
+        static constexpr size_t BLOCK_SIZE = 128;
+        // a block of width 0 takes one byte, so decode() caps the page as well
+        static constexpr uint64_t MAX_DECOMPRESSED_SIZE = uint64_t{1} << 30;
+
+        static std::vector<uint8_t> encode(
+            const int64_t* values,
+            size_t count
         );
 
-        static std::vector<int64_t> unpack(
-            const std::vector<uint8_t>& buffer, 
-            size_t valueCount, 
-            uint8_t bitsPerValue
+        static Result<std::vector<int64_t>> decode(
+            const std::vector<uint8_t>& input
         );
-    }; 
+    };
 }
 
 #endif // BITPACKING_HPP
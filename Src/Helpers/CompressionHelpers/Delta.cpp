@@ -1,8 +1,18 @@
 #include <vector>
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include "../Result.hpp"
 #include "Delta.hpp"
+#include "BitPacking.hpp"
+#include "Varint.hpp"
+
+namespace
+{
+    // miniblocks hold a multiple of 32 values
+    constexpr size_t MINIBLOCK_UNIT = wisent::algorithms::BitPacking::GROUP_SIZE;
+}
 
 Result<std::vector<uint8_t>> wisent::algorithms::DELTA::compress(const std::vector<uint8_t>& input) 
 {
@@ -41,3 +51,122 @@ Result<std::vector<uint8_t>> wisent::algorithms::DELTA::decompress(const std::ve
 
     return makeResult<std::vector<uint8_t>>(output, &result);
 }
+
+std::vector<uint8_t> wisent::algorithms::DeltaBinaryPacked::encode(const int64_t* values, size_t count) 
+{
+    constexpr size_t MINIBLOCK_SIZE = BLOCK_SIZE / MINIBLOCK_COUNT;
+    std::vector<uint8_t> output;
+    output.reserve(16 + count / 2);
+    writeVarint(output, BLOCK_SIZE);
+    writeVarint(output, MINIBLOCK_COUNT);
+    writeVarint(output, count);
+    writeVarint(output, zigzag(count > 0 ? values[0] : 0));
+
+    uint64_t deltas[BLOCK_SIZE];
+    for (size_t start = 1; start < count; start += BLOCK_SIZE) {
+        const size_t blockCount = std::min(BLOCK_SIZE, count - start);
+        int64_t minDelta = INT64_MAX;
+        for (size_t i = 0; i < blockCount; i++) {
+            // wrapping differences: any pair of int64 values round-trips
+            deltas[i] = static_cast<uint64_t>(values[start + i]) - static_cast<uint64_t>(values[start + i - 1]);
+            minDelta = std::min(minDelta, static_cast<int64_t>(deltas[i]));
+        }
+        for (size_t i = 0; i < blockCount; i++) {
+            deltas[i] -= static_cast<uint64_t>(minDelta);
+        }
+        std::fill(deltas + blockCount, deltas + BLOCK_SIZE, 0);
+
+        writeVarint(output, zigzag(minDelta));
+        uint8_t widths[MINIBLOCK_COUNT] = {};
+        for (size_t miniblock = 0; miniblock * MINIBLOCK_SIZE < blockCount; miniblock++) {
+            uint64_t bits = 0;
+            for (size_t i = 0; i < MINIBLOCK_SIZE; i++) {
+                bits |= deltas[miniblock * MINIBLOCK_SIZE + i];
+            }
+            widths[miniblock] = BitPacking::requiredBits(bits);
+        }
+        output.insert(output.end(), widths, widths + MINIBLOCK_COUNT);
+        for (size_t miniblock = 0; miniblock * MINIBLOCK_SIZE < blockCount; miniblock++) {
+            size_t position = output.size();
+            output.resize(position + BitPacking::packedSize(MINIBLOCK_SIZE, widths[miniblock]));
+            BitPacking::pack(deltas + miniblock * MINIBLOCK_SIZE, MINIBLOCK_SIZE, widths[miniblock], output.data() + position);
+        }
+    }
+    return output;
+}
+
+Result<std::vector<int64_t>> wisent::algorithms::DeltaBinaryPacked::decode(const std::vector<uint8_t>& input) 
+{
+    Result<std::vector<int64_t>> result;
+    const uint8_t* position = input.data();
+    const uint8_t* end = position + input.size();
+    uint64_t blockSize, miniblockCount, count, first;
+    if (!readVarint(position, end, blockSize) || !readVarint(position, end, miniblockCount)
+        || !readVarint(position, end, count) || !readVarint(position, end, first)
+        || blockSize != BLOCK_SIZE || miniblockCount != MINIBLOCK_COUNT) {
+        return makeError<std::vector<int64_t>>("DeltaBinaryPacked: corrupt header");
+    }
+    // the block layout encode() writes, so the check below bounds the values per input byte
+    if (count > MAX_DECOMPRESSED_SIZE / sizeof(int64_t)) {
+        return makeError<std::vector<int64_t>>("DeltaBinaryPacked: value count exceeds the maximum decompressed size");
+    }
+    // every block takes at least its minimum delta and its width bytes
+    const uint64_t blocks = count > 1 ? (count - 2) / blockSize + 1 : 0;
+    if (blocks > static_cast<uint64_t>(end - position) / (1 + miniblockCount)) {
+        return makeError<std::vector<int64_t>>("DeltaBinaryPacked: value count exceeds the input");
+    }
+
+    const size_t miniblockSize = blockSize / miniblockCount;
+    std::vector<int64_t> output(count);
+    uint64_t unpacked[MINIBLOCK_UNIT];
+    uint8_t padded[MINIBLOCK_UNIT / 8 * 64 + BitPacking::READ_PADDING];
+    uint64_t current = static_cast<uint64_t>(unzigzag(first));
+    if (count > 0) {
+        output[0] = static_cast<int64_t>(current);
+    }
+    size_t decoded = 1;
+    while (decoded < count) {
+        uint64_t minDeltaZigzag;
+        if (!readVarint(position, end, minDeltaZigzag) || static_cast<size_t>(end - position) < miniblockCount) {
+            return makeError<std::vector<int64_t>>("DeltaBinaryPacked: corrupt block header");
+        }
+        const uint64_t minDelta = static_cast<uint64_t>(unzigzag(minDeltaZigzag));
+        const uint8_t* widths = position;
+        position += miniblockCount;
+
+        for (size_t miniblock = 0; miniblock < miniblockCount && decoded < count; miniblock++) {
+            const uint8_t width = widths[miniblock];
+            if (width > 64) {
+                return makeError<std::vector<int64_t>>("DeltaBinaryPacked: bit width above 64");
+            }
+            for (size_t unit = 0; unit < miniblockSize / MINIBLOCK_UNIT && decoded < count; unit++) {
+                const size_t bytes = BitPacking::packedSize(MINIBLOCK_UNIT, width);
+                if (static_cast<size_t>(end - position) < bytes) {
+                    return makeError<std::vector<int64_t>>("DeltaBinaryPacked: truncated miniblock");
+                }
+                const uint8_t* source = position;
+                if (static_cast<size_t>(end - position) < bytes + BitPacking::READ_PADDING) {
+                    // the last miniblocks of the page: unpack from a copy with slack
+                    memcpy(padded, position, bytes);
+                    std::fill(padded + bytes, padded + sizeof(padded), 0);
+                    source = padded;
+                }
+                BitPacking::unpack(source, MINIBLOCK_UNIT, width, unpacked);
+                position += bytes;
+
+                const size_t take = std::min<uint64_t>(MINIBLOCK_UNIT, count - decoded);
+                for (size_t i = 0; i < take; i++) {
+                    current += minDelta + unpacked[i];
+                    output[decoded + i] = static_cast<int64_t>(current);
+                }
+                decoded += take;
+            }
+        }
+    }
+    if (position != end) {
+        return makeError<std::vector<int64_t>>("DeltaBinaryPacked: trailing bytes after the last block");
+    }
+
+    result.value = std::move(output);
+    return result;
+}
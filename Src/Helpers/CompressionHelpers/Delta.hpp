@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../../Helpers/Result.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 namespace wisent::algorithms
 {
@@ -14,4 +17,34 @@ namespace wisent::algorithms
            const std::vector<uint8_t>& input
         );
     }; 
+
+    /*
+     * Parquet's DELTA_BINARY_PACKED encoding of int64 pages: the differences
+     * of adjacent values in blocks of 128, each block split into 4 miniblocks
+     * of 32 bit-packed (LSB first) at the width of their largest difference
+     * above the block's smallest. Sorted keys and dates take a few bits each.
+     *
+     *   header: varint block size, varint miniblocks per block, varint value
+     *           count, zigzag varint first value
+     *   block:  zigzag varint minimum delta, a width byte per miniblock, then
+     *           the miniblocks (the ones past the last value are left out)
+     *
+     * decode() takes the block layout encode() writes only, so every block
+     * costs at least a byte per 25 values and the count can't outgrow the page.
+     */
+    struct DeltaBinaryPacked
+    {
+        static constexpr size_t BLOCK_SIZE = 128;
+        static constexpr size_t MINIBLOCK_COUNT = 4;
+        static constexpr uint64_t MAX_DECOMPRESSED_SIZE = uint64_t{1} << 30;
+
+        static std::vector<uint8_t> encode(
+            const int64_t* values,
+            size_t count
+        );
+
+        static Result<std::vector<int64_t>> decode(
+            const std::vector<uint8_t>& input
+        );
+    };
 }
@@ -10,17 +10,47 @@
 */
 
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstring>
+#include <limits>
+#include <optional>
 #include <vector>
 #include <bitset>
 #include <iomanip>
 #include "FSE.hpp"
+#include "Varint.hpp"
+
+using wisent::algorithms::readVarint;
+using wisent::algorithms::writeVarint;
 
 const unsigned DefaultMaxSymbolValue = 255; 
 
 const unsigned DefaultTableLog = 11;
 const unsigned MinTablelog = 5; 
 const unsigned MaxTableLog = 15;
+// version 2: the decoder reads STATE_COUNT * tableLog bits per 57-bit refill
+const unsigned MaxInterleavedTableLog = 14;
+
+/*
+ * Version 2 page:
+ *   FORMAT_VERSION, table mode, varint symbol count n, then by mode
+ *   - Fresh:  tableLog - MinTablelog, varint entry count, per entry the
+ *             symbol and varint(normalized count + 1), symbols ascending;
+ *             then the bit stream
+ *   - Repeat: the bit stream, coded with the table of the previous page
+ *   - Single: the one symbol of the page (or of none, for n = 0)
+ * The bit stream is written forward and read backward: the codes of symbols
+ * n - 5 down to 0, symbol i by state i % 4, then states 3 to 0, then a 1 bit
+ * that marks the end. The last four symbols are the symbols of the states.
+ */
+enum class TableMode : uint8_t
+{
+    Fresh = 0,
+    Repeat = 1,
+    Single = 2
+};
 
 // ========== Compression ==========
 
@@ -38,6 +68,25 @@ struct CTable {
     std::vector<SymbolCompressionTransform> symbolTransformTable;
 };
 
+// one flat entry per state: 4 bytes, so the decoding table stays in L1
+struct SymbolDecompressionTransform {
+    uint16_t newState;
+    uint8_t symbol;
+    uint8_t numberOfBitsToRead;
+};
+
+struct wisent::algorithms::FSE::RepeatState::Tables {
+    unsigned tableLog;
+    std::vector<short> normalizedCounts;
+    std::optional<CTable> cTable;                       // built by the first page compressed with it
+    std::vector<SymbolDecompressionTransform> dTable;   // built by the first page decompressed with it
+};
+
+wisent::algorithms::FSE::RepeatState::RepeatState() = default;
+wisent::algorithms::FSE::RepeatState::~RepeatState() = default;
+wisent::algorithms::FSE::RepeatState::RepeatState(RepeatState&& other) noexcept = default;
+wisent::algorithms::FSE::RepeatState& wisent::algorithms::FSE::RepeatState::operator=(RepeatState&& other) noexcept = default;
+
 std::vector<unsigned> simpleCount(
     unsigned& maxSymbolValue,
     const std::vector<uint8_t>& input
@@ -60,7 +109,6 @@ std::vector<unsigned> parallelCount(
     const std::vector<uint8_t>& input
 ) {
     // std::cout << "Using parallel Count" << std::endl;
-    unsigned max = 0;
     std::vector<unsigned> count(maxSymbolValue + 1, 0);
     
     const uint8_t* ip = input.data();
@@ -114,8 +162,7 @@ static unsigned getHighestBitPosition(uint32_t val) {
 
 static unsigned getOptimalTableLog(
     unsigned maxTableLog, 
-    size_t inputSize, 
-    unsigned maxSymbolValue
+    size_t inputSize
 ) {
     unsigned maxBitsSrc = getHighestBitPosition(static_cast<uint32_t>(inputSize - 1));
     unsigned tableLog = maxTableLog;
@@ -194,28 +241,45 @@ std::vector<short> normalizeCount(
     return normalizedCounts;
 }
 
-void writeNormalizedCounts(
+void writeTable(
     std::vector<uint8_t>& compressed,
     const std::vector<short>& normalizedCounts, 
     unsigned maxSymbolValue, 
     unsigned tableLog
 ) {
     compressed.push_back(static_cast<uint8_t>(tableLog - MinTablelog));
-    compressed.push_back(static_cast<uint8_t>(maxSymbolValue));
+    size_t entries = std::count_if(normalizedCounts.begin(), normalizedCounts.begin() + maxSymbolValue + 1,
+        [](short count) { return count != 0; });
+    writeVarint(compressed, entries);
 
     for (unsigned symbol = 0; symbol <= maxSymbolValue; ++symbol) 
     {
         if (normalizedCounts[symbol] == 0) continue;
 
-        int count = normalizedCounts[symbol];
         compressed.push_back(static_cast<uint8_t>(symbol));
-        if (tableLog > 8) 
+        writeVarint(compressed, static_cast<uint64_t>(normalizedCounts[symbol] + 1));   // -1 (low probability) is 0
+    }
+}
+
+// bits to code the counted symbols with a table, infinite if it lacks one of them
+double estimateBits(
+    const std::vector<unsigned>& symbolCounts, 
+    unsigned maxSymbolValue, 
+    const std::vector<short>& normalizedCounts, 
+    unsigned tableLog
+) {
+    double bits = 0;
+    for (unsigned symbol = 0; symbol <= maxSymbolValue; ++symbol) 
+    {
+        if (symbolCounts[symbol] == 0) continue;
+        if (symbol >= normalizedCounts.size() || normalizedCounts[symbol] == 0) 
         {
-            compressed.push_back(static_cast<uint8_t>(count >> 8));
-            compressed.push_back(static_cast<uint8_t>(count & 0xFF));
+            return std::numeric_limits<double>::infinity();
         }
-        else compressed.push_back(static_cast<uint8_t>(count));
+        int probability = normalizedCounts[symbol] == -1 ? 1 : normalizedCounts[symbol];
+        bits += symbolCounts[symbol] * (tableLog - std::log2(probability));
     }
+    return bits;
 }
 
 void printNormalizedCounter(const std::vector<short>& normalizedCounts) 
@@ -353,18 +417,22 @@ void compressDataUsingCTable(
     const std::vector<uint8_t>& input, 
     const CTable& cTable
 ) {        
-    size_t inputSize = input.size();
-    size_t encodingPosition = inputSize;
+    constexpr size_t StateCount = wisent::algorithms::FSE::STATE_COUNT;
+    const size_t inputSize = input.size();
+    const size_t headerSize = compressed.size();
+    // at most tableLog bits per symbol and per state, the end mark, 8 bytes of slack
+    compressed.resize(headerSize + ((inputSize + StateCount) * cTable.tableLog + 1) / 8 + 16);
+    uint8_t* output = compressed.data() + headerSize;
     
     uint64_t bitContainer = 0;
     int bitPos = 0;
     
+    // whole bytes only; at most 7 + 4 * 14 bits are pending
     auto flushBits = [&]() {
-        while (bitPos >= 8) {
-            compressed.push_back(static_cast<uint8_t>(bitContainer));
-            bitContainer >>= 8;
-            bitPos -= 8;
-        }
+        memcpy(output, &bitContainer, sizeof(bitContainer));
+        output += bitPos >> 3;
+        bitContainer >>= bitPos & ~7;
+        bitPos &= 7;
     };
     
     auto outputBits = [&](uint32_t cState, uint32_t numberOfBitsToOutput) {
@@ -391,80 +459,89 @@ void compressDataUsingCTable(
         cState = cTable.stateTable[(cState >> numberOfBitsToOutput) + cTable.symbolTransformTable[nextSymbol].nextStateOffset];
     };
 
-    uint32_t CState1, CState2;
-    
-    // isOdd(inputSize) ? true : false    // check last bit
-    if (inputSize & 1) {    
-        initCState(CState1, input[--encodingPosition]); 
-        initCState(CState2, input[--encodingPosition]);
-        encodeSymbol(CState1, input[--encodingPosition]); 
-        flushBits();
-    } 
-    else {
-        initCState(CState2, input[--encodingPosition]);
-        initCState(CState1, input[--encodingPosition]);
+    // symbol i belongs to state i % 4: the last symbol of each state starts it
+    std::array<uint32_t, StateCount> cStates{};
+    const size_t stateCount = std::min(inputSize, StateCount);
+    size_t encodingPosition = inputSize;
+    while (encodingPosition > inputSize - stateCount) 
+    {
+        --encodingPosition;
+        initCState(cStates[encodingPosition % StateCount], input[encodingPosition]);
     }
-    inputSize -= 2;  
 
-    // ensure the rest number of symbols % 4 = 0   // check 2nd last bit 
-    if ((sizeof(bitContainer) * 8 > cTable.tableLog * 4 + 7) && (inputSize & 2)) 
+    // the rest, in whole rounds of 4 symbols
+    while (encodingPosition % StateCount != 0) 
     {
-        encodeSymbol(CState2, input[--encodingPosition]);
-        encodeSymbol(CState1, input[--encodingPosition]);
-        flushBits();
+        --encodingPosition;
+        encodeSymbol(cStates[encodingPosition % StateCount], input[encodingPosition]);
     }
-    
-    // encode 4 symbols each loop
-    while (encodingPosition > 3) 
+    flushBits();
+    uint32_t CState1 = cStates[0], CState2 = cStates[1], CState3 = cStates[2], CState4 = cStates[3];
+    while (encodingPosition > 0) 
     {
-        encodeSymbol(CState2, input[--encodingPosition]);
-
-        if (sizeof(bitContainer) * 8 < cTable.tableLog * 2 + 7) { // if (tableLog > 29) 
-            flushBits();
-        }
-        
-        encodeSymbol(CState1, input[--encodingPosition]);
-
-        if (sizeof(bitContainer) * 8 > cTable.tableLog * 4 + 7) { // if (tableLog < 15) 
-            encodeSymbol(CState2, input[--encodingPosition]);
-            encodeSymbol(CState1, input[--encodingPosition]);
-        }
+        encodingPosition -= StateCount;
+        encodeSymbol(CState4, input[encodingPosition + 3]);
+        encodeSymbol(CState3, input[encodingPosition + 2]);
+        encodeSymbol(CState2, input[encodingPosition + 1]);
+        encodeSymbol(CState1, input[encodingPosition]);
         flushBits();
     }
+    cStates = {CState1, CState2, CState3, CState4};
 
-    outputBits(CState2, cTable.tableLog);
-    outputBits(CState1, cTable.tableLog);
+    // the decoder reads state 0 first
+    for (size_t state = stateCount; state-- > 0; ) 
+    {
+        outputBits(cStates[state], cTable.tableLog);
+    }
+    flushBits();
 
     outputBits(1, 1); // endmark
     flushBits();
-    
-    if (bitPos > 0) {
-        compressed.push_back(static_cast<uint8_t>(bitContainer));
-    }
+    output += bitPos > 0 ? 1 : 0;
+    compressed.resize(output - compressed.data());
+}
+
+Result<std::vector<uint8_t>> wisent::algorithms::FSE::compress(
+    const std::vector<uint8_t>& input, 
+    bool verbose
+) { 
+    RepeatState repeatState;
+    return compress(input, repeatState, verbose);
 }
 
 Result<std::vector<uint8_t>> wisent::algorithms::FSE::compress(
     const std::vector<uint8_t>& input, 
+    RepeatState& repeatState,
     bool verbose
 ) { 
     Result<std::vector<uint8_t>> result; 
     std::vector<uint8_t> compressed;
+    compressed.push_back(FORMAT_VERSION);
+    compressed.push_back(static_cast<uint8_t>(TableMode::Fresh));
+    writeVarint(compressed, input.size());
 
     //  1. Count all symbols
     unsigned maxSymbolValue = DefaultMaxSymbolValue; 
-    const std::vector<unsigned> count = countSymbols(
-        maxSymbolValue, 
-        input
-    );
+    const std::vector<unsigned> count = input.empty() 
+        ? std::vector<unsigned>() 
+        : countSymbols(maxSymbolValue, input);
+
+    // a single symbol needs no table (and has none: normalizeCount rejects it)
+    if (input.empty() || count[maxSymbolValue] == input.size()) 
+    {
+        compressed[1] = static_cast<uint8_t>(TableMode::Single);
+        compressed.push_back(input.empty() ? 0 : input[0]);
+        result.value = std::move(compressed);
+        return result;
+    }
 
     //  2. Normalize symbol frequencies
     unsigned optimalTableLog = getOptimalTableLog(
         DefaultTableLog, 
-        input.size(), 
-        maxSymbolValue
+        input.size()
     );
 
-    const std::vector<short> normalizedCounts = normalizeCount(
+    std::vector<short> normalizedCounts = normalizeCount(
         optimalTableLog, 
         count, 
         input.size(), 
@@ -473,64 +550,139 @@ Result<std::vector<uint8_t>> wisent::algorithms::FSE::compress(
 
     if (verbose) printNormalizedCounter(normalizedCounts);
 
-    writeNormalizedCounts(
-        compressed,
+    //  3. Repeat the previous table when coding with it costs less extra bits 
+    //     (the Kullback-Leibler divergence of the histograms, times the size)
+    //     than a header of its own
+    std::vector<uint8_t> table;
+    writeTable(
+        table,
         normalizedCounts, 
         maxSymbolValue, 
         optimalTableLog
     );
+    RepeatState::Tables* previous = repeatState.tables.get();
+    bool repeat = previous != nullptr 
+        && estimateBits(count, maxSymbolValue, previous->normalizedCounts, previous->tableLog)
+            <= estimateBits(count, maxSymbolValue, normalizedCounts, optimalTableLog) + 8.0 * table.size();
+    if (repeat) 
+    {
+        compressed[1] = static_cast<uint8_t>(TableMode::Repeat);
+    }
+    else 
+    {
+        repeatState.tables = std::make_unique<RepeatState::Tables>();
+        repeatState.tables->tableLog = optimalTableLog;
+        repeatState.tables->normalizedCounts = std::move(normalizedCounts);
+        compressed.insert(compressed.end(), table.begin(), table.end());
+    }
 
-    //  3. Build FSE CTable
-    CTable cTable = buildCTable(
-        normalizedCounts, 
-        maxSymbolValue, 
-        optimalTableLog
-    );
+    //  4. Build FSE CTable, once per table
+    RepeatState::Tables& tables = *repeatState.tables;
+    if (!tables.cTable) 
+    {
+        tables.cTable = buildCTable(
+            tables.normalizedCounts, 
+            tables.normalizedCounts.size() - 1, 
+            tables.tableLog
+        );
+    }
 
-    if (verbose) printCTable(cTable);
+    if (verbose) printCTable(*tables.cTable);
 
-    // 4. Compress 
+    // 5. Compress 
     compressDataUsingCTable(
         compressed, 
         input, 
-        cTable
+        *tables.cTable
     );
 
-    result.setValue(compressed);
+    result.value = std::move(compressed);
     return result;
 }
 
 // ========== Decompression ==========
 
-struct SymbolDecompressionTransform {
-    uint16_t newState;
-    uint8_t symbol;
-    uint8_t numberOfBitsToRead;
-};
-
-std::vector<int16_t> readNormalizedCount(
+// the version 1 table header; false if it runs past the input, or unless
+// its counts, one entry per symbol up to maxSymbolValue, fill the table
+// exactly. A single symbol filling the whole table is rejected as well: its
+// states read no bits, so decoding would never reach the end of the stream
+bool readNormalizedCount(
     unsigned& maxSymbolValue, 
     unsigned& tableLog, 
     const std::vector<uint8_t>& compressed, 
-    int& normalizeCounterOffset
+    int& normalizeCounterOffset, 
+    std::vector<int16_t>& normalizedCounts
 ) {
+    if (compressed.size() < 2) return false;
     tableLog = compressed[normalizeCounterOffset++] + MinTablelog;
     maxSymbolValue = compressed[normalizeCounterOffset++];
-    std::vector<int16_t> normalizedCounts(maxSymbolValue + 1, 0);
+    if (tableLog > MaxTableLog) return false;
+    normalizedCounts.assign(maxSymbolValue + 1, 0);
+
+    const size_t countBytes = tableLog > 8 ? 2 : 1;
+    const int64_t tableSize = int64_t{1} << tableLog;
+    int64_t total = 0;
+    int previousSymbol = -1;
+    while (previousSymbol < static_cast<int>(maxSymbolValue)) 
+    {
+        if (compressed.size() - normalizeCounterOffset < 1 + countBytes) return false;
+        int symbol = compressed[normalizeCounterOffset++];
+        if (symbol <= previousSymbol || symbol > static_cast<int>(maxSymbolValue)) return false;
+        int16_t count;
+        if (countBytes == 2) 
+        {
+            count = static_cast<int16_t>((compressed[normalizeCounterOffset] << 8) + compressed[normalizeCounterOffset + 1]); 
+        }
+        else 
+        {
+            // one byte: -1 was written as 0xFF
+            uint8_t byte = compressed[normalizeCounterOffset];
+            count = byte == 0xFF ? -1 : static_cast<int16_t>(byte);
+        }
+        normalizeCounterOffset += countBytes;
+        if (count == 0 || count < -1 || count >= tableSize) return false;
+        normalizedCounts[symbol] = count;
+        total += count == -1 ? 1 : count;
+        previousSymbol = symbol;
+    }
+    return total == tableSize;
+}
 
-    const uint16_t maxCount = (tableLog <= 8) ? 0xFF : 0xFFFF;
+// the version 2 table header; false unless the counts fill the table exactly
+bool readTable(
+    const uint8_t*& position, 
+    const uint8_t* end, 
+    unsigned& tableLog, 
+    std::vector<short>& normalizedCounts
+) {
+    if (position == end) return false;
+    tableLog = *position++ + MinTablelog;
+    uint64_t entries;
+    if (tableLog > MaxInterleavedTableLog || !readVarint(position, end, entries) 
+        || entries == 0 || entries > DefaultMaxSymbolValue + 1) 
+    {
+        return false;
+    }
 
-    for (unsigned symbol = 0; symbol <= maxSymbolValue; ++symbol) 
+    normalizedCounts.assign(DefaultMaxSymbolValue + 1, 0);
+    const uint64_t tableSize = 1ULL << tableLog;
+    uint64_t total = 0;
+    int previousSymbol = -1;
+    for (uint64_t entry = 0; entry < entries; ++entry) 
     {
-        symbol = compressed[normalizeCounterOffset++];
-        if (tableLog > 8) {
-            normalizedCounts[symbol] = static_cast<int16_t>((compressed[normalizeCounterOffset] << 8) + compressed[normalizeCounterOffset + 1]); 
-            normalizeCounterOffset += 2;
+        uint64_t value;
+        if (position == end) return false;
+        int symbol = *position++;
+        if (symbol <= previousSymbol || !readVarint(position, end, value) || value == 1 || value > tableSize + 1) 
+        {
+            return false;
         }
-        else normalizedCounts[symbol] = static_cast<int16_t>(compressed[normalizeCounterOffset++]);
+        normalizedCounts[symbol] = static_cast<short>(static_cast<int64_t>(value) - 1);
+        total += value == 0 ? 1 : value - 1;
+        previousSymbol = symbol;
     }
-    
-    return normalizedCounts;
+    normalizedCounts.resize(previousSymbol + 1);
+    return total == tableSize;
 }
 
 static void buildDTable(
@@ -598,31 +750,34 @@ static void printDTable(const std::vector<SymbolDecompressionTransform>& dTable)
     }
 }
 
-std::vector<uint8_t> decompressDataUsingDTable(
+// false if the bit stream has no end mark or runs out mid-symbol
+bool decompressDataUsingDTable(
     const std::vector<uint8_t>& compressed, 
     const std::vector<SymbolDecompressionTransform>& dTable, 
     unsigned tableLog, 
-    unsigned maxSymbolValue, 
-    int normalizeCounterOffset
+    int normalizeCounterOffset, 
+    std::vector<uint8_t>& decompressed
 ) {
-    std::vector<uint8_t> decompressed;
-
+    constexpr int containerBits = sizeof(uint64_t) * 8;
     uint64_t bitContainer = 0;
     int bitPos = 0;
-    int decodingPosition = compressed.size() - 1;
+    int decodingPosition = static_cast<int>(compressed.size()) - 1;
+    bool truncated = false;
 
     auto initBitContainer = [&]() {
-        while (decodingPosition >= normalizeCounterOffset && bitPos < sizeof(bitContainer) * 8)
+        while (decodingPosition >= normalizeCounterOffset && bitPos < containerBits)
         {
             bitContainer <<= 8;
             bitContainer |= static_cast<uint64_t>(compressed[decodingPosition--]);
             bitPos += 8;
         }
-        while((bitContainer >> bitPos) != 1) bitPos--; // skip endmark
+        if (bitContainer == 0) return false;
+        while(bitPos >= 64 || (bitContainer >> bitPos) != 1) bitPos--; // skip endmark
+        return true;
     };
 
     auto reloadBitContainer = [&]() {
-        while (decodingPosition >= normalizeCounterOffset && bitPos < sizeof(bitContainer)* 8 - 8) 
+        while (decodingPosition >= normalizeCounterOffset && bitPos < containerBits - 8) 
         {
             bitContainer <<= 8;
             bitContainer |= static_cast<uint64_t>(compressed[decodingPosition--]);
@@ -631,6 +786,12 @@ std::vector<uint8_t> decompressDataUsingDTable(
     };
 
     auto readBits = [&](uint32_t numberOfBits) {
+        if (bitPos < static_cast<int>(numberOfBits)) 
+        {
+            truncated = true;
+            bitPos = 0;
+            return size_t{0};
+        }
         size_t value = (bitContainer >> (bitPos - numberOfBits)) & ((1U << numberOfBits) - 1);
         bitPos -= numberOfBits;
         return value;
@@ -643,20 +804,28 @@ std::vector<uint8_t> decompressDataUsingDTable(
         return decodedSymbol;
     };
 
-    initBitContainer(); 
+    if (!initBitContainer()) return false;
 
     size_t state1 = readBits(tableLog);
     size_t state2 = readBits(tableLog);
 
-    while (decodingPosition >= normalizeCounterOffset) 
+    while (decodingPosition >= normalizeCounterOffset && !truncated) 
     {
+        if (decompressed.size() >= wisent::algorithms::FSE::MAX_DECOMPRESSED_SIZE) 
+        {
+            return false;
+        }
         decompressed.push_back(decodeSymbol(state1));
         decompressed.push_back(decodeSymbol(state2));
         reloadBitContainer();
     }
 
-    while (bitPos > 0) 
+    while (bitPos > 0 && !truncated) 
     {
+        if (decompressed.size() >= wisent::algorithms::FSE::MAX_DECOMPRESSED_SIZE) 
+        {
+            return false;
+        }
         decompressed.push_back(decodeSymbol(state1));
         if (bitPos == 0) 
         {
@@ -672,10 +841,145 @@ std::vector<uint8_t> decompressDataUsingDTable(
         }
     }
 
-    return decompressed;
+    return !truncated;
 }
 
-Result<std::vector<uint8_t>> wisent::algorithms::FSE::decompress(
+/*
+ * Reads the bit stream backward from its end mark, 64 bits at a time: the
+ * container holds the 8 bytes at position, the bits are consumed from its
+ * top. Reads past the stream return zeros and show up in the final reload().
+ */
+class BackwardBitReader 
+{
+  public:
+    enum class Status { Unfinished, EndOfBuffer, Completed, Overflow };
+
+    // false without an end mark
+    bool init(
+        const uint8_t* begin, 
+        const uint8_t* end
+    ) {
+        start = begin;
+        if (end == begin || end[-1] == 0) return false;
+        if (end - begin >= static_cast<std::ptrdiff_t>(sizeof(container))) 
+        {
+            position = end - sizeof(container);
+            memcpy(&container, position, sizeof(container));
+        }
+        else 
+        {
+            // a short stream: the missing high bytes count as consumed
+            position = begin;
+            container = 0;
+            for (int i = 0; begin + i < end; i++) 
+            {
+                container |= static_cast<uint64_t>(begin[i]) << (8 * i);
+            }
+        }
+        consumed = __builtin_clzll(container) + 1;   // skip endmark
+        return true;
+    }
+
+    inline size_t readBits(uint32_t numberOfBits) 
+    {
+        // two shifts: numberOfBits may be 0
+        uint64_t value = (container << (consumed & 63)) >> 1 >> (63 - numberOfBits);
+        consumed += numberOfBits;
+        return value;
+    }
+
+    // Unfinished: at least 57 bits can be read before the next reload
+    inline Status reload() 
+    {
+        if (consumed > sizeof(container) * 8) return Status::Overflow;
+        if (position >= start + sizeof(container)) 
+        {
+            position -= consumed >> 3;
+            consumed &= 7;
+            memcpy(&container, position, sizeof(container));
+            return Status::Unfinished;
+        }
+        if (position == start) 
+        {
+            return consumed < sizeof(container) * 8 ? Status::EndOfBuffer : Status::Completed;
+        }
+        size_t bytes = consumed >> 3;
+        Status status = Status::Unfinished;
+        if (position - bytes < start) 
+        {
+            bytes = position - start;
+            status = Status::EndOfBuffer;
+        }
+        position -= bytes;
+        consumed -= bytes * 8;
+        memcpy(&container, position, sizeof(container));
+        return status;
+    }
+
+  private:
+    const uint8_t* start = nullptr;
+    const uint8_t* position = nullptr;
+    uint64_t container = 0;
+    unsigned consumed = 0;
+};
+
+/*
+ * Decodes the version 2 bit stream of size symbols. Each round of the hot
+ * loop reloads once and advances all four states, which are independent, so
+ * their table lookups overlap; it only branches on the loop condition.
+ */
+bool decompressInterleaved(
+    const uint8_t* begin, 
+    const uint8_t* end, 
+    const std::vector<SymbolDecompressionTransform>& dTable, 
+    unsigned tableLog, 
+    uint8_t* output, 
+    size_t size
+) {
+    constexpr size_t StateCount = wisent::algorithms::FSE::STATE_COUNT;
+    BackwardBitReader bitReader;
+    if (!bitReader.init(begin, end)) return false;
+
+    const size_t stateCount = std::min(size, StateCount);
+    std::array<size_t, StateCount> states{};
+    for (size_t state = 0; state < stateCount; ++state) 
+    {
+        states[state] = bitReader.readBits(tableLog);
+    }
+
+    const SymbolDecompressionTransform* table = dTable.data();
+    auto decodeSymbol = [table, &bitReader](size_t& dState) {
+        const SymbolDecompressionTransform entry = table[dState];
+        dState = entry.newState + bitReader.readBits(entry.numberOfBitsToRead);
+        return entry.symbol;
+    };
+
+    // symbols [decoded, size) are the symbols of the final states
+    const size_t decoded = size - stateCount;
+    size_t index = 0;
+    size_t state1 = states[0], state2 = states[1], state3 = states[2], state4 = states[3];
+    while (index + StateCount <= decoded && bitReader.reload() == BackwardBitReader::Status::Unfinished) 
+    {
+        output[index] = decodeSymbol(state1);
+        output[index + 1] = decodeSymbol(state2);
+        output[index + 2] = decodeSymbol(state3);
+        output[index + 3] = decodeSymbol(state4);
+        index += StateCount;
+    }
+    states = {state1, state2, state3, state4};
+    for (; index < decoded; ++index) 
+    {
+        bitReader.reload();
+        output[index] = decodeSymbol(states[index % StateCount]);
+    }
+    for (; index < size; ++index) 
+    {
+        output[index] = table[states[index % StateCount]].symbol;
+    }
+    return bitReader.reload() == BackwardBitReader::Status::Completed;
+}
+
+Result<std::vector<uint8_t>> decompressVersion1(
     const std::vector<uint8_t>& input, 
     bool verbose
 ) {
@@ -686,12 +990,11 @@ Result<std::vector<uint8_t>> wisent::algorithms::FSE::decompress(
     unsigned tableLog = 0;
 
     int normalizeCounterOffset = 0; 
-    std::vector<int16_t> normalizedCounts = readNormalizedCount(
-        maxSymbolValue, 
-        tableLog, 
-        input, 
-        normalizeCounterOffset
-    );
+    std::vector<int16_t> normalizedCounts;
+    if (!readNormalizedCount(maxSymbolValue, tableLog, input, normalizeCounterOffset, normalizedCounts)) 
+    {
+        return makeError<std::vector<uint8_t>>("FSE: corrupt table header");
+    }
 
     if (verbose) 
     {
@@ -713,14 +1016,114 @@ Result<std::vector<uint8_t>> wisent::algorithms::FSE::decompress(
     if (verbose) printDTable(dTable);
     
     //  3. Decompress the data
-    std::vector<uint8_t> decompressed = decompressDataUsingDTable(
-        input, 
-        dTable,
-        tableLog,
-        maxSymbolValue, 
-        normalizeCounterOffset
-    );
+    std::vector<uint8_t> decompressed;
+    if (!decompressDataUsingDTable(input, dTable, tableLog, normalizeCounterOffset, decompressed)) 
+    {
+        return makeError<std::vector<uint8_t>>("FSE: corrupt bit stream");
+    }
 
     result.setValue(decompressed);
     return result;
 }
+
+Result<std::vector<uint8_t>> wisent::algorithms::FSE::decompress(
+    const std::vector<uint8_t>& input, 
+    bool verbose
+) {
+    RepeatState repeatState;
+    return decompress(input, repeatState, verbose);
+}
+
+Result<std::vector<uint8_t>> wisent::algorithms::FSE::decompress(
+    const std::vector<uint8_t>& input, 
+    RepeatState& repeatState,
+    bool verbose
+) {
+    if (input.empty()) 
+    {
+        return makeError<std::vector<uint8_t>>("FSE: empty input");
+    }
+    // version 1 pages start with tableLog - MinTablelog
+    if (input[0] != FORMAT_VERSION) 
+    {
+        return decompressVersion1(input, verbose);
+    }
+
+    const uint8_t* position = input.data() + 2;     // after the table mode
+    const uint8_t* end = input.data() + input.size();
+    uint64_t decompressedSize;
+    if (input.size() < 2 || !readVarint(position, end, decompressedSize)) 
+    {
+        return makeError<std::vector<uint8_t>>("FSE: corrupt header");
+    }
+    if (decompressedSize > FSE::MAX_DECOMPRESSED_SIZE) 
+    {
+        return makeError<std::vector<uint8_t>>("FSE: decompressed size exceeds the maximum");
+    }
+
+    //  1. Read the table, or take the previous page's
+    switch (static_cast<TableMode>(input[1])) 
+    {
+        case TableMode::Single: 
+        {
+            if (end - position != 1) 
+            {
+                return makeError<std::vector<uint8_t>>("FSE: corrupt header");
+            }
+            Result<std::vector<uint8_t>> result; 
+            result.value = std::vector<uint8_t>(decompressedSize, *position);
+            return result;
+        }
+        case TableMode::Fresh: 
+        {
+            auto tables = std::make_unique<RepeatState::Tables>();
+            if (!readTable(position, end, tables->tableLog, tables->normalizedCounts)) 
+            {
+                return makeError<std::vector<uint8_t>>("FSE: corrupt table");
+            }
+            repeatState.tables = std::move(tables);
+            break;
+        }
+        case TableMode::Repeat: 
+            if (!repeatState.tables) 
+            {
+                return makeError<std::vector<uint8_t>>(
+                    "FSE: the page repeats the table of the page before it, decode the pages of a column in order");
+            }
+            break;
+        default: 
+            return makeError<std::vector<uint8_t>>("FSE: unknown table mode");
+    }
+    RepeatState::Tables& tables = *repeatState.tables;
+
+    if (verbose) 
+    {
+        std::cout << "Table Log: " << tables.tableLog << std::endl;
+        std::cout << "Max Symbol Value: " << tables.normalizedCounts.size() - 1 << std::endl;
+        printNormalizedCounter(tables.normalizedCounts);
+    }
+
+    //  2. Build DTable from normalizedCounts, once per table
+    if (tables.dTable.empty()) 
+    {
+        buildDTable(
+            tables.normalizedCounts, 
+            tables.normalizedCounts.size() - 1,
+            tables.tableLog, 
+            tables.dTable
+        ); 
+    }
+
+    if (verbose) printDTable(tables.dTable);
+
+    //  3. Decompress the data
+    std::vector<uint8_t> decompressed(decompressedSize);
+    if (!decompressInterleaved(position, end, tables.dTable, tables.tableLog, decompressed.data(), decompressedSize)) 
+    {
+        return makeError<std::vector<uint8_t>>("FSE: corrupt or truncated bit stream");
+    }
+
+    Result<std::vector<uint8_t>> result; 
+    result.value = std::move(decompressed);
+    return result;
+}
@@ -1,21 +1,58 @@
 #pragma once
 #include "../Result.hpp"
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <stdexcept>
 
-namespace wisent::algorithms 
+namespace wisent::algorithms
 {
-    struct FSE 
+    struct FSE
     {
+        // first byte of the pages compress() writes; decompress() also reads
+        // the version 1 pages, which start with tableLog - 5
+        static constexpr uint8_t FORMAT_VERSION = 0x82;
+        // states interleaved in the bit stream
+        static constexpr int STATE_COUNT = 4;
+        // symbols can cost 0 bits, so the stream length does not bound the output
+        static constexpr uint64_t MAX_DECOMPRESSED_SIZE = uint64_t{1} << 30;
+
+        /*
+         * The table of the last page with a full header, carried from page to
+         * page of a column: a page whose histogram is close enough to it
+         * repeats it instead of writing (and building) its own. Such a page
+         * only decodes with the state of the pages of its column before it.
+         */
+        class RepeatState
+        {
+          public:
+            RepeatState();
+            ~RepeatState();
+            RepeatState(RepeatState&& other) noexcept;
+            RepeatState& operator=(RepeatState&& other) noexcept;
+
+          private:
+            friend struct FSE;
+            struct Tables;
+            std::unique_ptr<Tables> tables;
+        };
+
+        static Result<std::vector<uint8_t>> compress(
+            const std::vector<uint8_t>& input,
+            bool verbose = false
+        );
         static Result<std::vector<uint8_t>> compress(
-            const std::vector<uint8_t>& input, 
+            const std::vector<uint8_t>& input,
+            RepeatState& repeatState,
             bool verbose = false
         );
         static Result<std::vector<uint8_t>> decompress(
             const std::vector<uint8_t>& input, bool verbose = false
         );
+        static Result<std::vector<uint8_t>> decompress(
+            const std::vector<uint8_t>& input,
+            RepeatState& repeatState,
+            bool verbose = false
+        );
     };
 } // FSE
-
-
@@ -1,316 +1,598 @@
-/*  Possible Todo's: 
-    - check if the previous dictionary is beneficial (?)
-    - handle less compressible data
-    - the way of storing encoding table is not optimal
-*/
-
-#include <iostream>
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
 #include <queue>
-#include <unordered_map>
-#include <bitset>
-// #include <fstream>
+#include <utility>
+#include <vector>
 #include "Huffman.hpp"
+#include "Varint.hpp"
 
-struct HuffmanNode 
+namespace
 {
-    char symbol;
-    int64_t frequency;
-    HuffmanNode* left;
-    HuffmanNode* right;
-    
-    HuffmanNode(char s, int64_t f) : symbol(s), frequency(f), left(nullptr), right(nullptr) {}
-};
+    using wisent::algorithms::Huffman;
 
-struct Compare 
-{
-    bool operator()(HuffmanNode* l, HuffmanNode* r) 
-    {
-        return l->frequency > r->frequency;
-    }
-};
+    constexpr int SYMBOL_COUNT = 256;
+    constexpr uint32_t TABLE_SIZE = 1u << Huffman::MAX_CODE_LENGTH;
+    // symbols decoded per 64-bit refill: 4 * 11 bits fit the 57 bits a refill guarantees
+    constexpr int SYMBOLS_PER_REFILL = 4;
 
-class HuffmanTree 
-{
-  private:
-    HuffmanNode* root;
-    std::unordered_map<char, std::string> encodingTable;
+    using CodeLengths = std::array<uint8_t, SYMBOL_COUNT>;
 
-    void buildEncodingTable(HuffmanNode* node, const std::string& str) 
+    // Huffman code lengths from the frequencies, 0 for absent symbols
+    CodeLengths buildCodeLengths(std::array<uint64_t, SYMBOL_COUNT> const& frequencies)
     {
-        if (!node) return;
-        if (!node->left && !node->right) 
+        CodeLengths lengths{};
+        // nodes [0, SYMBOL_COUNT) are the leaves, merged nodes follow
+        std::vector<uint64_t> weights(frequencies.begin(), frequencies.end());
+        std::vector<int> parents(SYMBOL_COUNT, -1);
+        using Entry = std::pair<uint64_t, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++)
         {
-            encodingTable[node->symbol] = str;
+            if (frequencies[symbol] > 0)
+            {
+                queue.push({frequencies[symbol], symbol});
+            }
         }
-        buildEncodingTable(node->left, str + "0");
-        buildEncodingTable(node->right, str + "1");
-    }
-
-  public:
-    HuffmanTree() : root(nullptr) {}
-
-    void buildTreeWithInput(const std::vector<uint8_t>& input) 
-    {
-        std::unordered_map<char, int64_t> frequencies;
-        for (char c : input) 
+        if (queue.size() == 1)
         {
-            frequencies[c]++;
+            lengths[queue.top().second] = 1;
+            return lengths;
         }
-        frequencies['\0'] = 1; // EOF symbol
-
-        std::priority_queue<HuffmanNode*, std::vector<HuffmanNode*>, Compare> tree;
-        for (auto& pair : frequencies) 
+        while (queue.size() > 1)
         {
-            tree.push(new HuffmanNode(pair.first, pair.second));
+            Entry left = queue.top();
+            queue.pop();
+            Entry right = queue.top();
+            queue.pop();
+            int parent = weights.size();
+            weights.push_back(left.first + right.first);
+            parents.push_back(-1);
+            parents[left.second] = parent;
+            parents[right.second] = parent;
+            queue.push({weights.back(), parent});
         }
-
-        while (tree.size() > 1) 
+        for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++)
         {
-            HuffmanNode* left = tree.top(); 
-            tree.pop();
-            
-            HuffmanNode* right = tree.top(); 
-            tree.pop();
-
-            HuffmanNode* parent = new HuffmanNode(
-                '*', 
-                left->frequency + right->frequency
-            );
-            parent->left = left;
-            parent->right = right;
-
-            tree.push(parent);
+            if (frequencies[symbol] == 0)
+            {
+                continue;
+            }
+            int depth = 0;
+            for (int node = symbol; parents[node] != -1; node = parents[node])
+            {
+                depth++;
+            }
+            lengths[symbol] = static_cast<uint8_t>(depth);
         }
-
-        root = tree.top();
-        buildEncodingTable(root, "");
+        return lengths;
     }
 
-    void buildTreeWithEncodingTable(
-        const std::unordered_map<char, std::string>& encodingTable
+    /*
+     * Caps the code lengths at MAX_CODE_LENGTH: the capped codes overfill the
+     * code space (Kraft sum above 1), so the longest codes below the cap are
+     * lengthened until it fits; any space left is handed back to the most
+     * frequent symbols.
+     */
+    void limitCodeLengths(
+        CodeLengths& lengths,
+        std::array<uint64_t, SYMBOL_COUNT> const& frequencies
     ) {
-        root = new HuffmanNode('*', 0);
-        size_t index = 0;
+        constexpr int LIMIT = Huffman::MAX_CODE_LENGTH;
+        std::vector<int> symbols;
+        for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++)
+        {
+            if (lengths[symbol] > 0)
+            {
+                symbols.push_back(symbol);
+            }
+        }
+        // least frequent first
+        std::sort(symbols.begin(), symbols.end(), [&frequencies](int a, int b) {
+            return frequencies[a] != frequencies[b] ? frequencies[a] < frequencies[b] : a < b;
+        });
 
-        for (const auto& pair : encodingTable) 
+        uint64_t kraft = 0;    // in units of 2^-LIMIT
+        for (int symbol : symbols)
         {
-            HuffmanNode* current = root;
-            for (char bit : pair.second) 
+            lengths[symbol] = std::min<uint8_t>(lengths[symbol], LIMIT);
+            kraft += uint64_t{1} << (LIMIT - lengths[symbol]);
+        }
+        while (kraft > TABLE_SIZE)
+        {
+            // the least frequent of the longest codes still below the cap
+            int longest = -1;
+            for (int symbol : symbols)
             {
-                if (bit == '0') 
-                {
-                    if (!current->left) 
-                    {
-                        current->left = new HuffmanNode('*', 0);
-                    }
-                    current = current->left;
-                } 
-                else 
+                if (lengths[symbol] < LIMIT && (longest == -1 || lengths[symbol] > lengths[longest]))
                 {
-                    if (!current->right) 
-                    {
-                        current->right = new HuffmanNode('*', 0);
-                    }
-                    current = current->right;
+                    longest = symbol;
                 }
             }
-            current->symbol = pair.first; 
+            lengths[longest]++;
+            kraft -= uint64_t{1} << (LIMIT - lengths[longest]);
+        }
+        for (auto it = symbols.rbegin(); it != symbols.rend(); ++it)
+        {
+            while (lengths[*it] > 1 && kraft + (uint64_t{1} << (LIMIT - lengths[*it])) <= TABLE_SIZE)
+            {
+                kraft += uint64_t{1} << (LIMIT - lengths[*it]);
+                lengths[*it]--;
+            }
         }
     }
 
-    std::vector<uint8_t> encode(const std::vector<uint8_t>& data) 
-    {
-        std::vector<uint8_t> encodedBytes;
-	encodedBytes.reserve(data.size());
-
-        // Encode EOF symbol
-        std::string eofCode = encodingTable['\0'];
-        encodedBytes.push_back(eofCode.size());
-        encodeStringToBytes(eofCode, encodedBytes);
-
-        // Add encoding table
-        for (const auto& pair : encodingTable) 
+    uint32_t reverseBits(
+        uint32_t code,
+        int length
+    ) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++)
         {
-            if (pair.first == '\0') continue;
-
-            encodedBytes.push_back(pair.first);
-
-            uint8_t codeLength = pair.second.size();
-            encodedBytes.push_back(codeLength);
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        return reversed;
+    }
 
-            encodeStringToBytes(pair.second, encodedBytes);
+    /*
+     * Canonical codes: by length, then by symbol, consecutive values. The bit
+     * stream is LSB first, so the codes are stored bit reversed. False if the
+     * lengths overfill the code space.
+     */
+    bool buildCanonicalCodes(
+        CodeLengths const& lengths,
+        std::array<uint32_t, SYMBOL_COUNT>& codes
+    ) {
+        std::array<uint32_t, Huffman::MAX_CODE_LENGTH + 2> lengthCounts{};
+        for (uint8_t length : lengths)
+        {
+            lengthCounts[length]++;
+        }
+        lengthCounts[0] = 0;
+        std::array<uint32_t, Huffman::MAX_CODE_LENGTH + 2> nextCode{};
+        uint32_t code = 0;
+        for (int length = 1; length <= Huffman::MAX_CODE_LENGTH; length++)
+        {
+            code = (code + lengthCounts[length - 1]) << 1;
+            nextCode[length] = code;
+            if (code + lengthCounts[length] > (1u << length))
+            {
+                return false;
+            }
+        }
+        for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++)
+        {
+            if (lengths[symbol] > 0)
+            {
+                codes[symbol] = reverseBits(nextCode[lengths[symbol]]++, lengths[symbol]);
+            }
+        }
+        return true;
+    }
 
-            encodedBytes.push_back(0); // Delimiter
+    inline uint64_t loadBits(
+        const uint8_t* data,
+        const uint8_t* end
+    ) {
+        uint64_t bits = 0;
+        if (end - data >= 8)
+        {
+            memcpy(&bits, data, sizeof(bits));
+            return bits;
+        }
+        for (int i = 0; data + i < end; i++)   // the tail, zero padded
+        {
+            bits |= static_cast<uint64_t>(data[i]) << (8 * i);
         }
-        encodedBytes.push_back(0); // Final delimiter
+        return bits;
+    }
 
-        // Encode data 
-        std::vector<bool> encoded;
-	encoded.reserve(data.size());
-        for (char c : data) 
+    /*
+     * Writes the codes of [input, inputEnd) to output, LSB first, and returns
+     * the end of the bits. The 64-bit bit buffer stores whole bytes every
+     * SYMBOLS_PER_REFILL codes; output needs 8 bytes of slack.
+     */
+    uint8_t* encodeStream(
+        const uint8_t* input,
+        const uint8_t* inputEnd,
+        CodeLengths const& lengths,
+        std::array<uint32_t, SYMBOL_COUNT> const& codes,
+        uint8_t* output
+    ) {
+        uint64_t bitBuffer = 0;
+        int bitCount = 0;
+        auto flush = [&]() {
+            memcpy(output, &bitBuffer, sizeof(bitBuffer));
+            output += bitCount >> 3;
+            bitBuffer >>= bitCount & ~7;     // at most 7 + 4 * 11 bits are pending
+            bitCount &= 7;
+        };
+        for (; inputEnd - input >= SYMBOLS_PER_REFILL; input += SYMBOLS_PER_REFILL)
         {
-            for (char bit : encodingTable[c]) 
+            for (int i = 0; i < SYMBOLS_PER_REFILL; i++)
             {
-                encoded.push_back(bit == '1' ? 1 : 0);
+                bitBuffer |= static_cast<uint64_t>(codes[input[i]]) << bitCount;
+                bitCount += lengths[input[i]];
             }
+            flush();
         }
-        for (char bit : encodingTable['\0'])  // EOF symbol
+        for (; input < inputEnd; input++)
         {
-            encoded.push_back(bit == '1' ? 1 : 0);
+            bitBuffer |= static_cast<uint64_t>(codes[*input]) << bitCount;
+            bitCount += lengths[*input];
+            flush();
         }
+        memcpy(output, &bitBuffer, sizeof(bitBuffer));
+        return output + ((bitCount + 7) >> 3);
+    }
 
-        // Convert to bytes
-        uint8_t byte = 0;
-        uint8_t bitCount = 0;
-
-        for (bool bit : encoded) 
+    /*
+     * Decodes [output, outputEnd) from the bits in [bits, end), starting at
+     * bitPosition. An invalid code decodes to garbage without consuming bits,
+     * it is reported once at the end, so the hot loop has no early exit. False
+     * as well if the bits run out.
+     */
+    bool decodeStream(
+        const uint16_t* table,
+        const uint8_t* bits,
+        const uint8_t* end,
+        uint8_t* output,
+        uint8_t* outputEnd,
+        uint64_t bitPosition = 0
+    ) {
+        uint64_t totalBytes = end - bits;
+        bool invalidCode = false;
+        while (outputEnd - output >= SYMBOLS_PER_REFILL && (bitPosition >> 3) + 8 <= totalBytes)
         {
-            byte = (byte << 1) | bit;
-            bitCount++;
-            if (bitCount == 8) 
+            uint64_t window;
+            memcpy(&window, bits + (bitPosition >> 3), sizeof(window));
+            window >>= bitPosition & 7;
+            for (int i = 0; i < SYMBOLS_PER_REFILL; i++)
             {
-                encodedBytes.push_back(byte);
-                byte = 0;
-                bitCount = 0;
+                uint16_t entry = table[window & (TABLE_SIZE - 1)];
+                invalidCode |= entry < 0x100;   // code length 0
+                *output++ = static_cast<uint8_t>(entry);
+                window >>= entry >> 8;
+                bitPosition += entry >> 8;
             }
         }
-        if (bitCount > 0) 
+        while (output < outputEnd && (bitPosition >> 3) < totalBytes)
         {
-            byte <<= (8 - bitCount);
-            encodedBytes.push_back(byte);
+            uint64_t window = loadBits(bits + (bitPosition >> 3), end) >> (bitPosition & 7);
+            uint16_t entry = table[window & (TABLE_SIZE - 1)];
+            if ((entry >> 8) == 0)
+            {
+                return false;
+            }
+            *output++ = static_cast<uint8_t>(entry);
+            bitPosition += entry >> 8;
         }
+        return !invalidCode && output == outputEnd && bitPosition <= totalBytes * 8;
+    }
 
-        return encodedBytes;
+    inline uint64_t loadWindow(
+        const uint8_t* bits,
+        uint64_t bitPosition
+    ) {
+        uint64_t window;
+        memcpy(&window, bits + (bitPosition >> 3), sizeof(window));
+        return window >> (bitPosition & 7);
     }
 
-    std::vector<uint8_t> decode(const std::vector<uint8_t>& data) 
-    {
-        std::vector<uint8_t> decoded;
-	decoded.reserve(data.size());
-        HuffmanNode* current = root;
+    inline uint32_t decodeSymbol(
+        const uint16_t* table,
+        uint64_t& window,
+        uint64_t& bitPosition,
+        bool& invalidCode
+    ) {
+        uint16_t entry = table[window & (TABLE_SIZE - 1)];
+        invalidCode |= entry < 0x100;
+        window >>= entry >> 8;
+        bitPosition += entry >> 8;
+        return entry & 0xFF;
+    }
+
+    /*
+     * The four streams of an interleaved page: each iteration refills all four
+     * windows and decodes SYMBOLS_PER_REFILL symbols from each, so the four
+     * dependency chains (lookup, shift, lookup) overlap. The state of each
+     * stream is a named local, arrays would not stay in registers, and the
+     * symbols are stored four at a time. The streams are finished one at a
+     * time by decodeStream().
+     */
+    bool decodeFourStreams(
+        const uint16_t* table,
+        const uint8_t* bits,
+        const std::array<uint64_t, Huffman::STREAM_COUNT>& streamBytes,
+        uint8_t* output,
+        uint64_t size
+    ) {
+        constexpr int STREAMS = Huffman::STREAM_COUNT;
+        static_assert(STREAMS == 4, "the hot loop names the state of each stream");
+        uint64_t segment = (size + STREAMS - 1) / STREAMS;
+        std::array<const uint8_t*, STREAMS> starts;
+        std::array<uint8_t*, STREAMS> outputs;
+        std::array<uint8_t*, STREAMS> outputEnds;
+        for (int stream = 0; stream < STREAMS; stream++)
+        {
+            starts[stream] = stream == 0 ? bits : starts[stream - 1] + streamBytes[stream - 1];
+            outputs[stream] = output + std::min(size, stream * segment);
+            outputEnds[stream] = output + std::min(size, (stream + 1) * segment);
+        }
 
-        std::vector<bool> bits;
-	bits.reserve(data.size());
-        for (size_t i = 0; i < data.size(); ++i) 
+        const uint8_t* bits0 = starts[0];
+        const uint8_t* bits1 = starts[1];
+        const uint8_t* bits2 = starts[2];
+        const uint8_t* bits3 = starts[3];
+        uint64_t position0 = 0, position1 = 0, position2 = 0, position3 = 0;
+        // the last stream holds the fewest symbols; refills need 8 readable bytes
+        uint64_t iterations = (outputEnds[3] - outputs[3]) / SYMBOLS_PER_REFILL;
+        uint64_t iteration = 0;
+        bool invalidCode = false;
+        for (; iteration < iterations; iteration++)
         {
-            std::bitset<8> byte(data[i]);
-            for (int j = 7; j >= 0; --j) 
+            if ((position0 >> 3) + 8 > streamBytes[0] || (position1 >> 3) + 8 > streamBytes[1]
+                || (position2 >> 3) + 8 > streamBytes[2] || (position3 >> 3) + 8 > streamBytes[3])
             {
-                bits.push_back(byte[j]);
+                break;
             }
+            uint64_t window0 = loadWindow(bits0, position0);
+            uint64_t window1 = loadWindow(bits1, position1);
+            uint64_t window2 = loadWindow(bits2, position2);
+            uint64_t window3 = loadWindow(bits3, position3);
+            uint32_t symbols0 = 0, symbols1 = 0, symbols2 = 0, symbols3 = 0;
+            for (int i = 0; i < SYMBOLS_PER_REFILL; i++)
+            {
+                symbols0 |= decodeSymbol(table, window0, position0, invalidCode) << (8 * i);
+                symbols1 |= decodeSymbol(table, window1, position1, invalidCode) << (8 * i);
+                symbols2 |= decodeSymbol(table, window2, position2, invalidCode) << (8 * i);
+                symbols3 |= decodeSymbol(table, window3, position3, invalidCode) << (8 * i);
+            }
+            memcpy(outputs[0] + iteration * SYMBOLS_PER_REFILL, &symbols0, sizeof(uint32_t));
+            memcpy(outputs[1] + iteration * SYMBOLS_PER_REFILL, &symbols1, sizeof(uint32_t));
+            memcpy(outputs[2] + iteration * SYMBOLS_PER_REFILL, &symbols2, sizeof(uint32_t));
+            memcpy(outputs[3] + iteration * SYMBOLS_PER_REFILL, &symbols3, sizeof(uint32_t));
         }
 
-        for (bool bit : bits) 
+        std::array<uint64_t, STREAMS> positions = {position0, position1, position2, position3};
+        for (int stream = 0; stream < STREAMS; stream++)
         {
-            current = bit ? current->right : current->left;
-            if (current->left == nullptr && current->right == nullptr) 
+            uint8_t* resumed = outputs[stream] + iteration * SYMBOLS_PER_REFILL;
+            if (!decodeStream(table, starts[stream], starts[stream] + streamBytes[stream],
+                    resumed, outputEnds[stream], positions[stream]))
             {
-                if (current->symbol == '\0') break;  // EOF 
-                decoded.push_back((uint8_t)current->symbol);
-                current = root;
+                return false;
             }
         }
-        return decoded;
+        return !invalidCode;
     }
 
-    void encodeStringToBytes(
-        const std::string& str, 
-        std::vector<uint8_t>& encodedBytes
+    // the version 1 stream: EOF code, then (symbol, length, code, 0) entries
+    // up to a 0 symbol, then the codes MSB first up to the EOF code
+    Result<std::vector<uint8_t>> decompressVersion1(
+        const std::vector<uint8_t>& input
     ) {
-        uint8_t bitBuffer = 0;
-        int64_t bitCount = 0;
-        for (char bit : str) 
+        size_t offset = 0;
+        auto readCode = [&input, &offset](uint8_t length, uint32_t& code) {
+            code = 0;
+            for (int bit = 0; bit < length; bit++)
+            {
+                size_t byte = offset + bit / 8;
+                if (byte >= input.size())
+                {
+                    return false;
+                }
+                code = (code << 1) | ((input[byte] >> (7 - bit % 8)) & 1);
+            }
+            offset += (length + 7) / 8;
+            return true;
+        };
+
+        std::map<std::pair<uint8_t, uint32_t>, int> symbolsByCode;   // -1: EOF
+        uint8_t eofLength = input[offset++];
+        uint32_t eofCode;
+        if (!readCode(eofLength, eofCode))
         {
-            bitBuffer = (bitBuffer << 1) | (bit == '1' ? 1 : 0);
-            bitCount++;
-            if (bitCount % 8 == 0) 
+            return makeError<std::vector<uint8_t>>("Huffman: truncated header");
+        }
+        symbolsByCode[{eofLength, eofCode}] = -1;
+        while (offset < input.size())
+        {
+            uint8_t symbol = input[offset++];
+            if (symbol == 0)
             {
-                encodedBytes.push_back(bitBuffer);
-                bitBuffer = 0;
-                bitCount = 0; 
+                break;
             }
+            uint32_t code;
+            if (offset >= input.size() || input[offset] > 32)
+            {
+                return makeError<std::vector<uint8_t>>("Huffman: corrupt header");
+            }
+            uint8_t length = input[offset++];
+            if (!readCode(length, code))
+            {
+                return makeError<std::vector<uint8_t>>("Huffman: truncated header");
+            }
+            symbolsByCode[{length, code}] = symbol;
+            offset++;   // delimiter
         }
-        if (bitCount > 0) 
+
+        std::vector<uint8_t> decoded;
+        uint8_t length = 0;
+        uint32_t code = 0;
+        for (size_t bit = offset * 8; bit < input.size() * 8; bit++)
         {
-            bitBuffer <<= (8 - bitCount);
-            encodedBytes.push_back(bitBuffer);
+            code = (code << 1) | ((input[bit / 8] >> (7 - bit % 8)) & 1);
+            if (++length > 32)
+            {
+                return makeError<std::vector<uint8_t>>("Huffman: invalid code");
+            }
+            auto it = symbolsByCode.find({length, code});
+            if (it == symbolsByCode.end())
+            {
+                continue;
+            }
+            if (it->second == -1)
+            {
+                break;
+            }
+            decoded.push_back(static_cast<uint8_t>(it->second));
+            length = 0;
+            code = 0;
         }
+        return makeResult<std::vector<uint8_t>>(decoded);
     }
+}
 
-    std::unordered_map<char, std::string> getEncodingTable() 
+/*
+ * Version 2 stream:
+ *   FORMAT_VERSION, varint decompressed size, varint symbol count n,
+ *   the code lengths of symbols [0, n) as 4-bit nibbles (low nibble first),
+ *   the canonical codes, LSB first.
+ * Four-stream (interleaved) version: FORMAT_VERSION_FOUR_STREAMS, the same
+ *   header, the varint byte sizes of streams 0-2 (the jump table), then the
+ *   streams. Stream i holds the codes of symbols [i * s, (i + 1) * s) with
+ *   s = ceil(size / 4).
+ */
+Result<std::vector<uint8_t>> wisent::algorithms::Huffman::compress(
+    const std::vector<uint8_t>& input,
+    bool interleaved
+) {
+    std::array<uint64_t, SYMBOL_COUNT> frequencies{};
+    for (uint8_t symbol : input)
+    {
+        frequencies[symbol]++;
+    }
+    CodeLengths lengths = buildCodeLengths(frequencies);
+    limitCodeLengths(lengths, frequencies);
+    std::array<uint32_t, SYMBOL_COUNT> codes{};
+    buildCanonicalCodes(lengths, codes);
+
+    size_t streamCount = interleaved && input.size() >= INTERLEAVED_MIN_SIZE ? STREAM_COUNT : 1;
+    std::vector<uint8_t> header;
+    header.push_back(streamCount == 1 ? FORMAT_VERSION : FORMAT_VERSION_FOUR_STREAMS);
+    writeVarint(header, input.size());
+    int symbolCount = SYMBOL_COUNT;
+    while (symbolCount > 0 && lengths[symbolCount - 1] == 0)
+    {
+        symbolCount--;
+    }
+    writeVarint(header, symbolCount);
+    for (int symbol = 0; symbol < symbolCount; symbol += 2)
     {
-        return encodingTable;
+        uint8_t high = symbol + 1 < symbolCount ? lengths[symbol + 1] : 0;
+        header.push_back(static_cast<uint8_t>(lengths[symbol] | (high << 4)));
     }
-}; 
 
-Result<std::vector<uint8_t>> wisent::algorithms::Huffman::compress(
-    const std::vector<uint8_t>& input
-) {
-    Result<std::vector<uint8_t>> result; 
-    HuffmanTree huffmanTree;
-    huffmanTree.buildTreeWithInput(input);
+    size_t segment = (input.size() + streamCount - 1) / streamCount;
+    std::vector<uint8_t> streams((input.size() * MAX_CODE_LENGTH + 7) / 8 + 8 * streamCount);
+    uint8_t* output = streams.data();
+    std::array<uint64_t, STREAM_COUNT> streamBytes{};
+    for (size_t stream = 0; stream < streamCount; stream++)
+    {
+        size_t begin = std::min(input.size(), stream * segment);
+        size_t end = std::min(input.size(), begin + segment);
+        uint8_t* streamEnd = encodeStream(input.data() + begin, input.data() + end, lengths, codes, output);
+        streamBytes[stream] = streamEnd - output;
+        output = streamEnd;
+    }
 
-    std::vector<uint8_t> encoded = huffmanTree.encode(input);
-    
-    result.setValue(encoded);
-    return result;
-} 
+    // the jump table: the byte sizes of all streams but the last
+    std::vector<uint8_t> compressed = std::move(header);
+    for (size_t stream = 0; stream + 1 < streamCount; stream++)
+    {
+        writeVarint(compressed, streamBytes[stream]);
+    }
+    compressed.insert(compressed.end(), streams.data(), output);
 
-std::string byteToBinaryString(uint8_t byte, uint8_t stringLength) 
-{
-    std::bitset<8> eofBits(byte);
-    std::string binaryString = eofBits.to_string();
-    return (stringLength >= 8) ? binaryString : binaryString.substr(0, stringLength);
+    Result<std::vector<uint8_t>> result;
+    result.value = std::move(compressed);
+    return result;
 }
 
 Result<std::vector<uint8_t>> wisent::algorithms::Huffman::decompress(
     const std::vector<uint8_t>& input
 ) {
-    Result<std::vector<uint8_t>> result; 
-    HuffmanTree huffmanTree;
-    std::unordered_map<char, std::string> encodingTable;
-
-    uint8_t offset = 0; 
-
-    // Read EOF symbol
-    uint8_t eofCodeLength = input[offset++];
-    int maxCodeLengthInByte = (eofCodeLength + 7 ) / 8;
-
-    std::string eofBitString;
-    for (int i = 1; i <= maxCodeLengthInByte; i++) 
+    if (input.empty())
+    {
+        return makeError<std::vector<uint8_t>>("Huffman: empty input");
+    }
+    // version 1 streams start with the length of the EOF code, never this long
+    if (input[0] != FORMAT_VERSION && input[0] != FORMAT_VERSION_FOUR_STREAMS)
     {
-        eofBitString += byteToBinaryString(input[offset++], 8);
+        return decompressVersion1(input);
     }
-    eofBitString = eofBitString.substr(0, eofCodeLength);        
-    encodingTable['\0'] = eofBitString;
 
-    // Read encoding table
-    while (offset < input.size()) 
+    const uint8_t* position = input.data() + 1;
+    const uint8_t* end = input.data() + input.size();
+    uint64_t decompressedSize;
+    uint64_t symbolCount;
+    if (!readVarint(position, end, decompressedSize) || !readVarint(position, end, symbolCount)
+        || symbolCount > SYMBOL_COUNT || static_cast<uint64_t>(end - position) < (symbolCount + 1) / 2)
+    {
+        return makeError<std::vector<uint8_t>>("Huffman: corrupt header");
+    }
+    CodeLengths lengths{};
+    for (uint64_t symbol = 0; symbol < symbolCount; symbol++)
+    {
+        lengths[symbol] = (position[symbol / 2] >> (4 * (symbol % 2))) & 0x0F;
+        if (lengths[symbol] > MAX_CODE_LENGTH)
+        {
+            return makeError<std::vector<uint8_t>>("Huffman: code length above the limit");
+        }
+    }
+    position += (symbolCount + 1) / 2;
+    std::array<uint32_t, SYMBOL_COUNT> codes{};
+    if (!buildCanonicalCodes(lengths, codes))
     {
-        uint8_t symbol = input[offset++];
-        if (symbol == 0) break; // End of encoding table
+        return makeError<std::vector<uint8_t>>("Huffman: code lengths overfill the code space");
+    }
 
-        uint8_t codeLength = input[offset++]; 
-        int codeLengthInByte = (codeLength + 7) / 8;
-        
-        std::string bitString;
-        uint8_t byteCount = 0; 
-        while (offset < input.size() && byteCount < codeLengthInByte) 
+    // every MAX_CODE_LENGTH-bit window maps to (symbol, code length); 0: no code
+    std::vector<uint16_t> table(TABLE_SIZE, 0);
+    for (int symbol = 0; symbol < SYMBOL_COUNT; symbol++)
+    {
+        for (uint32_t suffix = 0; lengths[symbol] > 0 && suffix < (TABLE_SIZE >> lengths[symbol]); suffix++)
         {
-            bitString += byteToBinaryString(input[offset++], 8);
-            byteCount++;
+            table[codes[symbol] | (suffix << lengths[symbol])] = static_cast<uint16_t>(symbol | (lengths[symbol] << 8));
         }
-        bitString = bitString.substr(0, codeLength);  
-        encodingTable[symbol] = bitString;
-        offset ++; // Skip delimiter
     }
-    huffmanTree.buildTreeWithEncodingTable(encodingTable);
 
-    std::vector<uint8_t> data(input.begin() + offset, input.end());
+    std::array<uint64_t, STREAM_COUNT> streamBytes{};
+    if (input[0] == FORMAT_VERSION_FOUR_STREAMS)
+    {
+        uint64_t jumpedBytes = 0;
+        for (int stream = 0; stream + 1 < STREAM_COUNT; stream++)
+        {
+            if (!readVarint(position, end, streamBytes[stream]) || streamBytes[stream] > (uint64_t{1} << 56))
+            {
+                return makeError<std::vector<uint8_t>>("Huffman: corrupt jump table");
+            }
+            jumpedBytes += streamBytes[stream];
+        }
+        if (jumpedBytes > static_cast<uint64_t>(end - position))
+        {
+            return makeError<std::vector<uint8_t>>("Huffman: corrupt jump table");
+        }
+        streamBytes[STREAM_COUNT - 1] = (end - position) - jumpedBytes;
+    }
 
-    std::vector<uint8_t> decoded = huffmanTree.decode(data);
+    // every code is at least one bit long: a larger size is not in the stream
+    if (decompressedSize > static_cast<uint64_t>(end - position) * 8)
+    {
+        return makeError<std::vector<uint8_t>>("Huffman: decompressed size exceeds the stream");
+    }
+    std::vector<uint8_t> decompressed(decompressedSize);
+    bool decoded = input[0] == FORMAT_VERSION
+        ? decodeStream(table.data(), position, end, decompressed.data(), decompressed.data() + decompressedSize)
+        : decodeFourStreams(table.data(), position, streamBytes, decompressed.data(), decompressedSize);
+    if (!decoded)
+    {
+        return makeError<std::vector<uint8_t>>("Huffman: invalid code or truncated input");
+    }
 
-    result.setValue(decoded);
-    return result; 
-}
\ No newline at end of file
+    Result<std::vector<uint8_t>> result;
+    result.value = std::move(decompressed);
+    return result;
+}
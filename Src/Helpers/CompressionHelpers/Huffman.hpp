@@ -1,14 +1,33 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include "../Result.hpp"
 
 namespace wisent::algorithms
 {
+    /*
+     * Canonical Huffman codes of at most MAX_CODE_LENGTH bits: the header 
+     * holds the code lengths only, decoding is one table lookup per symbol.
+     * Interleaved pages split the input into STREAM_COUNT bit streams behind
+     * a jump table, so the decoder keeps four independent lookups in flight.
+     */
     struct Huffman
     {
-        static Result<std::vector<uint8_t>> compress(const std::vector<uint8_t>& input);
+        // first byte of the streams compress() writes; decompress() also 
+        // reads the version 1 streams, which start with the EOF code length
+        static constexpr uint8_t FORMAT_VERSION = 0x82;
+        static constexpr uint8_t FORMAT_VERSION_FOUR_STREAMS = 0x83;
+        static constexpr int MAX_CODE_LENGTH = 11;
+        static constexpr int STREAM_COUNT = 4;
+        // below this, the jump table costs more than the interleaving saves
+        static constexpr size_t INTERLEAVED_MIN_SIZE = 1024;
+
+        static Result<std::vector<uint8_t>> compress(
+            const std::vector<uint8_t>& input,
+            bool interleaved = true
+        );
         
         static Result<std::vector<uint8_t>> decompress(const std::vector<uint8_t>& input);
     }; 
@@ -1,156 +1,400 @@
 #include "LZ77.hpp"
+#include "Varint.hpp"
 #include <cstdint>
 #include <vector>
 #include <algorithm>
 
-#include <unordered_map>
-#include <deque>
+#include <cstring>
 
+namespace
+{
+    using wisent::algorithms::readVarint;
+    using wisent::algorithms::writeVarint;
+
+    const int MIN_MATCH_LENGTH = 3;
+    const int MAX_MATCH_CANDIDATES = 8;
+    const int MIN_HASH_BITS = 8;
+    const int MAX_HASH_BITS = 17;
+    // longer matches only insert their first position, long runs stay cheap
+    const int MAX_INSERT_LENGTH = 32;
+    const int64_t MAX_WINDOW_SIZE = int64_t{1} << 24;
+
+    /*
+     * Match finder state, kept per thread so that compressing many small 
+     * columns allocates nothing: head[hash] is the latest position with that 
+     * hash, chain[position & chainMask] the previous one (a ring as large as 
+     * the window, older positions are never followed).
+     */
+    struct MatchFinderWorkspace
+    {
+        std::vector<int32_t> head;
+        std::vector<int32_t> chain;
+    };
+
+    thread_local MatchFinderWorkspace workspace;
+
+    inline uint32_t hash3(
+        const uint8_t* data, 
+        int hashBits
+    ) {
+        uint32_t bytes = (data[0] << 16) | (data[1] << 8) | data[2];
+        return (bytes * 2654435761u) >> (32 - hashBits);
+    }
+
+    // common prefix of a and b, up to maxLength, compared 8 bytes at a time
+    inline int matchLength(
+        const uint8_t* a, 
+        const uint8_t* b, 
+        int maxLength
+    ) {
+        int length = 0;
+        while (length + 8 <= maxLength) 
+        {
+            uint64_t wordA;
+            uint64_t wordB;
+            memcpy(&wordA, a + length, sizeof(wordA));
+            memcpy(&wordB, b + length, sizeof(wordB));
+            uint64_t difference = wordA ^ wordB;
+            if (difference != 0) 
+            {
+                return length + (__builtin_ctzll(difference) >> 3);   // little endian
+            }
+            length += 8;
+        }
+        while (length < maxLength && a[length] == b[length]) 
+        {
+            ++length;
+        }
+        return length;
+    }
+
+    // wild copies write whole chunks, up to WILD_COPY_BYTES - 1 past the end
+    const size_t WILD_COPY_BYTES = 16;
+
+    template <size_t CHUNK_BYTES>
+    inline void wildCopy(
+        uint8_t* destination, 
+        const uint8_t* source, 
+        const uint8_t* destinationEnd
+    ) {
+        do 
+        {
+            memcpy(destination, source, CHUNK_BYTES);
+            destination += CHUNK_BYTES;
+            source += CHUNK_BYTES;
+        } 
+        while (destination < destinationEnd);
+    }
+
+    /*
+     * A chunk may only read what is already written, so the chunk size is 
+     * bounded by the offset; offset 1 is a run, other short offsets repeat 
+     * a pattern shorter than a chunk and are copied bytewise.
+     */
+    inline void copyMatch(
+        uint8_t* output, 
+        size_t offset, 
+        size_t length
+    ) {
+        const uint8_t* match = output - offset;
+        if (offset >= WILD_COPY_BYTES) 
+        {
+            wildCopy<WILD_COPY_BYTES>(output, match, output + length);
+        }
+        else if (offset >= 8) 
+        {
+            wildCopy<8>(output, match, output + length);
+        }
+        else if (offset == 1) 
+        {
+            memset(output, *match, length);
+        }
+        else 
+        {
+            for (size_t i = 0; i < length; ++i) 
+            {
+                output[i] = match[i];
+            }
+        }
+    }
+
+    // what the sequences would write has to add up to the declared size,
+    // checked before that size is allocated
+    bool sequencesMatchSize(
+        const uint8_t* position, 
+        const uint8_t* end, 
+        uint64_t literalBytes, 
+        uint64_t decompressedSize
+    ) {
+        uint64_t remaining = decompressedSize;
+        while (true) 
+        {
+            uint64_t literalRun;
+            if (!readVarint(position, end, literalRun) || literalRun > literalBytes || literalRun > remaining) 
+            {
+                return false;
+            }
+            literalBytes -= literalRun;
+            remaining -= literalRun;
+            if (remaining == 0) 
+            {
+                return true;
+            }
+            uint64_t matchedLength;
+            uint64_t offset;
+            if (!readVarint(position, end, matchedLength) || !readVarint(position, end, offset) 
+                || remaining < MIN_MATCH_LENGTH || matchedLength > remaining - MIN_MATCH_LENGTH) 
+            {
+                return false;
+            }
+            remaining -= matchedLength + MIN_MATCH_LENGTH;
+        }
+    }
+
+    // the version 1 stream: 0, offset (16 bit, big endian), length (8 bit) 
+    // for a match, 1, byte for a literal
+    Result<std::vector<uint8_t>> decompressVersion1(
+        const std::vector<uint8_t> &input
+    ) {
+        std::vector<uint8_t> decompressed;
+        size_t codingPosition = 0;
+        size_t inputSize = input.size();
+
+        while (codingPosition < inputSize) 
+        {
+            if (input[codingPosition] == 0) 
+            {
+                if (codingPosition + 4 > inputSize) 
+                {
+                    return makeError<std::vector<uint8_t>>("LZ77: truncated match token");
+                }
+                size_t offset = (input[codingPosition + 1] << 8) | input[codingPosition + 2];
+                size_t matchedLength = input[codingPosition + 3];
+                if (offset == 0 || offset > decompressed.size()) 
+                {
+                    return makeError<std::vector<uint8_t>>("LZ77: match offset out of range");
+                }
+                size_t start = decompressed.size() - offset;
+                for (size_t i = 0; i < matchedLength; ++i) 
+                {
+                    decompressed.push_back(decompressed[start + i]);
+                }
+                codingPosition += 4;
+            }
+            else 
+            {
+                if (codingPosition + 2 > inputSize) 
+                {
+                    return makeError<std::vector<uint8_t>>("LZ77: truncated literal token");
+                }
+                decompressed.push_back(input[codingPosition + 1]);
+                codingPosition += 2;
+            }
+        }
+        return makeResult<std::vector<uint8_t>>(decompressed);
+    }
+}
+
+/*
+ * Version 2 stream:
+ *   version (2), varint decompressed size, varint literal bytes, literals,
+ *   then sequences of varint literal run, varint match length - 3, varint
+ *   offset; the last sequence ends after its literal run.
+ * Literals are one stream of their own (no per-byte flag) and offsets and
+ * lengths grow with the data, so repeats a page apart are matched too.
+ */
 Result<std::vector<uint8_t>> wisent::algorithms::LZ77::compress(
   const std::vector<uint8_t>& input,
   int64_t windowSize,
   int64_t lookaheadBufferSize
 ) {
-    const int MIN_MATCH_LENGTH = 3;
-    const int MAX_MATCH_CANDIDATES = 8;
+    windowSize = std::clamp<int64_t>(windowSize, 1, MAX_WINDOW_SIZE);
+    lookaheadBufferSize = std::clamp<int64_t>(lookaheadBufferSize, MIN_MATCH_LENGTH, INT32_MAX);
 
-    std::vector<uint8_t> compressed;
-    int inputSize = input.size();
-    int codingPosition = 0;
+    std::vector<uint8_t> literals;
+    std::vector<uint8_t> sequences;
+    literals.reserve(input.size());
+    const uint8_t* data = input.data();
+    size_t inputSize = input.size();
+    size_t codingPosition = 0;
+    size_t literalStart = 0;
+    // positions are kept as int32_t in the match finder
+    if (inputSize > static_cast<size_t>(INT32_MAX)) 
+    {
+        return makeError<std::vector<uint8_t>>("LZ77: input larger than 2 GB");
+    }
 
-    std::unordered_map<uint32_t, std::deque<int>> hashTable;
+    // the table shrinks with the input, clearing it stays cheap for small columns
+    int hashBits = MIN_HASH_BITS;
+    while (hashBits < MAX_HASH_BITS && (size_t{1} << hashBits) < inputSize) 
+    {
+        ++hashBits;
+    }
+    int32_t chainSize = 1;
+    while (chainSize <= std::min<int64_t>(windowSize, inputSize)) 
+    {
+        chainSize <<= 1;
+    }
+    const int32_t chainMask = chainSize - 1;
+    workspace.head.assign(size_t{1} << hashBits, -1);
+    if (workspace.chain.size() < static_cast<size_t>(chainSize)) 
+    {
+        workspace.chain.resize(chainSize);
+    }
+    int32_t* head = workspace.head.data();
+    int32_t* chain = workspace.chain.data();
 
-    auto hash3 = [](const uint8_t* data) -> uint32_t {
-        return (data[0] << 16) | (data[1] << 8) | data[2];
+    auto insert = [&](size_t position) {
+        uint32_t hash = hash3(data + position, hashBits);
+        chain[position & chainMask] = head[hash];
+        head[hash] = static_cast<int32_t>(position);
     };
 
     while (codingPosition < inputSize) 
     {
         int matchedLength = 0;
         int bestOffset = 0;
+        int maxLength = std::min<int64_t>(lookaheadBufferSize, inputSize - codingPosition);
 
         if (codingPosition + MIN_MATCH_LENGTH <= inputSize) 
         {
-            uint32_t hash = hash3(&input[codingPosition]);
-
-            auto& positions = hashTable[hash];
-            for (int i = positions.size() - 1; 
-                i >= 0 && matchedLength < lookaheadBufferSize 
-                && positions.size() - i <= MAX_MATCH_CANDIDATES; --i) 
+            int32_t matchPos = head[hash3(data + codingPosition, hashBits)];
+            for (int candidates = 0; 
+                matchPos >= 0 && candidates < MAX_MATCH_CANDIDATES 
+                && static_cast<int64_t>(codingPosition) - matchPos <= windowSize; ++candidates) 
             {
-                int matchPos = positions[i];
-
-                // matches outside the window
-                if (codingPosition - matchPos > windowSize) continue;
-
-                int length = 0;
-                while (length < lookaheadBufferSize &&
-                       codingPosition + length < inputSize &&
-                       input[matchPos + length] == input[codingPosition + length]) {
-                    ++length;
-                }
-
-                if (length > matchedLength) {
-                    matchedLength = length;
-                    bestOffset = codingPosition - matchPos;
+                // a longer match has to agree on the byte past the current best
+                if (data[matchPos + matchedLength] == data[codingPosition + matchedLength]) 
+                {
+                    int length = matchLength(data + matchPos, data + codingPosition, maxLength);
+                    if (length > matchedLength) 
+                    {
+                        matchedLength = length;
+                        bestOffset = codingPosition - matchPos;
+                        if (length == maxLength) 
+                        {
+                            break;
+                        }
+                    }
                 }
-            }
-
-            positions.push_back(codingPosition);
-            if (positions.size() > MAX_MATCH_CANDIDATES) 
-            {
-                positions.pop_front();  
+                matchPos = chain[matchPos & chainMask];
             }
         }
 
         if (matchedLength >= MIN_MATCH_LENGTH) 
         {
-            compressed.push_back(0);
-            compressed.push_back((bestOffset >> 8) & 0xFF);
-            compressed.push_back(bestOffset & 0xFF);
-            compressed.push_back(matchedLength & 0xFF);
+            literals.insert(literals.end(), data + literalStart, data + codingPosition);
+            writeVarint(sequences, codingPosition - literalStart);
+            writeVarint(sequences, matchedLength - MIN_MATCH_LENGTH);
+            writeVarint(sequences, bestOffset);
+            // positions inside the match are candidates for later matches too
+            size_t insertLength = matchedLength <= MAX_INSERT_LENGTH ? matchedLength : 1;
+            size_t end = std::min(codingPosition + insertLength, inputSize - MIN_MATCH_LENGTH + 1);
+            for (size_t position = codingPosition; position < end; ++position) 
+            {
+                insert(position);
+            }
             codingPosition += matchedLength;
+            literalStart = codingPosition;
         } 
         else 
         {
-            compressed.push_back(1);
-            compressed.push_back(input[codingPosition]);
+            if (codingPosition + MIN_MATCH_LENGTH <= inputSize) 
+            {
+                insert(codingPosition);
+            }
             codingPosition++;
         }
     }
+    literals.insert(literals.end(), data + literalStart, data + inputSize);
+    writeVarint(sequences, inputSize - literalStart);
+
+    std::vector<uint8_t> compressed;
+    compressed.reserve(literals.size() + sequences.size() + 16);
+    compressed.push_back(FORMAT_VERSION);
+    writeVarint(compressed, inputSize);
+    writeVarint(compressed, literals.size());
+    compressed.insert(compressed.end(), literals.begin(), literals.end());
+    compressed.insert(compressed.end(), sequences.begin(), sequences.end());
 
     return makeResult<std::vector<uint8_t>>(compressed);
 }
 
-// Result<std::vector<uint8_t>> wisent::algorithms::LZ77::compress(
-//   const std::vector<uint8_t> &input, 
-//   int64_t windowSize, 
-//   int64_t lookaheadBufferSize
-// ) {
-//     std::vector<uint8_t> compressed;
-//     int inputSize = input.size();
-//     int codingPosition = 0;
-
-//     while (codingPosition < inputSize) {
-//         int matchedLength = 0;
-//         int offset = 0;
-
-//         for (int i = std::max(static_cast<int64_t>(0), codingPosition - windowSize); 
-//           i < codingPosition; ++i
-//         ) {
-//             int length = 0;
-//             while (length < lookaheadBufferSize && codingPosition + length < inputSize &&
-//                    input[i + length] == input[codingPosition + length]) {
-//                 ++length;
-//             }
-//             if (length > matchedLength) {
-//                 matchedLength = length;
-//                 offset = codingPosition - i;
-//             }
-//         }
-
-//         if (matchedLength > 2) {
-//             compressed.push_back(0);
-//             compressed.push_back((offset >> 8) & 0xFF);
-//             compressed.push_back(offset & 0xFF);
-//             compressed.push_back(matchedLength & 0xFF);
-//             codingPosition += matchedLength;
-//         }
-//         else {
-//             compressed.push_back(1);
-//             compressed.push_back(input[codingPosition]);
-//             ++codingPosition;
-//         }
-//     }
-
-//     Result<std::vector<uint8_t>> result = makeResult<std::vector<uint8_t>>(compressed);
-//     return result;
-// }
-
 Result<std::vector<uint8_t>> wisent::algorithms::LZ77::decompress(
     const std::vector<uint8_t> &input
 ) {
-    std::vector<uint8_t> decompressed;
-    int codingPosition = 0;
-    int inputSize = input.size();
-
-    while (codingPosition < inputSize) {
-        if (input[codingPosition] == 0) {
-            int offset = (input[codingPosition + 1] << 8) | input[codingPosition + 2];
-            int matchedLength = input[codingPosition + 3];
-            int start = decompressed.size() - offset;
-
-            for (int i = 0; i < matchedLength; ++i) {
-                decompressed.push_back(decompressed[start + i]);
-            }
-            codingPosition += 4;
+    // version 1 streams start with a token flag, 0 or 1
+    if (input.empty() || input[0] != FORMAT_VERSION) 
+    {
+        return decompressVersion1(input);
+    }
+
+    const uint8_t* position = input.data() + 1;
+    const uint8_t* end = input.data() + input.size();
+    uint64_t decompressedSize;
+    uint64_t literalBytes;
+    if (!readVarint(position, end, decompressedSize) || !readVarint(position, end, literalBytes) 
+        || decompressedSize > MAX_DECOMPRESSED_SIZE || decompressedSize > SIZE_MAX - WILD_COPY_BYTES 
+        || literalBytes > static_cast<uint64_t>(end - position) || literalBytes > decompressedSize) 
+    {
+        return makeError<std::vector<uint8_t>>("LZ77: corrupt header");
+    }
+    const uint8_t* literals = position;
+    const uint8_t* literalsEnd = literals + literalBytes;
+    position = literalsEnd;
+    if (!sequencesMatchSize(position, end, literalBytes, decompressedSize)) 
+    {
+        return makeError<std::vector<uint8_t>>("LZ77: sequences do not match the decompressed size");
+    }
+
+    // allocated once, with room for the wild copies past the last sequence
+    std::vector<uint8_t> decompressed(decompressedSize + WILD_COPY_BYTES);
+    uint8_t* output = decompressed.data();
+    uint8_t* outputEnd = output + decompressedSize;
+    while (true) 
+    {
+        uint64_t literalRun;
+        if (!readVarint(position, end, literalRun) || literalRun > static_cast<uint64_t>(literalsEnd - literals) 
+            || literalRun > static_cast<uint64_t>(outputEnd - output)) 
+        {
+            return makeError<std::vector<uint8_t>>("LZ77: corrupt literal run");
+        }
+        // the chunks may read past the literals, as long as it stays in the input
+        if (literalRun + WILD_COPY_BYTES <= static_cast<uint64_t>(end - literals)) 
+        {
+            wildCopy<WILD_COPY_BYTES>(output, literals, output + literalRun);
         }
-        else {
-            decompressed.push_back(input[codingPosition + 1]);
-            codingPosition += 2;
+        else 
+        {
+            memcpy(output, literals, literalRun);
+        }
+        output += literalRun;
+        literals += literalRun;
+        if (output == outputEnd) 
+        {
+            break;
         }
+
+        uint64_t matchedLength;
+        uint64_t offset;
+        if (!readVarint(position, end, matchedLength) || !readVarint(position, end, offset)) 
+        {
+            return makeError<std::vector<uint8_t>>("LZ77: truncated sequence");
+        }
+        // compared before adding the minimum length, which could wrap
+        if (offset == 0 || offset > static_cast<uint64_t>(output - decompressed.data()) 
+            || outputEnd - output < MIN_MATCH_LENGTH 
+            || matchedLength > static_cast<uint64_t>(outputEnd - output) - MIN_MATCH_LENGTH) 
+        {
+            return makeError<std::vector<uint8_t>>("LZ77: match out of range");
+        }
+        matchedLength += MIN_MATCH_LENGTH;
+        copyMatch(output, offset, matchedLength);
+        output += matchedLength;
     }
+    decompressed.resize(decompressedSize);
 
-    Result<std::vector<uint8_t>> result = makeResult<std::vector<uint8_t>>(decompressed);
+    Result<std::vector<uint8_t>> result;
+    result.value = std::move(decompressed);
     return result;
-}
\ No newline at end of file
+}
@@ -9,10 +9,17 @@ namespace wisent::algorithms
 {
     struct LZ77 
     {
+        // first byte of the streams compress() writes; decompress() also 
+        // reads the version 1 streams (flag byte per token, no version byte)
+        static constexpr uint8_t FORMAT_VERSION = 2;
+        // decompress() refuses streams declaring more (pages are 1 MB)
+        static constexpr uint64_t MAX_DECOMPRESSED_SIZE = uint64_t{1} << 30;
+
+        // windowSize: farthest match offset, lookaheadBufferSize: longest match
         static Result<std::vector<uint8_t>> compress(
             const std::vector<uint8_t>& input, 
-            int64_t windowSize = 4096, 
-            int64_t lookaheadBufferSize = 18
+            int64_t windowSize = 1 << 20, 
+            int64_t lookaheadBufferSize = 1 << 16
         );
         
         static Result<std::vector<uint8_t>> decompress(
@@ -1,8 +1,117 @@
 #include <vector>
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
 #include "../Result.hpp"
 #include "RLE.hpp"
+#include "Varint.hpp"
+
+namespace
+{
+    using wisent::algorithms::readVarint;
+    using wisent::algorithms::writeVarint;
+
+    // repeats the width bytes of value runLength times at output
+    void fillRun(uint8_t* output, const uint8_t* value, size_t width, uint64_t runLength) 
+    {
+        const size_t bytes = width * runLength;
+        memcpy(output, value, width);
+        // doubling copies: memset speed on long runs
+        for (size_t filled = width; filled < bytes; filled *= 2) {
+            memcpy(output + filled, output, std::min(filled, bytes - filled));
+        }
+    }
+
+    // the 8-byte values of int64 and double pages, compared bit for bit
+    template <typename WriteValue>
+    Result<std::vector<uint8_t>> compressWords(const std::vector<uint8_t>& input, const char* name, WriteValue writeValue) 
+    {
+        Result<std::vector<uint8_t>> result;
+        if (input.size() % sizeof(uint64_t) != 0) {
+            return makeError<std::vector<uint8_t>>(std::string(name) + ": input is not a whole number of 8-byte values");
+        }
+
+        const size_t count = input.size() / sizeof(uint64_t);
+        std::vector<uint8_t> output;
+        writeVarint(output, count);
+
+        auto load = [&input](size_t index) {
+            uint64_t word;
+            memcpy(&word, input.data() + index * sizeof(word), sizeof(word));
+            return word;
+        };
+        size_t index = 0;
+        while (index < count) {
+            uint64_t current = load(index);
+            size_t runLength = 1;
+            while (index + runLength < count && load(index + runLength) == current) {
+                runLength++;
+            }
+            writeVarint(output, runLength);
+            writeValue(output, current);
+            index += runLength;
+        }
+
+        result.value = std::move(output);
+        return result;
+    }
+
+    // the runs after the header add up to count values and end the input
+    template <typename ReadValue>
+    bool runsMatchCount(const uint8_t* position, const uint8_t* end, uint64_t count, ReadValue readValue) 
+    {
+        uint64_t decoded = 0;
+        while (decoded < count) {
+            uint64_t runLength;
+            uint64_t value;
+            if (!readVarint(position, end, runLength) || runLength == 0 || runLength > count - decoded
+                || !readValue(position, end, value)) {
+                return false;
+            }
+            decoded += runLength;
+        }
+        return position == end;
+    }
+
+    template <typename ReadValue>
+    Result<std::vector<uint8_t>> decompressWords(const std::vector<uint8_t>& input, const char* name, ReadValue readValue) 
+    {
+        Result<std::vector<uint8_t>> result;
+        const uint8_t* position = input.data();
+        const uint8_t* end = position + input.size();
+        uint64_t count;
+        if (!readVarint(position, end, count) || count > std::numeric_limits<size_t>::max() / sizeof(uint64_t)
+            || count > wisent::algorithms::RLE_MAX_DECOMPRESSED_SIZE / sizeof(uint64_t)) {
+            return makeError<std::vector<uint8_t>>(std::string(name) + ": corrupt header");
+        }
+        if (!runsMatchCount(position, end, count, readValue)) {
+            return makeError<std::vector<uint8_t>>(std::string(name) + ": runs do not match the value count");
+        }
+
+        std::vector<uint8_t> output(count * sizeof(uint64_t));
+        uint64_t decoded = 0;
+        while (decoded < count) {
+            uint64_t runLength;
+            uint64_t value;
+            if (!readVarint(position, end, runLength) || runLength == 0 || runLength > count - decoded
+                || !readValue(position, end, value)) {
+                return makeError<std::vector<uint8_t>>(std::string(name) + ": corrupt run");
+            }
+            fillRun(output.data() + decoded * sizeof(value), reinterpret_cast<const uint8_t*>(&value), sizeof(value), runLength);
+            decoded += runLength;
+        }
+        if (position != end) {
+            return makeError<std::vector<uint8_t>>(std::string(name) + ": trailing bytes after the last run");
+        }
+
+        result.value = std::move(output);
+        return result;
+    }
+}
 
 Result<std::vector<uint8_t>> wisent::algorithms::RLE::compress(const std::vector<uint8_t>& input) 
 {
@@ -54,3 +163,172 @@ Result<std::vector<uint8_t>> wisent::algorithms::RLE::decompress(const std::vect
 
     return makeResult<std::vector<uint8_t>>(output, &result);
 }
+
+Result<std::vector<uint8_t>> wisent::algorithms::RLEInt64::compress(const std::vector<uint8_t>& input) 
+{
+    // zigzag: small negative values stay short varints
+    return compressWords(input, "RLE_INT64", [](std::vector<uint8_t>& output, uint64_t word) {
+        writeVarint(output, zigzag(static_cast<int64_t>(word)));
+    });
+}
+
+Result<std::vector<uint8_t>> wisent::algorithms::RLEInt64::decompress(const std::vector<uint8_t>& input) 
+{
+    return decompressWords(input, "RLE_INT64", [](const uint8_t*& position, const uint8_t* end, uint64_t& word) {
+        uint64_t code;
+        if (!readVarint(position, end, code)) {
+            return false;
+        }
+        word = static_cast<uint64_t>(unzigzag(code));
+        return true;
+    });
+}
+
+Result<std::vector<uint8_t>> wisent::algorithms::RLEDouble::compress(const std::vector<uint8_t>& input) 
+{
+    return compressWords(input, "RLE_DOUBLE", [](std::vector<uint8_t>& output, uint64_t word) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&word);
+        output.insert(output.end(), bytes, bytes + sizeof(word));
+    });
+}
+
+Result<std::vector<uint8_t>> wisent::algorithms::RLEDouble::decompress(const std::vector<uint8_t>& input) 
+{
+    return decompressWords(input, "RLE_DOUBLE", [](const uint8_t*& position, const uint8_t* end, uint64_t& word) {
+        if (end - position < static_cast<std::ptrdiff_t>(sizeof(word))) {
+            return false;
+        }
+        memcpy(&word, position, sizeof(word));
+        position += sizeof(word);
+        return true;
+    });
+}
+
+Result<std::vector<uint8_t>> wisent::algorithms::RLEString::compress(const std::vector<uint8_t>& input) 
+{
+    Result<std::vector<uint8_t>> result;
+
+    // dictionary codes in order of first appearance, then the runs of codes
+    std::unordered_map<std::string_view, uint64_t> codes;
+    std::vector<std::string_view> dictionary;
+    std::vector<uint8_t> runs;
+    size_t count = 0;
+    uint64_t currentCode = 0;
+    uint64_t runLength = 0;
+    size_t position = 0;
+    while (position < input.size()) {
+        uint32_t length;
+        if (input.size() - position < sizeof(length)) {
+            return makeError<std::vector<uint8_t>>("RLE_STRING: input is not a page of length-prefixed strings");
+        }
+        memcpy(&length, input.data() + position, sizeof(length));
+        position += sizeof(length);
+        if (input.size() - position < length) {
+            return makeError<std::vector<uint8_t>>("RLE_STRING: input is not a page of length-prefixed strings");
+        }
+        std::string_view value(reinterpret_cast<const char*>(input.data() + position), length);
+        position += length;
+        count++;
+
+        auto [entry, inserted] = codes.try_emplace(value, dictionary.size());
+        if (inserted) {
+            dictionary.push_back(value);
+        }
+        if (runLength > 0 && entry->second == currentCode) {
+            runLength++;
+            continue;
+        }
+        if (runLength > 0) {
+            writeVarint(runs, currentCode);
+            writeVarint(runs, runLength);
+        }
+        currentCode = entry->second;
+        runLength = 1;
+    }
+    if (runLength > 0) {
+        writeVarint(runs, currentCode);
+        writeVarint(runs, runLength);
+    }
+
+    std::vector<uint8_t> output;
+    writeVarint(output, count);
+    writeVarint(output, dictionary.size());
+    for (std::string_view value : dictionary) {
+        writeVarint(output, value.size());
+        output.insert(output.end(), value.begin(), value.end());
+    }
+    output.insert(output.end(), runs.begin(), runs.end());
+
+    result.value = std::move(output);
+    return result;
+}
+
+Result<std::vector<uint8_t>> wisent::algorithms::RLEString::decompress(const std::vector<uint8_t>& input) 
+{
+    Result<std::vector<uint8_t>> result;
+    const uint8_t* position = input.data();
+    const uint8_t* end = position + input.size();
+    uint64_t count;
+    uint64_t dictionarySize;
+    if (!readVarint(position, end, count) || !readVarint(position, end, dictionarySize)
+        || dictionarySize > static_cast<uint64_t>(end - position)) {
+        return makeError<std::vector<uint8_t>>("RLE_STRING: corrupt header");
+    }
+
+    // each entry as it is laid out in the page: [uint32 length][bytes]
+    std::vector<uint8_t> entries;
+    std::vector<size_t> offsets;
+    for (uint64_t code = 0; code < dictionarySize; code++) {
+        uint64_t length;
+        if (!readVarint(position, end, length) || length > static_cast<uint64_t>(end - position)
+            || length > std::numeric_limits<uint32_t>::max()) {
+            return makeError<std::vector<uint8_t>>("RLE_STRING: corrupt dictionary");
+        }
+        offsets.push_back(entries.size());
+        uint32_t prefix = static_cast<uint32_t>(length);
+        const uint8_t* prefixBytes = reinterpret_cast<const uint8_t*>(&prefix);
+        entries.insert(entries.end(), prefixBytes, prefixBytes + sizeof(prefix));
+        entries.insert(entries.end(), position, position + length);
+        position += length;
+    }
+    offsets.push_back(entries.size());
+
+    // sizes the page from its runs before allocating any of it
+    const uint8_t* runs = position;
+    uint64_t outputSize = 0;
+    uint64_t decoded = 0;
+    while (decoded < count) {
+        uint64_t code;
+        uint64_t runLength;
+        if (!readVarint(position, end, code) || !readVarint(position, end, runLength)
+            || code >= dictionarySize || runLength == 0 || runLength > count - decoded) {
+            return makeError<std::vector<uint8_t>>("RLE_STRING: corrupt run");
+        }
+        const uint64_t width = offsets[code + 1] - offsets[code];
+        if (runLength > (RLE_MAX_DECOMPRESSED_SIZE - outputSize) / width) {
+            return makeError<std::vector<uint8_t>>("RLE_STRING: page decodes past the size limit");
+        }
+        outputSize += width * runLength;
+        decoded += runLength;
+    }
+    if (position != end) {
+        return makeError<std::vector<uint8_t>>("RLE_STRING: trailing bytes after the last run");
+    }
+
+    std::vector<uint8_t> output;
+    output.reserve(outputSize);
+    position = runs;
+    while (position != end) {
+        uint64_t code;
+        uint64_t runLength;
+        readVarint(position, end, code);
+        readVarint(position, end, runLength);
+        const size_t width = offsets[code + 1] - offsets[code];
+        const size_t start = output.size();
+        output.resize(start + width * runLength);
+        fillRun(output.data() + start, entries.data() + offsets[code], width, runLength);
+    }
+
+    result.value = std::move(output);
+    return result;
+}
@@ -14,4 +14,52 @@ namespace wisent::algorithms
             const std::vector<uint8_t>& input
         );
     }; 
+
+    /*
+     * Typed RLE: runs of whole values of a PLAIN page, with varint run
+     * lengths. A constant page shrinks to a few bytes, and a run decodes by
+     * doubling copies of its first value.
+     */
+
+    // the typed decoders refuse pages decoding to more (pages are 1 MB)
+    constexpr uint64_t RLE_MAX_DECOMPRESSED_SIZE = uint64_t{1} << 30;
+
+    // int64 pages: varint count, then (varint run length, zigzag varint value)
+    struct RLEInt64 
+    {
+        static Result<std::vector<uint8_t>> compress(
+            const std::vector<uint8_t>& input
+        );
+
+        static Result<std::vector<uint8_t>> decompress(
+            const std::vector<uint8_t>& input
+        );
+    }; 
+
+    // double pages: varint count, then (varint run length, 8-byte value); 
+    // values are compared bit for bit, so -0.0 and NaN payloads survive
+    struct RLEDouble 
+    {
+        static Result<std::vector<uint8_t>> compress(
+            const std::vector<uint8_t>& input
+        );
+
+        static Result<std::vector<uint8_t>> decompress(
+            const std::vector<uint8_t>& input
+        );
+    }; 
+
+    // string pages ([uint32 length][bytes] per value): varint count, the 
+    // dictionary of distinct values (varint entries, per entry varint length
+    // and bytes), then (varint dictionary code, varint run length) runs
+    struct RLEString 
+    {
+        static Result<std::vector<uint8_t>> compress(
+            const std::vector<uint8_t>& input
+        );
+
+        static Result<std::vector<uint8_t>> decompress(
+            const std::vector<uint8_t>& input
+        );
+    }; 
 } // RLE
\ No newline at end of file
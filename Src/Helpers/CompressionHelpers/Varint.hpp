@@ -0,0 +1,54 @@
+#pragma once
+#ifndef VARINT_HPP
+#define VARINT_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace wisent::algorithms
+{
+    // LEB128: 7 bits per byte, low bits first
+    inline void writeVarint(
+        std::vector<uint8_t>& output,
+        uint64_t value
+    ) {
+        while (value >= 0x80)
+        {
+            output.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    // false if input ends first or the value takes more than 10 bytes
+    inline bool readVarint(
+        const uint8_t*& position,
+        const uint8_t* end,
+        uint64_t& value
+    ) {
+        value = 0;
+        for (int shift = 0; position < end && shift < 64; shift += 7)
+        {
+            uint8_t byte = *position++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // small negative values stay small: 0, -1, 1, -2, ... map to 0, 1, 2, 3, ...
+    inline uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+}
+
+#endif // VARINT_HPP
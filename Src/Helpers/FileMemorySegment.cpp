@@ -0,0 +1,150 @@
+#include "ISharedMemorySegment.hpp"
+#include "WisentHelpers/WisentFile.hpp"
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+using namespace boost::interprocess;
+
+/*
+ * Segment backed by a Wisent file (see WisentFile.hpp) instead of POSIX shm:
+ * survives restarts, and loading is a plain mmap of the file.
+ * The base address handed out skips the WisentFileHeader.
+ */
+class FileMemorySegment : public ISharedMemorySegment
+{
+  private:
+    std::string filePath;
+    std::unique_ptr<file_mapping> file;
+    std::unique_ptr<mapped_region> region;
+    bool writable;
+
+    WisentFileHeader *getHeader() const
+    {
+        return reinterpret_cast<WisentFileHeader *>(region->get_address());
+    }
+
+    void resizeFile(size_t payloadBytes)
+    {
+        if (!std::filesystem::exists(filePath))
+        {
+            std::filesystem::path parent = std::filesystem::path(filePath).parent_path();
+            if (!parent.empty())
+            {
+                std::filesystem::create_directories(parent);
+            }
+            std::ofstream(filePath, std::ios::binary);
+        }
+        std::filesystem::resize_file(filePath, sizeof(WisentFileHeader) + payloadBytes);
+    }
+
+  public:
+    FileMemorySegment(std::string const &filePath)
+        : filePath(filePath), file(nullptr), region(nullptr), writable(false)
+    {}
+    ~FileMemorySegment() = default;
+
+    FileMemorySegment(FileMemorySegment const &other) = delete;
+    FileMemorySegment &operator=(FileMemorySegment const &other) = delete;
+
+    void *malloc(size_t size) override
+    {
+        assert(!isLoaded());
+        writable = true;
+        resizeFile(size);
+        file = std::make_unique<file_mapping>(filePath.c_str(), read_write);
+        region = std::make_unique<mapped_region>(*file, read_write);
+        *getHeader() = makeWisentFileHeader(size);
+        return getBaseAddress();
+    }
+
+    void *realloc(void *pointer, size_t size) override
+    {
+        assert(isLoaded());
+        assert(pointer == getBaseAddress());
+        assert(writable);
+        unload();
+        resizeFile(size);
+        load();
+        getHeader()->payloadBytes = size;
+        return getBaseAddress();
+    }
+
+    void load() override
+    {
+        boost::interprocess::mode_t mode = writable ? read_write : read_only;
+        file = std::make_unique<file_mapping>(filePath.c_str(), mode);
+        region = std::make_unique<mapped_region>(*file, mode);
+        if (!writable && !isValidWisentFileHeader(getHeader(), region->get_size()))
+        {
+            std::cerr << "Invalid or incompatible Wisent file: " << filePath << std::endl;
+            unload();
+        }
+    }
+
+    void unload() override
+    {
+        region.reset();
+        file.reset();
+    }
+
+    void erase() override
+    {
+        unload();
+        std::filesystem::remove(filePath);
+    }
+
+    void free(void *pointer) override
+    {
+        assert(pointer == getBaseAddress());
+        erase();
+    }
+
+    bool exists() const override
+    {
+        std::error_code error;
+        uintmax_t fileBytes = std::filesystem::file_size(filePath, error);
+        return !error && fileBytes > sizeof(WisentFileHeader);
+    }
+
+    bool isLoaded() const override
+    {
+        return region.get() != nullptr;
+    }
+
+    void *getBaseAddress() const override
+    {
+        assert(isLoaded());
+        return reinterpret_cast<char *>(region->get_address()) + getHeader()->headerBytes;
+    }
+
+    size_t getSize() const override
+    {
+        assert(isLoaded());
+        return getHeader()->payloadBytes;
+    }
+
+    bool isFileBacked() const override
+    {
+        return true;
+    }
+};
+
+namespace SharedMemorySegments
+{
+    SegmentHandle createOrGetFileMemorySegment(
+        std::string const &name,
+        std::string const &filePath
+    ) {
+        SegmentHandle existing = findMemorySegment(name);
+        if (existing)
+        {
+            return existing;
+        }
+        return registerMemorySegment(name, std::make_shared<FileMemorySegment>(filePath));
+    }
+}
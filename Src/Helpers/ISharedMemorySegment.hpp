@@ -1,5 +1,6 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <unordered_map>
 #include <memory>
 #include <boost/interprocess/mapped_region.hpp>
@@ -19,19 +20,78 @@ public:
     virtual bool isLoaded() const = 0;
     virtual void *getBaseAddress() const = 0;
     virtual size_t getSize() const = 0;
+    // contents stay on disk after unload (see FileMemorySegment.cpp)
+    virtual bool isFileBacked() const { return false; }
     virtual ~ISharedMemorySegment() = default;
 };
 
 namespace SharedMemorySegments
 {
-    static std::unordered_map<std::string, std::unique_ptr<ISharedMemorySegment>> sharedMemorySegmentsList;
-    static ISharedMemorySegment *currentSharedMemoryPtr;
+    using SharedMemorySegmentMap = std::unordered_map<std::string, std::shared_ptr<ISharedMemorySegment>>;
 
-    ISharedMemorySegment *createOrGetMemorySegment(std::string const &name);
-    std::unordered_map<std::string, std::unique_ptr<ISharedMemorySegment>> &getSharedMemorySegments();
+    /*
+     * Counted reference to a registered segment:
+     * the registry does not erase a segment while handles to it are alive.
+     */
+    class SegmentHandle
+    {
+      private:
+        std::shared_ptr<ISharedMemorySegment> segment;
+
+      public:
+        SegmentHandle() = default;
+        explicit SegmentHandle(std::shared_ptr<ISharedMemorySegment> segment)
+            : segment(std::move(segment))
+        {}
+
+        ISharedMemorySegment *get() const { return segment.get(); }
+        ISharedMemorySegment *operator->() const { return segment.get(); }
+        explicit operator bool() const { return segment != nullptr; }
+        void release() { segment.reset(); }
+    };
+
+    // default segment type (SharedMemorySegment.cpp, or the mock in the unit tests)
+    std::shared_ptr<ISharedMemorySegment> makeMemorySegment(std::string const &name);
+
+    // memfd segments, sealed read-only once built (MemfdMemorySegment.cpp)
+    std::shared_ptr<ISharedMemorySegment> makeMemfdMemorySegment(std::string const &name);
+    bool sealMemfdMemorySegment(std::string const &name);
+    int getMemfdFileDescriptor(SegmentHandle const &handle);   // -1 unless a sealed memfd segment
+
+    // process-wide registry, reader-biased locking (SharedMemoryRegistry.cpp)
+    using MemorySegmentFactory = std::shared_ptr<ISharedMemorySegment> (*)(std::string const &name);
+    void setMemorySegmentFactory(MemorySegmentFactory factory);     // makeMemorySegment by default
+    SegmentHandle createOrGetMemorySegment(std::string const &name);
+    SegmentHandle findMemorySegment(std::string const &name);     // empty handle if not registered
+    SegmentHandle registerMemorySegment(std::string const &name, std::shared_ptr<ISharedMemorySegment> segment);
+    std::shared_ptr<ISharedMemorySegment> takeMemorySegment(std::string const &name);
+    long getReferenceCount(std::string const &name);
+    bool eraseMemorySegment(std::string const &name);   // false while the segment is referenced
+    size_t getMemorySegmentCount();
+    // drops every registration without erasing the segments, for tools and tests
+    void clearMemorySegments();
+
+    // segment mapped from a persistent Wisent file (FileMemorySegment.cpp)
+    SegmentHandle createOrGetFileMemorySegment(std::string const &name, std::string const &filePath);
+
+    // allocation target of the calling thread, for the function-pointer based helpers
     ISharedMemorySegment *getCurrentSharedMemory();
     void setCurrentSharedMemory(ISharedMemorySegment* sharedMemory);
     void *sharedMemoryMalloc(size_t size);
     void *sharedMemoryRealloc(void *pointer, size_t size);
     void sharedMemoryFree(void *pointer);
+    void *sharedMemoryMalloc(ISharedMemorySegment *sharedMemory, size_t size);
+    void *sharedMemoryRealloc(ISharedMemorySegment *sharedMemory, void *pointer, size_t size);
+    void sharedMemoryFree(ISharedMemorySegment *sharedMemory, void *pointer);
+
+    // double-buffered publishing of rebuilt segments (SegmentDirectory.cpp)
+    std::string getGenerationSegmentName(std::string const &name, uint64_t generation);
+    uint64_t getPublishedGeneration(std::string const &name);
+    SegmentHandle createOrGetPublishedMemorySegment(std::string const &name);
+    SegmentHandle createStagingMemorySegment(std::string const &name);
+    // empty if nothing was staged and built for name
+    SegmentHandle publishMemorySegment(std::string const &name);
+    // abandoned build: drops the staged generation
+    void discardUnpublishedMemorySegment(std::string const &name);
+    void freePublishedMemorySegments(std::string const &name);
 }
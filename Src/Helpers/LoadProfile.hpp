@@ -0,0 +1,129 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/resource.h>
+
+/*
+ * Where the time of one load goes: wall-clock seconds and number of calls per
+ * phase ("count pass", "csv parse", "type inference", "encoding",
+ * "compress <column>", "segment resize", ...), a few counters and the peak
+ * resident set size of the process.
+ * Phases nest (a "csv parse" happens during the "count pass"), so their sum
+ * exceeds the total. Recording takes a lock: hot loops accumulate locally and
+ * record once.
+ */
+class LoadProfile
+{
+  public:
+    struct PhaseTiming
+    {
+        double seconds = 0.0;
+        size_t count = 0;
+    };
+
+    void addPhaseTime(
+        std::string const &phase,
+        double seconds,
+        size_t count = 1
+    ) {
+        std::lock_guard<std::mutex> lock(mutex);
+        PhaseTiming &timing = phaseTimings[phase];
+        timing.seconds += seconds;
+        timing.count += count;
+    }
+
+    void addCounter(
+        std::string const &name,
+        size_t amount
+    ) {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters[name] += amount;
+    }
+
+    // getrusage reports the peak of the whole process, not of this load alone
+    void recordPeakResidentSetSize()
+    {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            peakResidentSetBytes = static_cast<size_t>(usage.ru_maxrss) * 1024;     // kilobytes on Linux
+        }
+    }
+
+    std::map<std::string, PhaseTiming> getPhaseTimings() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return phaseTimings;
+    }
+
+    std::map<std::string, size_t> getCounters() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return counters;
+    }
+
+    size_t getPeakResidentSetBytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return peakResidentSetBytes;
+    }
+
+  private:
+    mutable std::mutex mutex;
+    std::map<std::string, PhaseTiming> phaseTimings;
+    std::map<std::string, size_t> counters;
+    size_t peakResidentSetBytes = 0;
+};
+
+// records the time until stop() or destruction, does nothing without a profile
+class PhaseTimer
+{
+  public:
+    PhaseTimer(
+        LoadProfile *profile,
+        std::string phase
+    ) : profile(profile), phase(std::move(phase))
+    {
+        if (profile != nullptr)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PhaseTimer()
+    {
+        stop();
+    }
+
+    PhaseTimer(PhaseTimer const &other) = delete;
+    PhaseTimer &operator=(PhaseTimer const &other) = delete;
+
+    void stop()
+    {
+        if (profile == nullptr)
+        {
+            return;
+        }
+        profile->addPhaseTime(
+            phase,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+        );
+        profile = nullptr;
+    }
+
+    // records the time under another phase instead (e.g. once the outcome is known)
+    void stopAs(std::string const &otherPhase)
+    {
+        phase = otherPhase;
+        stop();
+    }
+
+  private:
+    LoadProfile *profile;
+    std::string phase;
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,237 @@
+#pragma once
+#include "LoadProfile.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <string>
+
+enum class LoadPhase : uint8_t
+{
+    Queued,
+    Counting,       // 1st traversal: sizes of the expression tree
+    ParsingCsv,
+    Compressing,    // compression pipelines of the matched columns
+    Building,       // 2nd traversal: populating the expression tree
+    Done,
+    Failed,
+    Cancelled
+};
+
+inline char const *getLoadPhaseName(LoadPhase phase)
+{
+    switch (phase)
+    {
+        case LoadPhase::Queued: return "queued";
+        case LoadPhase::Counting: return "counting";
+        case LoadPhase::ParsingCsv: return "csv parse";
+        case LoadPhase::Compressing: return "compress";
+        case LoadPhase::Building: return "build";
+        case LoadPhase::Done: return "done";
+        case LoadPhase::Failed: return "failed";
+        case LoadPhase::Cancelled: return "cancelled";
+    }
+    return "unknown";
+}
+
+/*
+ * Progress of one dataset load, written by the loading thread and read by
+ * any other (all fields are atomics, no lock, except the profile).
+ * Bytes count the JSON file once per traversal plus every CSV file read;
+ * the total grows while the 1st traversal discovers CSV files, so the ETA is
+ * an estimate from the throughput so far.
+ */
+class LoadProgress
+{
+  public:
+    LoadProgress() : startTime(std::chrono::steady_clock::now()) {}
+
+    void setPhase(LoadPhase newPhase) { phase = newPhase; }
+    LoadPhase getPhase() const { return phase; }
+
+    void start()
+    {
+        startTime = std::chrono::steady_clock::now();
+        phase = LoadPhase::Counting;
+    }
+
+    void addTotalBytes(size_t bytes) { totalBytes += bytes; }
+    void addProcessedBytes(size_t bytes) { processedBytes += bytes; }
+    void addProcessedRows(size_t rows) { processedRows += rows; }
+
+    size_t getTotalBytes() const { return totalBytes; }
+    size_t getProcessedBytes() const { return processedBytes; }
+    size_t getProcessedRows() const { return processedRows; }
+
+    double getElapsedSeconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime.load()).count();
+    }
+
+    // negative while nothing is processed yet
+    double getEstimatedSecondsRemaining() const
+    {
+        size_t processed = processedBytes;
+        size_t total = totalBytes;
+        if (processed == 0 || total < processed)
+        {
+            return -1.0;
+        }
+        return getElapsedSeconds() * static_cast<double>(total - processed) / static_cast<double>(processed);
+    }
+
+    // loaders stop at their next check and return an error Result
+    void requestCancel() { cancelRequested = true; }
+    bool isCancelRequested() const { return cancelRequested; }
+
+    LoadProfile &getProfile() { return profile; }
+    LoadProfile const &getProfile() const { return profile; }
+
+  private:
+    std::atomic<LoadPhase> phase{LoadPhase::Queued};
+    std::atomic<size_t> totalBytes{0};
+    std::atomic<size_t> processedBytes{0};
+    std::atomic<size_t> processedRows{0};
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<std::chrono::steady_clock::time_point> startTime;
+    LoadProfile profile;
+};
+
+/*
+ * Feeds a LoadProgress from the JSON traversals of one load. Does nothing
+ * without a LoadProgress, so loaders call it unconditionally; the stream
+ * position is only sampled every EventsPerSample parse events.
+ * Loaders poll isCancelled() between parse events: the 1st traversal then
+ * skips the remaining work (CSV files), the 2nd one aborts the SAX parse.
+ */
+class LoadProgressReporter
+{
+  public:
+    LoadProgressReporter(
+        LoadProgress *progress,
+        std::istream &stream,
+        size_t streamBytes
+    ) : progress(progress), stream(stream), reportedStreamBytes(0), events(0)
+    {
+        if (progress != nullptr)
+        {
+            progress->addTotalBytes(2 * streamBytes);   // both traversals read it
+        }
+    }
+
+    void startTraversal(LoadPhase phase)
+    {
+        if (progress == nullptr)
+        {
+            return;
+        }
+        progress->setPhase(phase);
+        traversalPhase = phase;
+        reportedStreamBytes = 0;
+        traversalStart = std::chrono::steady_clock::now();
+    }
+
+    void onParseEvent()
+    {
+        if (progress == nullptr || ++events % EventsPerSample != 0)
+        {
+            return;
+        }
+        reportStreamPosition();
+    }
+
+    void startCsvFile()
+    {
+        if (progress == nullptr)
+        {
+            return;
+        }
+        if (traversalPhase != LoadPhase::Building)
+        {
+            progress->setPhase(LoadPhase::ParsingCsv);
+        }
+    }
+
+    void startCompressing()
+    {
+        if (progress != nullptr)
+        {
+            progress->setPhase(LoadPhase::Compressing);
+        }
+    }
+
+    void finishCsvFile(
+        std::string const &path,
+        size_t rows
+    ) {
+        if (progress == nullptr)
+        {
+            return;
+        }
+        std::error_code error;
+        size_t bytes = std::filesystem::file_size(path, error);
+        bytes = error ? 0 : bytes;
+        if (traversalPhase == LoadPhase::Building)
+        {
+            progress->addProcessedRows(rows);
+        }
+        else
+        {
+            progress->addTotalBytes(2 * bytes);     // read again while building
+        }
+        progress->addProcessedBytes(bytes);
+        progress->setPhase(traversalPhase);
+    }
+
+    void finishTraversal(size_t streamBytes)
+    {
+        if (progress == nullptr)
+        {
+            return;
+        }
+        if (streamBytes > reportedStreamBytes)
+        {
+            progress->addProcessedBytes(streamBytes - reportedStreamBytes);
+            reportedStreamBytes = streamBytes;
+        }
+        LoadProfile &profile = progress->getProfile();
+        profile.addPhaseTime(
+            traversalPhase == LoadPhase::Building ? "build pass" : "count pass",
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - traversalStart).count()
+        );
+        profile.recordPeakResidentSetSize();
+    }
+
+    // for PhaseTimer, null without a LoadProgress
+    LoadProfile *getProfile() const
+    {
+        return progress != nullptr ? &progress->getProfile() : nullptr;
+    }
+
+    bool isCancelled() const
+    {
+        return progress != nullptr && progress->isCancelRequested();
+    }
+
+  private:
+    static constexpr uint32_t EventsPerSample = 1 << 16;
+
+    LoadProgress *progress;
+    std::istream &stream;
+    LoadPhase traversalPhase = LoadPhase::Counting;
+    size_t reportedStreamBytes;
+    uint32_t events;
+    std::chrono::steady_clock::time_point traversalStart;
+
+    void reportStreamPosition()
+    {
+        std::streamoff position = stream.tellg();
+        if (position > 0 && static_cast<size_t>(position) > reportedStreamBytes)
+        {
+            progress->addProcessedBytes(position - reportedStreamBytes);
+            reportedStreamBytes = position;
+        }
+    }
+};
@@ -0,0 +1,210 @@
+#include "ISharedMemorySegment.hpp"
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Anonymous segment backed by memfd_create: there is no name to race on or
+ * to leak, consumers get the file descriptor passed over a Unix domain socket
+ * (see FdPassingServer.hpp) and the kernel frees the memory once the last
+ * descriptor and mapping are gone.
+ * After the build, seal() makes the contents immutable (F_SEAL_WRITE/GROW/SHRINK),
+ * so every reader is guaranteed a stable zero-copy view.
+ */
+class MemfdMemorySegment : public ISharedMemorySegment
+{
+  private:
+    std::string name;
+    int fileDescriptor;
+    void *address;
+    size_t size;
+    bool sealed;
+
+    void map(size_t bytes)
+    {
+        int protection = sealed ? PROT_READ : PROT_READ | PROT_WRITE;
+        void *mapped = mmap(nullptr, bytes, protection, MAP_SHARED, fileDescriptor, 0);
+        if (mapped == MAP_FAILED)
+        {
+            std::cerr << "Failed to map memfd segment: " << name << std::endl;
+            return;
+        }
+        address = mapped;
+        size = bytes;
+    }
+
+    void resize(size_t bytes)
+    {
+        if (fileDescriptor < 0)
+        {
+            fileDescriptor = memfd_create(name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        }
+        if (fileDescriptor < 0 || ftruncate(fileDescriptor, bytes) != 0)
+        {
+            std::cerr << "Failed to allocate memfd segment: " << name << std::endl;
+        }
+    }
+
+  public:
+    MemfdMemorySegment(std::string const &name)
+        : name(name), fileDescriptor(-1), address(nullptr), size(0), sealed(false)
+    {}
+    ~MemfdMemorySegment()
+    {
+        erase();
+    }
+
+    MemfdMemorySegment(MemfdMemorySegment const &other) = delete;
+    MemfdMemorySegment &operator=(MemfdMemorySegment const &other) = delete;
+
+    void *malloc(size_t bytes) override
+    {
+        assert(!isLoaded());
+        assert(!sealed);
+        resize(bytes);
+        map(bytes);
+        return getBaseAddress();
+    }
+
+    void *realloc(void *pointer, size_t bytes) override
+    {
+        assert(isLoaded());
+        assert(pointer == getBaseAddress());
+        assert(!sealed);
+        unload();
+        resize(bytes);
+        map(bytes);
+        return getBaseAddress();
+    }
+
+    void load() override
+    {
+        struct stat status;
+        if (fileDescriptor >= 0 && fstat(fileDescriptor, &status) == 0 && status.st_size > 0)
+        {
+            map(status.st_size);
+        }
+    }
+
+    void unload() override
+    {
+        if (address != nullptr)
+        {
+            munmap(address, size);
+        }
+        address = nullptr;
+        size = 0;
+    }
+
+    // readers holding the descriptor or a mapping keep the memory alive
+    void erase() override
+    {
+        unload();
+        if (fileDescriptor >= 0)
+        {
+            close(fileDescriptor);
+        }
+        fileDescriptor = -1;
+        sealed = false;
+    }
+
+    void free(void *pointer) override
+    {
+        assert(pointer == getBaseAddress());
+        erase();
+    }
+
+    bool exists() const override
+    {
+        struct stat status;
+        return fileDescriptor >= 0 && fstat(fileDescriptor, &status) == 0 && status.st_size > 0;
+    }
+
+    bool isLoaded() const override
+    {
+        return address != nullptr;
+    }
+
+    void *getBaseAddress() const override
+    {
+        assert(isLoaded());
+        return address;
+    }
+
+    size_t getSize() const override
+    {
+        assert(isLoaded());
+        return size;
+    }
+
+    /*
+     * F_SEAL_WRITE is refused while writable shared mappings exist,
+     * so the writable mapping is replaced by a read-only one (possibly at a
+     * different address).
+     */
+    bool seal()
+    {
+        if (sealed)
+        {
+            return true;
+        }
+        if (!exists())
+        {
+            return false;
+        }
+        bool wasLoaded = isLoaded();
+        unload();
+        int seals = F_SEAL_WRITE | F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL;
+        if (fcntl(fileDescriptor, F_ADD_SEALS, seals) != 0)
+        {
+            std::cerr << "Failed to seal memfd segment: " << name << std::endl;
+            return false;
+        }
+        sealed = true;
+        if (wasLoaded)
+        {
+            load();
+        }
+        return true;
+    }
+
+    bool isSealed() const
+    {
+        return sealed;
+    }
+
+    int getFileDescriptor() const
+    {
+        return fileDescriptor;
+    }
+};
+
+namespace SharedMemorySegments
+{
+    std::shared_ptr<ISharedMemorySegment> makeMemfdMemorySegment(std::string const &name)
+    {
+        return std::make_shared<MemfdMemorySegment>(name);
+    }
+
+    bool sealMemfdMemorySegment(std::string const &name)
+    {
+        SegmentHandle handle = findMemorySegment(name);
+        MemfdMemorySegment *segment = dynamic_cast<MemfdMemorySegment *>(handle.get());
+        return segment != nullptr && segment->seal();
+    }
+
+    int getMemfdFileDescriptor(SegmentHandle const &handle)
+    {
+        MemfdMemorySegment *segment = dynamic_cast<MemfdMemorySegment *>(handle.get());
+        if (segment == nullptr || !segment->isSealed())
+        {
+            return -1;
+        }
+        return segment->getFileDescriptor();
+    }
+}
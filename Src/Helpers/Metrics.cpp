@@ -0,0 +1,231 @@
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+
+namespace
+{
+    std::atomic<size_t> nextShard{0};
+
+    // threads take the shards round-robin, so a pool of N <= ShardCount
+    // workers never shares one
+    size_t getShardIndex(size_t shardCount)
+    {
+        thread_local size_t shardIndex = nextShard.fetch_add(1, std::memory_order_relaxed);
+        return shardIndex % shardCount;
+    }
+
+    std::string escapeLabelValue(std::string const &value)
+    {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for (char character : value)
+        {
+            switch (character)
+            {
+                case '\\': escaped += "\\\\"; break;
+                case '"': escaped += "\\\""; break;
+                case '\n': escaped += "\\n"; break;
+                default: escaped += character;
+            }
+        }
+        return escaped;
+    }
+
+    // 'endpoint="/serialize",status="200"', extra is appended (histogram "le")
+    std::string formatLabels(
+        Metrics::Labels const &labels,
+        std::string const &extra = ""
+    ) {
+        std::string formatted;
+        for (auto const &[key, value] : labels)
+        {
+            formatted += (formatted.empty() ? "" : ",") + key + "=\"" + escapeLabelValue(value) + "\"";
+        }
+        if (!extra.empty())
+        {
+            formatted += (formatted.empty() ? "" : ",") + extra;
+        }
+        return formatted.empty() ? "" : "{" + formatted + "}";
+    }
+
+    std::string formatValue(double value)
+    {
+        std::ostringstream stream;
+        stream << value;
+        return stream.str();
+    }
+
+    struct Family
+    {
+        std::string help;
+        std::string type;
+        // keyed by the formatted labels, so the output is sorted and stable
+        std::map<std::string, std::pair<Metrics::Labels, std::unique_ptr<Metrics::Counter>>> counters;
+        std::map<std::string, std::pair<Metrics::Labels, std::unique_ptr<Metrics::Histogram>>> histograms;
+        Metrics::GaugeFunction gaugeFunction;
+    };
+
+    std::mutex registryMutex;
+    std::map<std::string, Family> families;
+
+    // caller holds registryMutex
+    Family &getFamily(
+        std::string const &name,
+        std::string const &help,
+        std::string const &type
+    ) {
+        Family &family = families[name];
+        if (family.type.empty())
+        {
+            family.help = help;
+            family.type = type;
+        }
+        return family;
+    }
+}
+
+namespace Metrics
+{
+    void Counter::add(uint64_t amount)
+    {
+        shards[getShardIndex(ShardCount)].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint64_t Counter::getValue() const
+    {
+        uint64_t total = 0;
+        for (Shard const &shard : shards)
+        {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void Histogram::observe(double seconds)
+    {
+        size_t bucket = 0;
+        while (bucket < BucketCount && seconds > getBucketBound(bucket))
+        {
+            bucket++;
+        }
+        buckets[bucket].add();
+        sumNanoseconds.add(static_cast<uint64_t>(std::max(seconds, 0.0) * 1e9));
+    }
+
+    double Histogram::getBucketBound(size_t bucket)
+    {
+        return std::ldexp(0.001, static_cast<int>(bucket));
+    }
+
+    uint64_t Histogram::getBucketCount(size_t bucket) const
+    {
+        return buckets[bucket].getValue();
+    }
+
+    uint64_t Histogram::getCount() const
+    {
+        uint64_t count = 0;
+        for (Counter const &bucket : buckets)
+        {
+            count += bucket.getValue();
+        }
+        return count;
+    }
+
+    double Histogram::getSum() const
+    {
+        return static_cast<double>(sumNanoseconds.getValue()) * 1e-9;
+    }
+
+    Counter &getCounter(
+        std::string const &name,
+        std::string const &help,
+        Labels const &labels
+    ) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto &entry = getFamily(name, help, "counter").counters[formatLabels(labels)];
+        if (entry.second == nullptr)
+        {
+            entry = {labels, std::make_unique<Counter>()};
+        }
+        return *entry.second;
+    }
+
+    Histogram &getHistogram(
+        std::string const &name,
+        std::string const &help,
+        Labels const &labels
+    ) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto &entry = getFamily(name, help, "histogram").histograms[formatLabels(labels)];
+        if (entry.second == nullptr)
+        {
+            entry = {labels, std::make_unique<Histogram>()};
+        }
+        return *entry.second;
+    }
+
+    void setGauge(
+        std::string const &name,
+        std::string const &help,
+        GaugeFunction gaugeFunction
+    ) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        getFamily(name, help, "gauge").gaugeFunction = std::move(gaugeFunction);
+    }
+
+    std::string renderPrometheus()
+    {
+        // gauges are called without the lock: they may take locks of their
+        // own, under which counters get registered
+        std::vector<std::tuple<std::string, std::string, GaugeFunction>> sections;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (auto const &[name, family] : families)
+            {
+                std::string output = "# HELP " + name + " " + family.help + "\n";
+                output += "# TYPE " + name + " " + family.type + "\n";
+                for (auto const &[formattedLabels, entry] : family.counters)
+                {
+                    output += name + formattedLabels + " " + std::to_string(entry.second->getValue()) + "\n";
+                }
+                for (auto const &[formattedLabels, entry] : family.histograms)
+                {
+                    Histogram const &histogram = *entry.second;
+                    uint64_t cumulative = 0;
+                    for (size_t bucket = 0; bucket <= Histogram::BucketCount; bucket++)
+                    {
+                        cumulative += histogram.getBucketCount(bucket);
+                        std::string bound = bucket < Histogram::BucketCount
+                            ? formatValue(Histogram::getBucketBound(bucket))
+                            : "+Inf";
+                        output += name + "_bucket" + formatLabels(entry.first, "le=\"" + bound + "\"")
+                            + " " + std::to_string(cumulative) + "\n";
+                    }
+                    output += name + "_sum" + formattedLabels + " " + formatValue(histogram.getSum()) + "\n";
+                    output += name + "_count" + formattedLabels + " " + std::to_string(cumulative) + "\n";
+                }
+                sections.emplace_back(name, std::move(output), family.gaugeFunction);
+            }
+        }
+
+        std::string output;
+        for (auto const &[name, section, gaugeFunction] : sections)
+        {
+            output += section;
+            if (!gaugeFunction)
+            {
+                continue;
+            }
+            for (auto const &[labels, value] : gaugeFunction())
+            {
+                output += name + formatLabels(labels) + " " + formatValue(value) + "\n";
+            }
+        }
+        return output;
+    }
+}
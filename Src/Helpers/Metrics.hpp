@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Process-wide metrics, rendered in the Prometheus text format (GET /metrics).
+ *
+ * Counters are sharded by thread: an increment is one relaxed atomic add on a
+ * cache line of its own, so instrumented hot paths neither lock nor bounce a
+ * shared line between cores; a scrape sums the shards. Registration takes a
+ * lock, so hot paths keep the returned reference (e.g. in a function-local
+ * static) instead of looking the metric up per call.
+ */
+namespace Metrics
+{
+    // {{"endpoint", "/serialize"}, {"status", "200"}}
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    class Counter
+    {
+      public:
+        void add(uint64_t amount = 1);
+        uint64_t getValue() const;
+
+      private:
+        static constexpr size_t ShardCount = 16;
+        struct alignas(64) Shard
+        {
+            std::atomic<uint64_t> value{0};
+        };
+        std::array<Shard, ShardCount> shards;
+    };
+
+    // latencies in seconds, with fixed buckets from 1 ms to ~65 s (powers of 2)
+    class Histogram
+    {
+      public:
+        static constexpr size_t BucketCount = 17;
+
+        void observe(double seconds);
+
+        static double getBucketBound(size_t bucket);
+        uint64_t getBucketCount(size_t bucket) const;  // not cumulative
+        uint64_t getCount() const;
+        double getSum() const;
+
+      private:
+        std::array<Counter, BucketCount + 1> buckets;  // the last one is +Inf
+        Counter sumNanoseconds;
+    };
+
+    // returns the same metric for the same name & labels
+    Counter &getCounter(
+        std::string const &name,
+        std::string const &help,
+        Labels const &labels = {}
+    );
+
+    Histogram &getHistogram(
+        std::string const &name,
+        std::string const &help,
+        Labels const &labels = {}
+    );
+
+    // evaluated at every scrape: one sample per returned label set,
+    // replaces an earlier gauge of the same name
+    using GaugeFunction = std::function<std::vector<std::pair<Labels, double>>()>;
+    void setGauge(
+        std::string const &name,
+        std::string const &help,
+        GaugeFunction gaugeFunction
+    );
+
+    std::string renderPrometheus();
+}
@@ -0,0 +1,200 @@
+#include "ISharedMemorySegment.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <vector>
+
+/*
+ * Double-buffered publishing of built segments.
+ * Every build, the first one included, is written into a staging segment 
+ * "<name>.g<generation>", then made visible by atomically storing its 
+ * generation in the directory segment "<name>.generation" (generation 0 is 
+ * the plain "<name>" segment of loaders that do not publish, which needs no 
+ * directory). The previously published segment is retired instead of
+ * unmapped: it is dropped on a later publish of the same name, once no
+ * SegmentHandle refers to it anymore.
+ *
+ * Only handles of this process are counted. Readers in other processes
+ * keep a generation they have mapped (unlinking does not unmap it), but one
+ * that read the directory and has not opened the generation yet can find it
+ * gone and has to read the directory again (see openPublished() in
+ * WisentDeserializer.py).
+ */
+namespace
+{
+    std::string const DirectorySuffix = ".generation";
+    std::string const GenerationSuffix = ".g";
+
+    std::mutex directoryMutex;
+    // staged but not yet published generation, per dataset
+    std::unordered_map<std::string, uint64_t> stagedGenerations;
+    // previously published segments, per dataset, kept while still referenced
+    std::unordered_map<std::string, std::vector<std::shared_ptr<ISharedMemorySegment>>> retiredSegments;
+
+    void eraseUnreferenced(std::vector<std::shared_ptr<ISharedMemorySegment>> &retired)
+    {
+        for (auto it = retired.begin(); it != retired.end();)
+        {
+            if (it->use_count() > 1)
+            {
+                ++it;
+                continue;
+            }
+            (*it)->erase();
+            it = retired.erase(it);
+        }
+    }
+
+    std::atomic<uint64_t> *getDirectoryEntry(ISharedMemorySegment *directory)
+    {
+        return reinterpret_cast<std::atomic<uint64_t> *>(directory->getBaseAddress());
+    }
+}
+
+namespace SharedMemorySegments
+{
+    std::string getGenerationSegmentName(
+        std::string const &name,
+        uint64_t generation
+    ) {
+        if (generation == 0)
+        {
+            return name;
+        }
+        return name + GenerationSuffix + std::to_string(generation);
+    }
+
+    uint64_t getPublishedGeneration(std::string const &name)
+    {
+        SegmentHandle directory = createOrGetMemorySegment(name + DirectorySuffix);
+        if (!directory->exists())
+        {
+            // never republished: don't leave an empty directory segment behind
+            directory.release();
+            eraseMemorySegment(name + DirectorySuffix);
+            return 0;
+        }
+        if (!directory->isLoaded())
+        {
+            directory->load();
+        }
+        return getDirectoryEntry(directory.get())->load(std::memory_order_acquire);
+    }
+
+    SegmentHandle createOrGetPublishedMemorySegment(std::string const &name)
+    {
+        SegmentHandle existing = findMemorySegment(name);
+        if (existing)
+        {
+            return existing;
+        }
+        uint64_t generation = getPublishedGeneration(name);
+        if (generation == 0)
+        {
+            return createOrGetMemorySegment(name);
+        }
+        std::string generationName = getGenerationSegmentName(name, generation);
+        createOrGetMemorySegment(generationName);
+        return registerMemorySegment(name, takeMemorySegment(generationName));
+    }
+
+    SegmentHandle createStagingMemorySegment(std::string const &name)
+    {
+        uint64_t generation = getPublishedGeneration(name) + 1;
+        std::string stagingName = getGenerationSegmentName(name, generation);
+
+        SegmentHandle staging = createOrGetMemorySegment(stagingName);
+        if (staging->exists())
+        {
+            // leftover of an interrupted rebuild, never published
+            staging.release();
+            eraseMemorySegment(stagingName);
+            staging = createOrGetMemorySegment(stagingName);
+        }
+        std::lock_guard<std::mutex> lock(directoryMutex);
+        stagedGenerations[name] = generation;
+        return staging;
+    }
+
+    SegmentHandle publishMemorySegment(std::string const &name)
+    {
+        std::lock_guard<std::mutex> lock(directoryMutex);
+        auto staged = stagedGenerations.find(name);
+        if (staged == stagedGenerations.end())
+        {
+            return SegmentHandle();
+        }
+        uint64_t generation = staged->second;
+        stagedGenerations.erase(staged);
+
+        std::shared_ptr<ISharedMemorySegment> segment = takeMemorySegment(
+            getGenerationSegmentName(name, generation)
+        );
+        if (!segment || !segment->isLoaded())
+        {
+            // nothing was built into it: the published generation stays
+            return SegmentHandle();
+        }
+
+        SegmentHandle directory = createOrGetMemorySegment(name + DirectorySuffix);
+        if (!directory->exists())
+        {
+            new (directory->malloc(sizeof(std::atomic<uint64_t>))) std::atomic<uint64_t>(0);
+        }
+        else if (!directory->isLoaded())
+        {
+            directory->load();
+        }
+        // the switch: new readers resolve to the new generation from here on
+        getDirectoryEntry(directory.get())->store(generation, std::memory_order_release);
+
+        std::vector<std::shared_ptr<ISharedMemorySegment>> &retired = retiredSegments[name];
+        eraseUnreferenced(retired);
+        std::shared_ptr<ISharedMemorySegment> previous = takeMemorySegment(name);
+        if (previous)
+        {
+            retired.push_back(std::move(previous));
+        }
+
+        return registerMemorySegment(name, std::move(segment));
+    }
+
+    void discardUnpublishedMemorySegment(std::string const &name)
+    {
+        std::lock_guard<std::mutex> lock(directoryMutex);
+        auto staged = stagedGenerations.find(name);
+        if (staged == stagedGenerations.end())
+        {
+            // cancelled before anything was staged
+            return;
+        }
+        eraseMemorySegment(getGenerationSegmentName(name, staged->second));
+        stagedGenerations.erase(staged);
+    }
+
+    void freePublishedMemorySegments(std::string const &name)
+    {
+        std::lock_guard<std::mutex> lock(directoryMutex);
+        auto retired = retiredSegments.find(name);
+        if (retired != retiredSegments.end())
+        {
+            eraseUnreferenced(retired->second);
+            if (retired->second.empty())
+            {
+                retiredSegments.erase(retired);
+            }
+        }
+        auto staged = stagedGenerations.find(name);
+        if (staged != stagedGenerations.end())
+        {
+            eraseMemorySegment(getGenerationSegmentName(name, staged->second));
+            stagedGenerations.erase(staged);
+        }
+        createOrGetMemorySegment(name + DirectorySuffix);
+        eraseMemorySegment(name + DirectorySuffix);
+    }
+}
@@ -0,0 +1,217 @@
+#include "DatasetCache.hpp"
+#include "../ISharedMemorySegment.hpp"
+#include "../Metrics.hpp"
+#include "../../WisentSerializer/WisentSerializer.hpp"
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <memory>
+
+DatasetCache::Lease::Lease(
+    DatasetCache *cache,
+    std::string const &name
+) : cache(cache), name(name)
+{}
+
+DatasetCache::Lease::Lease(Lease &&other) noexcept
+    : cache(other.cache), name(std::move(other.name))
+{
+    other.cache = nullptr;
+}
+
+DatasetCache::Lease::~Lease()
+{
+    if (cache != nullptr)
+    {
+        cache->release(name);
+    }
+}
+
+DatasetCache::DatasetCache(
+    size_t memoryBudgetBytes,
+    std::string const &persistDirectory
+) : memoryBudgetBytes(memoryBudgetBytes),
+    persistDirectory(persistDirectory),
+    loadedBytes(0)
+{}
+
+DatasetCache::Lease DatasetCache::lease(std::string const &name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    leases[name]++;
+    return Lease(this, name);
+}
+
+void DatasetCache::release(std::string const &name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = leases.find(name);
+    if (it != leases.end() && --it->second == 0)
+    {
+        leases.erase(it);
+    }
+}
+
+std::vector<std::string> DatasetCache::admit(std::string const &name)
+{
+    std::vector<std::pair<std::string, size_t>> victims;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        SharedMemorySegments::SegmentHandle segment = SharedMemorySegments::findMemorySegment(name);
+        if (!segment || !segment->isLoaded())
+        {
+            return {};
+        }
+        size_t bytes = segment->getSize();
+        segment.release();      // a held handle would keep the dataset from being evicted
+
+        auto it = entries.find(name);
+        if (it != entries.end())
+        {
+            loadedBytes -= it->second.bytes;
+            recentlyUsed.erase(it->second.position);
+            entries.erase(it);
+        }
+        recentlyUsed.push_front(name);
+        entries[name] = Entry{recentlyUsed.begin(), bytes};
+        loadedBytes += bytes;
+
+        if (memoryBudgetBytes == 0)
+        {
+            return {};
+        }
+        auto candidate = recentlyUsed.end();
+        while (loadedBytes > memoryBudgetBytes && candidate != recentlyUsed.begin())
+        {
+            --candidate;
+            if (*candidate == name || !isIdle(*candidate))
+            {
+                continue;
+            }
+            std::string victim = *candidate;
+            candidate = recentlyUsed.erase(candidate);
+            victims.emplace_back(victim, entries[victim].bytes);
+            loadedBytes -= entries[victim].bytes;
+            entries.erase(victim);
+        }
+    }
+
+    // persisting writes a whole dataset: done unlocked, so leases and loads go on meanwhile
+    std::vector<std::string> evicted;
+    for (auto const &[victim, bytes] : victims)
+    {
+        if (evict(victim))
+        {
+            evicted.push_back(victim);
+            continue;
+        }
+        // taken by a request since: back in the cache, least recently used
+        std::lock_guard<std::mutex> lock(mutex);
+        if (entries.find(victim) == entries.end())
+        {
+            recentlyUsed.push_back(victim);
+            entries[victim] = Entry{std::prev(recentlyUsed.end()), bytes};
+            loadedBytes += bytes;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (loadedBytes > memoryBudgetBytes)
+    {
+        std::cerr << "Memory budget exceeded by datasets in use: "
+            << loadedBytes << " / " << memoryBudgetBytes << " bytes" << std::endl;
+    }
+    return evicted;
+}
+
+void DatasetCache::forget(std::string const &name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(name);
+    if (it == entries.end())
+    {
+        return;
+    }
+    loadedBytes -= it->second.bytes;
+    recentlyUsed.erase(it->second.position);
+    entries.erase(it);
+}
+
+size_t DatasetCache::getLoadedBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return loadedBytes;
+}
+
+std::vector<std::pair<std::string, size_t>> DatasetCache::getDatasetBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<std::string, size_t>> datasetBytes;
+    datasetBytes.reserve(entries.size());
+    for (auto const &[name, entry] : entries)
+    {
+        datasetBytes.emplace_back(name, entry.bytes);
+    }
+    return datasetBytes;
+}
+
+bool DatasetCache::isIdle(std::string const &name)
+{
+    return leases.find(name) == leases.end()
+        && SharedMemorySegments::getReferenceCount(name) == 0;
+}
+
+bool DatasetCache::evict(std::string const &name)
+{
+    static Metrics::Counter &evictions = Metrics::getCounter(
+        "wisent_dataset_evictions_total", 
+        "Datasets released to stay within the memory budget"
+    );
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (leases.find(name) != leases.end())
+        {
+            return false;
+        }
+    }
+    SharedMemorySegments::SegmentHandle segment = SharedMemorySegments::findMemorySegment(name);
+    if (!segment)
+    {
+        return true;
+    }
+    bool fileBacked = segment->isFileBacked();
+    segment.release();      // erasing and unmapping need the segment unreferenced
+    if (fileBacked)
+    {
+        // the file stays, only the mapping goes, unless a handle was taken since isIdle()
+        std::shared_ptr<ISharedMemorySegment> unmapped = SharedMemorySegments::takeMemorySegment(name);
+        if (unmapped && unmapped.use_count() > 1)
+        {
+            SharedMemorySegments::registerMemorySegment(name, std::move(unmapped));
+            return false;
+        }
+        if (unmapped)
+        {
+            unmapped->unload();
+        }
+        evictions.add();
+        return true;
+    }
+    if (!persistDirectory.empty() &&
+        !std::filesystem::exists(wisent::serializer::getPersistedFilePath(name, persistDirectory)))
+    {
+        Result<std::string> persisted = wisent::serializer::persist(name, persistDirectory);
+        if (!persisted.success())
+        {
+            std::cerr << "Evicting without persisting " << name << ": " << persisted.getError() << std::endl;
+        }
+    }
+    // refused while a handle is held
+    if (!SharedMemorySegments::eraseMemorySegment(name))
+    {
+        return false;
+    }
+    SharedMemorySegments::freePublishedMemorySegments(name);
+    evictions.add();
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Keeps the datasets mapped by the server within a memory budget.
+ * Every successful load is admitted, which moves the dataset to the front of
+ * the LRU list and evicts idle datasets from the back until the loaded bytes
+ * fit the budget again. A dataset is idle when no request holds a lease on it
+ * and no SegmentHandle refers to its segment.
+ *
+ * Eviction releases the memory for good: shared memory segments are persisted
+ * first (if a persist directory is configured) and then erased, file backed
+ * segments are simply unmapped. The next request for the dataset reloads it,
+ * from the persisted file when there is one. Victims are picked under the
+ * cache's lock but persisted and released after it, and a victim a request
+ * took a handle to in between is kept.
+ */
+class DatasetCache
+{
+  public:
+    // while alive, the leased dataset is not evicted
+    class Lease
+    {
+      private:
+        DatasetCache *cache;
+        std::string name;
+
+      public:
+        Lease(DatasetCache *cache, std::string const &name);
+        Lease(Lease &&other) noexcept;
+        ~Lease();
+
+        Lease(Lease const &other) = delete;
+        Lease &operator=(Lease const &other) = delete;
+        Lease &operator=(Lease &&other) = delete;
+    };
+
+    DatasetCache(
+        size_t memoryBudgetBytes,   // 0: unlimited
+        std::string const &persistDirectory
+    );
+
+    Lease lease(std::string const &name);
+
+    // returns the names of the evicted datasets
+    std::vector<std::string> admit(std::string const &name);
+
+    void forget(std::string const &name);
+
+    size_t getLoadedBytes();
+    // size of every admitted dataset, by name
+    std::vector<std::pair<std::string, size_t>> getDatasetBytes();
+    size_t getMemoryBudgetBytes() const { return memoryBudgetBytes; }
+
+  private:
+    struct Entry
+    {
+        std::list<std::string>::iterator position;
+        size_t bytes;
+    };
+
+    std::mutex mutex;
+    size_t const memoryBudgetBytes;
+    std::string const persistDirectory;
+    size_t loadedBytes;
+    std::list<std::string> recentlyUsed;     // front: most recently used
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<std::string, size_t> leases;
+
+    bool isIdle(std::string const &name);
+    // false if the dataset was taken by a request after it was picked
+    bool evict(std::string const &name);
+    void release(std::string const &name);
+};
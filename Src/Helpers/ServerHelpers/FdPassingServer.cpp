@@ -0,0 +1,175 @@
+#include "FdPassingServer.hpp"
+#include "../ISharedMemorySegment.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool makeSocketAddress(
+    std::string const &socketPath,
+    sockaddr_un &address
+) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path too long: " << socketPath << std::endl;
+        return false;
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+    return true;
+}
+
+FdPassingServer::~FdPassingServer()
+{
+    stop();
+}
+
+bool FdPassingServer::start(std::string const &path)
+{
+    sockaddr_un address;
+    if (running || !makeSocketAddress(path, address))
+    {
+        return false;
+    }
+    socketPath = path;
+    listenDescriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(socketPath.c_str());
+    if (listenDescriptor < 0 ||
+        bind(listenDescriptor, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listenDescriptor, 16) != 0)
+    {
+        std::cerr << "Failed to listen on " << socketPath << ": " << strerror(errno) << std::endl;
+        if (listenDescriptor >= 0)
+        {
+            close(listenDescriptor);
+        }
+        listenDescriptor = -1;
+        return false;
+    }
+    running = true;
+    acceptThread = std::thread(&FdPassingServer::acceptConnections, this);
+    return true;
+}
+
+void FdPassingServer::stop()
+{
+    if (!running.exchange(false))
+    {
+        return;
+    }
+    shutdown(listenDescriptor, SHUT_RDWR);
+    acceptThread.join();
+    close(listenDescriptor);
+    listenDescriptor = -1;
+    unlink(socketPath.c_str());
+}
+
+void FdPassingServer::acceptConnections()
+{
+    while (running)
+    {
+        int connection = accept4(listenDescriptor, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        // requests are tiny, a stuck client must not block the others for long
+        timeval timeout{1, 0};
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        serveConnection(connection);
+        close(connection);
+    }
+}
+
+void FdPassingServer::serveConnection(int connection)
+{
+    std::string name;
+    char character;
+    while (name.size() < 4096 && read(connection, &character, 1) == 1 && character != '\n')
+    {
+        name.push_back(character);
+    }
+
+    // held until sent: the descriptor cannot be closed by an eviction meanwhile
+    SharedMemorySegments::SegmentHandle handle = SharedMemorySegments::findMemorySegment(name);
+    int fileDescriptor = SharedMemorySegments::getMemfdFileDescriptor(handle);
+    uint64_t size = (fileDescriptor >= 0 && handle->isLoaded()) ? handle->getSize() : 0;
+
+    iovec payload{&size, sizeof(size)};
+    msghdr message{};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    if (size > 0)
+    {
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(header), &fileDescriptor, sizeof(int));
+    }
+    if (sendmsg(connection, &message, MSG_NOSIGNAL) < 0)
+    {
+        std::cerr << "Failed to send descriptor of " << name << ": " << strerror(errno) << std::endl;
+    }
+}
+
+int receiveMemfd(
+    std::string const &socketPath,
+    std::string const &name,
+    size_t &size
+) {
+    size = 0;
+    sockaddr_un address;
+    if (!makeSocketAddress(socketPath, address))
+    {
+        return -1;
+    }
+    int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0)
+    {
+        return -1;
+    }
+    std::string request = name + "\n";
+    if (connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        write(connection, request.data(), request.size()) != static_cast<ssize_t>(request.size()))
+    {
+        close(connection);
+        return -1;
+    }
+
+    uint64_t receivedSize = 0;
+    iovec payload{&receivedSize, sizeof(receivedSize)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    msghdr message{};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    int fileDescriptor = -1;
+    if (recvmsg(connection, &message, MSG_CMSG_CLOEXEC) == sizeof(receivedSize))
+    {
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        if (header != nullptr && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+        {
+            memcpy(&fileDescriptor, CMSG_DATA(header), sizeof(int));
+            size = receivedSize;
+        }
+    }
+    close(connection);
+    return fileDescriptor;
+}
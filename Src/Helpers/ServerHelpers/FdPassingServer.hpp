@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+/*
+ * Hands the descriptors of sealed memfd segments to local consumers over a
+ * Unix domain socket (SCM_RIGHTS). One request per connection:
+ *
+ *   client -> server:  "<dataset name>\n"
+ *   server -> client:  uint64_t payload size (0: not available),
+ *                      with the read-only memfd attached when available
+ *
+ * The received descriptor keeps the dataset alive on its own, even after the
+ * server evicts or rebuilds it.
+ */
+class FdPassingServer
+{
+  public:
+    FdPassingServer() = default;
+    ~FdPassingServer();
+
+    FdPassingServer(FdPassingServer const &other) = delete;
+    FdPassingServer &operator=(FdPassingServer const &other) = delete;
+
+    bool start(std::string const &socketPath);
+    void stop();
+
+  private:
+    std::string socketPath;
+    int listenDescriptor = -1;
+    std::atomic<bool> running{false};
+    std::thread acceptThread;
+
+    void acceptConnections();
+    void serveConnection(int connection);
+};
+
+// client side of the protocol above, returns the descriptor or -1
+int receiveMemfd(
+    std::string const &socketPath,
+    std::string const &name,
+    size_t &size
+);
@@ -0,0 +1,227 @@
+#include "LoadJobs.hpp"
+#include <algorithm>
+#include <exception>
+
+using json = nlohmann::json;
+
+json makeLoadProfileJson(LoadProfile const &profile)
+{
+    json phases = json::object();
+    for (auto const &[phase, timing] : profile.getPhaseTimings())
+    {
+        phases[phase] = {{"seconds", timing.seconds}, {"count", timing.count}};
+    }
+    return {
+        {"phases", phases},
+        {"counters", profile.getCounters()},
+        {"peakRssBytes", profile.getPeakResidentSetBytes()}
+    };
+}
+
+static json makeJobStatus(
+    uint64_t id,
+    std::string const &datasetName,
+    LoadProgress const &progress,
+    std::string const &error,
+    std::vector<std::string> const &warnings
+) {
+    double secondsRemaining = progress.getEstimatedSecondsRemaining();
+    LoadPhase phase = progress.getPhase();
+    json status = {
+        {"id", id},
+        {"name", datasetName},
+        {"phase", getLoadPhaseName(phase)},
+        {"bytesProcessed", progress.getProcessedBytes()},
+        {"bytesTotal", progress.getTotalBytes()},
+        {"rowsProcessed", progress.getProcessedRows()},
+        {"elapsedSeconds", progress.getElapsedSeconds()},
+        {"etaSeconds", nullptr},
+        {"warnings", warnings},
+        {"profile", makeLoadProfileJson(progress.getProfile())}
+    };
+    if (secondsRemaining >= 0 && phase != LoadPhase::Done)
+    {
+        status["etaSeconds"] = secondsRemaining;
+    }
+    if (!error.empty())
+    {
+        status["error"] = error;
+    }
+    return status;
+}
+
+LoadJobs::LoadJobs(
+    size_t retainedFinishedJobs,
+    size_t maxRunningJobs
+) : retainedFinishedJobs(retainedFinishedJobs), maxRunningJobs(maxRunningJobs), nextId(1)
+{}
+
+LoadJobs::~LoadJobs()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &[id, job] : jobs)
+    {
+        job->progress.requestCancel();
+    }
+    for (auto &[id, job] : jobs)
+    {
+        if (job->thread.joinable())
+        {
+            job->thread.join();
+        }
+    }
+}
+
+uint64_t LoadJobs::start(
+    std::string const &datasetName,
+    LoadFunction loadFunction
+) {
+    std::shared_ptr<Job> job = startJob(datasetName, std::move(loadFunction));
+    return job != nullptr ? job->id : 0;
+}
+
+std::shared_future<std::string> LoadJobs::startAndWatch(
+    std::string const &datasetName,
+    LoadFunction loadFunction
+) {
+    // the returned job is held, so this works even if it was dropped already
+    std::shared_ptr<Job> job = startJob(datasetName, std::move(loadFunction));
+    if (job == nullptr)
+    {
+        return {};
+    }
+    return job->finalStatus.get_future().share();
+}
+
+std::shared_ptr<LoadJobs::Job> LoadJobs::startJob(
+    std::string const &datasetName,
+    LoadFunction loadFunction
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+    dropFinishedJobs();
+    if (maxRunningJobs != 0)
+    {
+        size_t runningCount = std::count_if(jobs.begin(), jobs.end(), [](auto const &entry) {
+            return !entry.second->finished;
+        });
+        if (runningCount >= maxRunningJobs)
+        {
+            return nullptr;
+        }
+    }
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->id = nextId++;
+    job->datasetName = datasetName;
+    jobs.emplace(job->id, job);
+    job->thread = std::thread(&LoadJobs::run, job, std::move(loadFunction));
+    return job;
+}
+
+void LoadJobs::run(
+    std::shared_ptr<Job> job,
+    LoadFunction loadFunction
+) {
+    job->progress.start();
+    Result<WisentRootExpression*> result;
+    try
+    {
+        result = loadFunction(job->progress);
+    }
+    catch (std::exception const &exception)
+    {
+        result.setError(exception.what());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->warnings = result.getWarnings();
+        if (!result.success())
+        {
+            job->error = result.getError();
+        }
+    }
+    if (result.success())
+    {
+        job->progress.setPhase(LoadPhase::Done);
+    }
+    else
+    {
+        job->progress.setPhase(job->progress.isCancelRequested() ? LoadPhase::Cancelled : LoadPhase::Failed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finalStatus.set_value(
+            makeJobStatus(job->id, job->datasetName, job->progress, job->error, job->warnings).dump()
+        );
+    }
+    job->finished = true;
+}
+
+bool LoadJobs::cancel(uint64_t id)
+{
+    std::shared_ptr<Job> job = find(id);
+    if (job == nullptr)
+    {
+        return false;
+    }
+    job->progress.requestCancel();
+    return true;
+}
+
+std::string LoadJobs::getStatus(uint64_t id)
+{
+    std::shared_ptr<Job> job = find(id);
+    if (job == nullptr)
+    {
+        return "";
+    }
+    std::lock_guard<std::mutex> lock(job->mutex);
+    return makeJobStatus(job->id, job->datasetName, job->progress, job->error, job->warnings).dump();
+}
+
+std::string LoadJobs::getStatuses()
+{
+    std::vector<std::shared_ptr<Job>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto const &[id, job] : jobs)
+        {
+            snapshot.push_back(job);
+        }
+    }
+    json statuses = json::array();
+    for (std::shared_ptr<Job> const &job : snapshot)
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        statuses.push_back(makeJobStatus(job->id, job->datasetName, job->progress, job->error, job->warnings));
+    }
+    return statuses.dump();
+}
+
+// caller holds mutex
+void LoadJobs::dropFinishedJobs()
+{
+    size_t finishedCount = 0;
+    for (auto const &[id, job] : jobs)
+    {
+        finishedCount += job->finished ? 1 : 0;
+    }
+    for (auto it = jobs.begin(); it != jobs.end() && finishedCount > retainedFinishedJobs;)
+    {
+        if (!it->second->finished)
+        {
+            ++it;
+            continue;
+        }
+        it->second->thread.join();
+        it = jobs.erase(it);
+        finishedCount--;
+    }
+}
+
+std::shared_ptr<LoadJobs::Job> LoadJobs::find(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = jobs.find(id);
+    return it != jobs.end() ? it->second : nullptr;
+}
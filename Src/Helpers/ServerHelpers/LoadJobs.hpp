@@ -0,0 +1,97 @@
+#pragma once
+#include "../LoadProgress.hpp"
+#include "../Result.hpp"
+#include "../WisentHelpers/WisentHelpers.hpp"
+#include "../../../Include/json.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// {"phases": {<phase>: {"seconds", "count"}}, "counters": {...}, "peakRssBytes"},
+// shared by the job statuses and the responses of the blocking loads
+nlohmann::json makeLoadProfileJson(LoadProfile const &profile);
+
+/*
+ * Asynchronous dataset loads: start() runs the load on a thread of its own and
+ * returns a job id right away, the status (phase, bytes and rows processed,
+ * ETA, final error) is read with getStatus() while the load runs and after it
+ * finished. Finished jobs are kept until more than retainedFinishedJobs of
+ * them accumulate, oldest dropped first. With maxRunningJobs set, a job
+ * beyond that many unfinished ones is refused rather than given a thread.
+ */
+class LoadJobs
+{
+  public:
+    using LoadFunction = std::function<Result<WisentRootExpression*>(LoadProgress &progress)>;
+
+    // maxRunningJobs 0: no limit
+    explicit LoadJobs(
+        size_t retainedFinishedJobs = 256,
+        size_t maxRunningJobs = 0
+    );
+    ~LoadJobs();    // cancels the running jobs and waits for them
+
+    LoadJobs(LoadJobs const &other) = delete;
+    LoadJobs &operator=(LoadJobs const &other) = delete;
+
+    // 0 if refused, job ids start at 1
+    uint64_t start(
+        std::string const &datasetName,
+        LoadFunction loadFunction
+    );
+
+    // as start(), the future is set to the final status of the job (see getStatus()),
+    // it is not valid() if the job was refused
+    std::shared_future<std::string> startAndWatch(
+        std::string const &datasetName,
+        LoadFunction loadFunction
+    );
+
+    // false for unknown ids, finished jobs ignore it
+    bool cancel(uint64_t id);
+
+    // JSON document, empty for unknown ids
+    std::string getStatus(uint64_t id);
+    // JSON array with the status of every known job
+    std::string getStatuses();
+
+  private:
+    struct Job
+    {
+        uint64_t id;
+        std::string datasetName;
+        LoadProgress progress;
+        std::thread thread;
+        std::atomic<bool> finished{false};
+        std::mutex mutex;                   // guards error & warnings
+        std::string error;
+        std::vector<std::string> warnings;
+        std::promise<std::string> finalStatus;
+    };
+
+    std::mutex mutex;
+    size_t const retainedFinishedJobs;
+    size_t const maxRunningJobs;
+    uint64_t nextId;
+    std::map<uint64_t, std::shared_ptr<Job>> jobs;     // ordered by id: oldest first
+
+    static void run(
+        std::shared_ptr<Job> job,
+        LoadFunction loadFunction
+    );
+    // nullptr if refused
+    std::shared_ptr<Job> startJob(
+        std::string const &datasetName,
+        LoadFunction loadFunction
+    );
+    void dropFinishedJobs();
+    std::shared_ptr<Job> find(uint64_t id);
+};
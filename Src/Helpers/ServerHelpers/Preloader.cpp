@@ -0,0 +1,221 @@
+#include "Preloader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <sstream>
+
+using json = nlohmann::json;
+
+Result<PreloadManifest> PreloadManifest::parse(std::string const &body)
+{
+    Result<PreloadManifest> result;
+    json manifestJson = json::parse(body, nullptr, false);
+    if (manifestJson.is_discarded() || !manifestJson.is_object() ||
+        !manifestJson.contains("datasets") || !manifestJson["datasets"].is_array())
+    {
+        result.setError("manifest needs a \"datasets\" array");
+        return result;
+    }
+
+    PreloadManifest manifest;
+    manifest.parallelism = std::max<size_t>(manifestJson.value("parallelism", size_t{1}), 1);
+    for (json const &dataset : manifestJson["datasets"])
+    {
+        PreloadEntry entry;
+        entry.name = dataset.value("name", std::string());
+        entry.path = dataset.value("path", std::string());
+        entry.loader = dataset.value("loader", entry.loader);
+        entry.pipeline = dataset.value("pipeline", json::object());
+        entry.priority = dataset.value("priority", 0);
+        entry.disableRLE = dataset.value("disableRLE", false);
+        entry.disableCsvHandling = dataset.value("disableCsvHandling", false);
+        if (entry.name.empty() || entry.path.empty())
+        {
+            result.setError("manifest datasets need a \"name\" and a \"path\"");
+            return result;
+        }
+        if (entry.loader != "serialize" && entry.loader != "compress")
+        {
+            result.setError("unknown loader for " + entry.name + ": " + entry.loader);
+            return result;
+        }
+        bool duplicate = std::any_of(manifest.datasets.begin(), manifest.datasets.end(),
+            [&entry](PreloadEntry const &other) { return other.name == entry.name; });
+        if (duplicate)
+        {
+            result.setError("dataset listed twice: " + entry.name);
+            return result;
+        }
+        manifest.datasets.push_back(std::move(entry));
+    }
+    std::stable_sort(manifest.datasets.begin(), manifest.datasets.end(),
+        [](PreloadEntry const &a, PreloadEntry const &b) { return a.priority > b.priority; });
+    result.setValue(manifest);
+    return result;
+}
+
+Result<PreloadManifest> PreloadManifest::read(std::string const &filePath)
+{
+    std::ifstream file(filePath);
+    if (!file)
+    {
+        Result<PreloadManifest> result;
+        result.setError("cannot open manifest: " + filePath);
+        return result;
+    }
+    std::stringstream body;
+    body << file.rdbuf();
+    return parse(body.str());
+}
+
+Preloader::~Preloader()
+{
+    stopping = true;
+    for (std::unique_ptr<Dataset> const &dataset : datasets)
+    {
+        dataset->progress.requestCancel();
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void Preloader::start(
+    PreloadManifest manifest,
+    LoadFunction loadFunction
+) {
+    for (PreloadEntry &entry : manifest.datasets)
+    {
+        datasets.push_back(std::make_unique<Dataset>());
+        datasets.back()->entry = std::move(entry);
+    }
+    this->loadFunction = std::move(loadFunction);
+    size_t threadCount = std::min(manifest.parallelism, datasets.size());
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back(&Preloader::run, this);
+    }
+}
+
+// the datasets are claimed in manifest order, i.e. by priority
+void Preloader::run()
+{
+    for (size_t index = nextDataset++; index < datasets.size() && !stopping; index = nextDataset++)
+    {
+        Dataset &dataset = *datasets[index];
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            dataset.state = State::Loading;
+        }
+        dataset.progress.start();
+        Result<WisentRootExpression*> result;
+        try
+        {
+            result = loadFunction(dataset.entry, dataset.progress);
+        }
+        catch (std::exception const &exception)
+        {
+            result.setError(exception.what());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        dataset.seconds = dataset.progress.getElapsedSeconds();
+        dataset.state = result.success() ? State::Warm : State::Failed;
+        if (!result.success())
+        {
+            dataset.error = result.getError();
+        }
+        finishedCount++;
+    }
+}
+
+bool Preloader::isFinished() const
+{
+    return finishedCount == datasets.size();
+}
+
+bool Preloader::isWarm(std::string const &name) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::any_of(datasets.begin(), datasets.end(), [&name](std::unique_ptr<Dataset> const &dataset) {
+        return dataset->entry.name == name && dataset->state == State::Warm;
+    });
+}
+
+json Preloader::getStatus() const
+{
+    static char const *const StateNames[] = {"pending", "loading", "warm", "failed"};
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t failedCount = 0;
+    json datasetsJson = json::object();
+    for (std::unique_ptr<Dataset> const &dataset : datasets)
+    {
+        json status = {
+            {"state", StateNames[static_cast<int>(dataset->state)]},
+            {"priority", dataset->entry.priority},
+            {"seconds", dataset->seconds}
+        };
+        if (!dataset->error.empty())
+        {
+            status["error"] = dataset->error;
+        }
+        failedCount += dataset->state == State::Failed ? 1 : 0;
+        datasetsJson[dataset->entry.name] = status;
+    }
+    return {
+        {"ready", finishedCount == datasets.size()},
+        {"failed", failedCount},
+        {"datasets", datasetsJson}
+    };
+}
+
+BatchTurns::BatchTurns(
+    size_t parallelism,
+    size_t datasetCount
+) : parallelism(std::max<size_t>(parallelism, 1))
+{
+    for (size_t index = 0; index < datasetCount; index++)
+    {
+        waiting.insert(index);
+    }
+}
+
+bool BatchTurns::waitForTurn(
+    size_t index,
+    LoadProgress const &progress
+) {
+    std::unique_lock<std::mutex> lock(mutex);
+    // cancellation sets a flag only, hence the polling
+    while (!cancelled && !progress.isCancelRequested() && (running >= parallelism || *waiting.begin() != index))
+    {
+        turnFreed.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    waiting.erase(index);
+    turnFreed.notify_all();
+    if (cancelled || progress.isCancelRequested())
+    {
+        return false;
+    }
+    running++;
+    return true;
+}
+
+void BatchTurns::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running--;
+    }
+    turnFreed.notify_all();
+}
+
+void BatchTurns::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    turnFreed.notify_all();
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "../LoadProgress.hpp"
+#include "../Result.hpp"
+#include "../WisentHelpers/WisentHelpers.hpp"
+#include "../../../Include/json.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * One dataset of the startup manifest (--manifest <file>):
+ *
+ *   {
+ *     "parallelism": 2,
+ *     "datasets": [
+ *       {"name": "owid", "path": "/data/owid.json", "loader": "compress",
+ *        "pipeline": {...body of /compress...}, "priority": 10},
+ *       {"name": "bench", "path": "/data/bench.json"}
+ *     ]
+ *   }
+ *
+ * "loader" is "serialize" (default) or "compress"; higher priorities load first.
+ */
+struct PreloadEntry
+{
+    std::string name;
+    std::string path;
+    std::string loader = "serialize";
+    nlohmann::json pipeline;        // "compress" only
+    int priority = 0;
+    bool disableRLE = false;
+    bool disableCsvHandling = false;
+};
+
+struct PreloadManifest
+{
+    size_t parallelism = 1;
+    std::vector<PreloadEntry> datasets;     // by descending priority, stable
+
+    static Result<PreloadManifest> parse(std::string const &body);
+    static Result<PreloadManifest> read(std::string const &filePath);
+};
+
+/*
+ * Loads the manifest in the background, at most parallelism datasets at a
+ * time (the builds themselves still queue on the server's WorkerPool). With a
+ * persist directory a dataset is just remapped from its Wisent file, so a
+ * restarted server is warm again in the time it takes to map its files.
+ * getStatus() backs GET /ready.
+ */
+class Preloader
+{
+  public:
+    using LoadFunction = std::function<Result<WisentRootExpression*>(
+        PreloadEntry const &entry,
+        LoadProgress &progress
+    )>;
+
+    Preloader() = default;
+    ~Preloader();   // cancels the loads not yet finished and waits for them
+
+    Preloader(Preloader const &other) = delete;
+    Preloader &operator=(Preloader const &other) = delete;
+
+    void start(
+        PreloadManifest manifest,
+        LoadFunction loadFunction
+    );
+
+    // every dataset of the manifest finished loading, successfully or not
+    bool isFinished() const;
+    // false for datasets outside the manifest
+    bool isWarm(std::string const &name) const;
+
+    /*
+     * {"ready": <every dataset finished>, "failed": <count>, "datasets":
+     *  {<name>: {"state": pending|loading|warm|failed, "priority", "seconds", "error"}}}
+     */
+    nlohmann::json getStatus() const;
+
+  private:
+    enum class State { Pending, Loading, Warm, Failed };
+
+    struct Dataset
+    {
+        PreloadEntry entry;
+        LoadProgress progress;
+        State state = State::Pending;
+        double seconds = 0;
+        std::string error;
+    };
+
+    mutable std::mutex mutex;       // guards the state, seconds & error of the datasets
+    std::vector<std::unique_ptr<Dataset>> datasets;
+    std::atomic<size_t> nextDataset{0};
+    std::atomic<size_t> finishedCount{0};
+    std::atomic<bool> stopping{false};
+    LoadFunction loadFunction;
+    std::vector<std::thread> threads;
+
+    void run();
+};
+
+/*
+ * Turns for the datasets of one POST /batch call, each of which is a LoadJobs
+ * job on a thread of its own: at most parallelism of them load at a time and
+ * the waiting ones start in manifest order, i.e. by priority. Without it the
+ * jobs would all race into the WorkerPool's FIFO queue at once.
+ */
+class BatchTurns
+{
+  public:
+    BatchTurns(
+        size_t parallelism,
+        size_t datasetCount
+    );
+
+    // false if the load was cancelled while waiting, otherwise finish() must follow
+    bool waitForTurn(
+        size_t index,
+        LoadProgress const &progress
+    );
+    void finish();
+    // the loads still waiting give up their turns
+    void cancel();
+
+  private:
+    std::mutex mutex;
+    std::condition_variable turnFreed;
+    size_t const parallelism;
+    size_t running = 0;
+    bool cancelled = false;
+    std::set<size_t> waiting;       // indices into the manifest
+};
@@ -0,0 +1,202 @@
+#include "SegmentStream.hpp"
+#include "../../WisentCompressor/CompressedColumn.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+static char const *const SectionNames[] = {"header", "root", "arguments", "types", "expressions", "strings"};
+
+Result<std::shared_ptr<SegmentStream>> SegmentStream::open(std::string const &name)
+{
+    Result<std::shared_ptr<SegmentStream>> result;
+
+    // looked up only: an unknown name must not leave a segment or a registration behind
+    SharedMemorySegments::SegmentHandle handle = SharedMemorySegments::findMemorySegment(name);
+    if (!handle)
+    {
+        result.setError("Shared memory segment not found: " + name);
+        return result;
+    }
+    if (handle->exists() && !handle->isLoaded())
+    {
+        handle->load();
+    }
+    if (!handle->isLoaded())
+    {
+        result.setError("Shared memory segment is not loaded: " + name);
+        return result;
+    }
+    WisentRootExpression const *root = reinterpret_cast<WisentRootExpression const *>(handle->getBaseAddress());
+    uint64_t payloadBytes = handle->getSize();
+    result.setValue(std::shared_ptr<SegmentStream>(new SegmentStream(std::move(handle), root, payloadBytes)));
+    return result;
+}
+
+SegmentStream::SegmentStream(
+    SharedMemorySegments::SegmentHandle handle,
+    WisentRootExpression const *root,
+    uint64_t payloadBytes
+) : handle(std::move(handle)), root(root), payloadBytes(payloadBytes)
+{
+    // same bytes as persist(): originalAddress is meaningless on another host
+    WisentFileHeader header = makeWisentFileHeader(payloadBytes);
+    memcpy(prefix, &header, sizeof(header));
+    memcpy(prefix + sizeof(header), root, sizeof(WisentRootExpression));
+    memset(prefix + sizeof(header) + offsetof(WisentRootExpression, originalAddress), 0, sizeof(void *));
+}
+
+std::vector<SegmentStream::ByteRange> SegmentStream::getSections() const
+{
+    uint64_t argumentsOffset = sizeof(WisentFileHeader) + sizeof(WisentRootExpression);
+    uint64_t argumentBytes = root->argumentCount * sizeof(WisentArgumentValue);
+    uint64_t typeBytes = root->argumentCount * sizeof(WisentArgumentType);
+    uint64_t expressionBytes = root->expressionCount * sizeof(WisentExpression);
+    uint64_t stringsOffset = argumentsOffset + argumentBytes + typeBytes + expressionBytes;
+    return {
+        {0, sizeof(WisentFileHeader)},
+        {sizeof(WisentFileHeader), sizeof(WisentRootExpression)},
+        {argumentsOffset, argumentBytes},
+        {argumentsOffset + argumentBytes, typeBytes},
+        {argumentsOffset + argumentBytes + typeBytes, expressionBytes},
+        {stringsOffset, getFileBytes() - std::min(stringsOffset, getFileBytes())}
+    };
+}
+
+Result<SegmentStream::ByteRange> SegmentStream::getSection(std::string const &section) const
+{
+    Result<ByteRange> result;
+    std::vector<ByteRange> sections = getSections();
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+        if (section == SectionNames[i])
+        {
+            result.setValue(sections[i]);
+            return result;
+        }
+    }
+    result.setError("unknown section: " + section);
+    return result;
+}
+
+SegmentStream::ByteRange SegmentStream::getArgumentRange(
+    uint64_t firstArgument,
+    uint64_t lastArgument,
+    size_t valueBytes,
+    uint64_t bufferOffset
+) const {
+    return {bufferOffset + firstArgument * valueBytes, (lastArgument - firstArgument) * valueBytes};
+}
+
+nlohmann::json SegmentStream::getCompressedColumnLayout(
+    uint64_t expressionIndex,
+    uint64_t stringsOffset
+) const {
+    Result<wisent::compressor::CompressedColumn> column = wisent::compressor::readCompressedColumn(root, expressionIndex);
+    if (!column.success())
+    {
+        return {{"error", column.getError()}};
+    }
+    nlohmann::json compressionTypes = nlohmann::json::array();
+    for (CompressionType type : column.value->compressionTypes)
+    {
+        compressionTypes.push_back(static_cast<int64_t>(type));
+    }
+    nlohmann::json pages = nlohmann::json::array();
+    for (wisent::compressor::CompressedPage const &page : column.value->pages)
+    {
+        pages.push_back({
+            {"values", page.numberOfValues},
+            {"offset", stringsOffset + page.dataOffset},
+            {"bytes", page.dataBytes}
+        });
+    }
+    return {
+        {"physicalType", static_cast<int64_t>(column.value->physicalType)},
+        {"encodingType", static_cast<int64_t>(column.value->encodingType)},
+        {"compressionTypes", compressionTypes},
+        {"values", column.value->numberOfValues},
+        {"pages", pages}
+    };
+}
+
+nlohmann::json SegmentStream::getLayout() const
+{
+    std::vector<ByteRange> sections = getSections();
+    nlohmann::json sectionsJson = nlohmann::json::object();
+    for (size_t i = 0; i < sections.size(); i++)
+    {
+        sectionsJson[SectionNames[i]] = {{"offset", sections[i].offset}, {"bytes", sections[i].bytes}};
+    }
+
+    // the columns of a table are consecutive expressions, so the values of
+    // all its columns are one run in the arguments (and in the types)
+    WisentRootExpression *mutableRoot = const_cast<WisentRootExpression *>(root);
+    WisentArgumentValue const *arguments = getArgumentsBuffer(mutableRoot);
+    WisentExpression const *expressions = getSubexpressionsBuffer(mutableRoot);
+    char const *strings = getStringBuffer(mutableRoot);
+    nlohmann::json tables = nlohmann::json::array();
+    for (uint64_t i = 0; i < root->expressionCount; i++)
+    {
+        WisentExpression const &table = expressions[i];
+        if (strcmp(strings + table.symbolNameOffset, "Table") != 0 || table.firstChildOffset == table.lastChildOffset)
+        {
+            continue;
+        }
+        nlohmann::json columns = nlohmann::json::array();
+        nlohmann::json compressedColumns = nlohmann::json::object();
+        uint64_t firstValue = UINT64_MAX;
+        uint64_t lastValue = 0;
+        for (uint64_t argument = table.firstChildOffset; argument < table.lastChildOffset; argument++)
+        {
+            WisentExpression const &column = expressions[arguments[argument].asExpression];
+            columns.push_back(strings + column.symbolNameOffset);
+            firstValue = std::min(firstValue, column.firstChildOffset);
+            lastValue = std::max(lastValue, column.lastChildOffset);
+            if (wisent::compressor::isCompressedColumn(root, arguments[argument].asExpression))
+            {
+                compressedColumns[strings + column.symbolNameOffset] = getCompressedColumnLayout(
+                    arguments[argument].asExpression, 
+                    sections[5].offset
+                );
+            }
+        }
+        ByteRange argumentRange = getArgumentRange(firstValue, lastValue, sizeof(WisentArgumentValue), sections[2].offset);
+        ByteRange typeRange = getArgumentRange(firstValue, lastValue, sizeof(WisentArgumentType), sections[3].offset);
+        tables.push_back({
+            {"expression", i},
+            {"columns", columns},
+            {"arguments", {{"offset", argumentRange.offset}, {"bytes", argumentRange.bytes}}},
+            {"types", {{"offset", typeRange.offset}, {"bytes", typeRange.bytes}}},
+            {"compressedColumns", compressedColumns}
+        });
+    }
+    return {
+        {"bytes", getFileBytes()},
+        {"sections", sectionsJson},
+        {"tables", tables}
+    };
+}
+
+bool SegmentStream::write(
+    uint64_t offset,
+    uint64_t bytes,
+    WriteFunction const &writeFunction
+) const {
+    uint64_t end = std::min(offset + bytes, getFileBytes());
+    if (offset < sizeof(prefix) && offset < end)
+    {
+        uint64_t prefixEnd = std::min<uint64_t>(end, sizeof(prefix));
+        if (!writeFunction(prefix + offset, prefixEnd - offset))
+        {
+            return false;
+        }
+        offset = prefixEnd;
+    }
+    if (offset >= end)
+    {
+        return true;
+    }
+    // the payload starts at the root, i.e. at file offset sizeof(WisentFileHeader)
+    char const *payload = reinterpret_cast<char const *>(root);
+    return writeFunction(payload + (offset - sizeof(WisentFileHeader)), end - offset);
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "../ISharedMemorySegment.hpp"
+#include "../Result.hpp"
+#include "../WisentHelpers/WisentFile.hpp"
+#include "../WisentHelpers/WisentHelpers.hpp"
+#include "../../../Include/json.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * A loaded segment read as the bytes of its persisted .wisent file (see
+ * WisentFile.hpp): a remote host writes the stream to disk and maps it with
+ * loadPersisted(), no reload from source.
+ * Only the file header and the root (originalAddress cleared) are copied,
+ * every other byte is handed to the writer straight from the mapping. The
+ * handle keeps the segment registered until the stream is dropped.
+ */
+class SegmentStream
+{
+  public:
+    struct ByteRange
+    {
+        uint64_t offset;    // in the streamed file
+        uint64_t bytes;
+    };
+
+    static Result<std::shared_ptr<SegmentStream>> open(std::string const &name);
+
+    uint64_t getFileBytes() const { return sizeof(WisentFileHeader) + payloadBytes; }
+
+    // "header", "root", "arguments", "types", "expressions" or "strings"
+    Result<ByteRange> getSection(std::string const &section) const;
+
+    /*
+     * {"bytes", "sections": {<section>: {"offset", "bytes"}},
+     *  "tables": [{"expression", "columns", "arguments", "types", "compressedColumns"}]},
+     * a table's ranges cover the values of all its columns (for HTTP Range).
+     * Columns the compressor wrote as pages are listed in compressedColumns:
+     * {<column>: {"physicalType", "encodingType", "compressionTypes", "values",
+     * "pages": [{"values", "offset", "bytes"}]}}, the stored enum numbers and
+     * the file range of each page, to decompress and decode as written.
+     */
+    nlohmann::json getLayout() const;
+
+    // returns false when write does
+    using WriteFunction = std::function<bool(char const *data, size_t bytes)>;
+    bool write(
+        uint64_t offset,
+        uint64_t bytes,
+        WriteFunction const &writeFunction
+    ) const;
+
+  private:
+    SharedMemorySegments::SegmentHandle handle;
+    WisentRootExpression const *root;
+    uint64_t payloadBytes;
+    // file header followed by the root as persist() writes it
+    char prefix[sizeof(WisentFileHeader) + sizeof(WisentRootExpression)];
+
+    SegmentStream(
+        SharedMemorySegments::SegmentHandle handle,
+        WisentRootExpression const *root,
+        uint64_t payloadBytes
+    );
+
+    std::vector<ByteRange> getSections() const;
+    nlohmann::json getCompressedColumnLayout(
+        uint64_t expressionIndex,
+        uint64_t stringsOffset
+    ) const;
+    ByteRange getArgumentRange(
+        uint64_t firstArgument,
+        uint64_t lastArgument,
+        size_t valueBytes,
+        uint64_t bufferOffset
+    ) const;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Coalesces concurrent calls for the same key: the first caller runs the
+ * function, callers arriving while it runs wait for that same run and get
+ * its result (or its exception). Once it finished, the next call for the key
+ * runs the function again.
+ *
+ * Used by the server so that a burst of requests for an unloaded dataset
+ * builds it once instead of racing on the same segment.
+ */
+template<typename T>
+class SingleFlight
+{
+  public:
+    template<typename Function>
+    T run(
+        std::string const &key,
+        Function &&function
+    ) {
+        std::promise<T> promise;
+        std::shared_future<T> future;
+        bool isLeader = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = inFlight.find(key);
+            if (it != inFlight.end())
+            {
+                future = it->second;
+            }
+            else
+            {
+                future = promise.get_future().share();
+                inFlight.emplace(key, future);
+                isLeader = true;
+            }
+        }
+        if (!isLeader)
+        {
+            return future.get();
+        }
+
+        try
+        {
+            promise.set_value(function());
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight.erase(key);
+        }
+        return future.get();
+    }
+
+    size_t getInFlightCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return inFlight.size();
+    }
+
+  private:
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_future<T>> inFlight;
+};
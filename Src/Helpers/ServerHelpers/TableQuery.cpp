@@ -0,0 +1,565 @@
+#include "TableQuery.hpp"
+#include "../ISharedMemorySegment.hpp"
+#include "../../WisentCompressor/CompressedColumn.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace
+{
+    struct TreeView
+    {
+        WisentRootExpression const *root;
+        WisentArgumentValue const *arguments;
+        WisentArgumentType const *types;
+        WisentExpression const *expressions;
+        char const *strings;
+        uint64_t argumentCount;
+    };
+
+    struct TableColumn
+    {
+        std::string name;
+        WisentArgumentValue const *values;
+        std::vector<uint8_t> types;     // type RLE expanded
+        uint64_t rowCount;
+        char const *strings;            // string and symbol values are offsets into these
+        // the values of a compressed column, decoded (values and strings point here)
+        std::vector<WisentArgumentValue> decodedValues;
+        std::vector<char> decodedStrings;
+    };
+
+    TreeView makeTreeView(WisentRootExpression const *root)
+    {
+        WisentRootExpression *mutableRoot = const_cast<WisentRootExpression *>(root);
+        return {
+            root,
+            getArgumentsBuffer(mutableRoot),
+            getArgumentTypesBuffer(mutableRoot),
+            getSubexpressionsBuffer(mutableRoot),
+            getStringBuffer(mutableRoot),
+            root->argumentCount
+        };
+    }
+
+    // function(argumentIndex, type) for each argument in [first, last),
+    // a run (RLE bit set, length in the next slot) covers several arguments
+    template <typename Function>
+    void forEachArgumentType(
+        WisentArgumentType const *types,
+        uint64_t first,
+        uint64_t last,
+        Function &&function
+    ) {
+        for (uint64_t argument = first; argument < last;)
+        {
+            size_t type = types[argument];
+            if ((type & WisentArgumentType_RLE_BIT) == 0 || argument + 1 >= last)
+            {
+                function(argument, static_cast<uint8_t>(type & ~WisentArgumentType_RLE_BIT));
+                argument++;
+                continue;
+            }
+            uint64_t runLength = std::max<uint64_t>(static_cast<uint32_t>(types[argument + 1]), 1);
+            uint64_t runEnd = std::min(argument + runLength, last);
+            for (; argument < runEnd; argument++)
+            {
+                function(argument, static_cast<uint8_t>(type & ~WisentArgumentType_RLE_BIT));
+            }
+        }
+    }
+
+    char const *getHead(
+        TreeView const &tree,
+        uint64_t expressionIndex
+    ) {
+        return tree.strings + tree.expressions[expressionIndex].symbolNameOffset;
+    }
+
+    // expression indices of the children that are expressions
+    std::vector<uint64_t> getChildExpressions(
+        TreeView const &tree,
+        uint64_t expressionIndex
+    ) {
+        WisentExpression const &expression = tree.expressions[expressionIndex];
+        std::vector<uint64_t> children;
+        forEachArgumentType(tree.types, expression.firstChildOffset, expression.lastChildOffset,
+            [&](uint64_t argument, uint8_t type) {
+                if (type == ARGUMENT_TYPE_EXPRESSION)
+                {
+                    children.push_back(tree.arguments[argument].asExpression);
+                }
+            });
+        return children;
+    }
+
+    bool findChild(
+        TreeView const &tree,
+        uint64_t expressionIndex,
+        std::string const &step,
+        uint64_t &childIndex
+    ) {
+        std::vector<uint64_t> children = getChildExpressions(tree, expressionIndex);
+        for (uint64_t child : children)
+        {
+            if (step == getHead(tree, child))
+            {
+                childIndex = child;
+                return true;
+            }
+        }
+        bool isIndex = !step.empty() && std::all_of(step.begin(), step.end(), [](char c) { return std::isdigit(c); });
+        if (isIndex && std::stoull(step) < children.size())
+        {
+            childIndex = children[std::stoull(step)];
+            return true;
+        }
+        return false;
+    }
+
+    Result<uint64_t> findTable(
+        TreeView const &tree,
+        std::vector<std::string> const &tablePath
+    ) {
+        Result<uint64_t> result;
+        if (tree.argumentCount == 0)
+        {
+            result.setError("empty dataset");
+            return result;
+        }
+        uint64_t current = tree.arguments[0].asExpression;     // the top-level expression
+        std::string resolvedPath;
+        for (std::string const &step : tablePath)
+        {
+            resolvedPath += "/" + step;
+            if (!findChild(tree, current, step, current))
+            {
+                result.setError("table path not found: " + resolvedPath);
+                return result;
+            }
+        }
+        if (strcmp(getHead(tree, current), "Table") != 0 && !findChild(tree, current, "Table", current))
+        {
+            result.setError("not a table: " + resolvedPath);
+            return result;
+        }
+        result.setValue(current);
+        return result;
+    }
+
+    // written by the compressor as metadata and pages: decoded into the column
+    Result<TableColumn> getCompressedColumn(
+        TreeView const &tree,
+        uint64_t columnIndex,
+        std::string const &columnName
+    ) {
+        Result<TableColumn> result;
+        Result<wisent::compressor::DecodedColumn> decoded = wisent::compressor::decodeCompressedColumn(tree.root, columnIndex);
+        if (!decoded.success())
+        {
+            result.setError("column " + columnName + ": " + decoded.getError());
+            return result;
+        }
+        wisent::compressor::DecodedColumn const &values = *decoded.value;
+        TableColumn column;
+        column.name = columnName;
+        column.rowCount = values.longs.size() + values.doubles.size() + values.strings.size();
+        column.decodedValues.resize(column.rowCount);
+        for (size_t row = 0; row < values.longs.size(); row++)
+        {
+            column.decodedValues[row].asLong = values.longs[row];
+        }
+        for (size_t row = 0; row < values.doubles.size(); row++)
+        {
+            column.decodedValues[row].asDouble = values.doubles[row];
+        }
+        for (size_t row = 0; row < values.strings.size(); row++)
+        {
+            column.decodedValues[row].asString = column.decodedStrings.size();
+            column.decodedStrings.insert(column.decodedStrings.end(), values.strings[row].begin(), values.strings[row].end());
+            column.decodedStrings.push_back('\0');
+        }
+        uint8_t type = values.physicalType == PhysicalType::INT64 ? ARGUMENT_TYPE_LONG
+            : values.physicalType == PhysicalType::DOUBLE ? ARGUMENT_TYPE_DOUBLE
+            : ARGUMENT_TYPE_STRING;
+        column.types.assign(column.rowCount, type);
+        // vector moves keep their buffers, so these stay valid in the moved column
+        column.values = column.decodedValues.data();
+        column.strings = column.decodedStrings.data();
+        result.value = std::move(column);
+        return result;
+    }
+
+    Result<TableColumn> getColumn(
+        TreeView const &tree,
+        uint64_t tableIndex,
+        std::string const &columnName
+    ) {
+        Result<TableColumn> result;
+        uint64_t columnIndex;
+        if (!findChild(tree, tableIndex, columnName, columnIndex) || columnName != getHead(tree, columnIndex))
+        {
+            result.setError("unknown column: " + columnName);
+            return result;
+        }
+        if (wisent::compressor::isCompressedColumn(tree.root, columnIndex))
+        {
+            return getCompressedColumn(tree, columnIndex, columnName);
+        }
+        WisentExpression const &expression = tree.expressions[columnIndex];
+        TableColumn column;
+        column.name = columnName;
+        column.strings = tree.strings;
+        column.values = tree.arguments + expression.firstChildOffset;
+        column.rowCount = expression.lastChildOffset - expression.firstChildOffset;
+        column.types.resize(column.rowCount);
+        forEachArgumentType(tree.types, expression.firstChildOffset, expression.lastChildOffset,
+            [&](uint64_t argument, uint8_t type) {
+                column.types[argument - expression.firstChildOffset] = type;
+            });
+        result.value = std::move(column);
+        return result;
+    }
+
+    // branchless: one pass per predicate, vectorised by the compiler
+    template <typename Value, typename Compare>
+    void filterNumbers(
+        TableColumn const &column,
+        Value value,
+        Compare compare,
+        uint8_t *mask
+    ) {
+        WisentArgumentValue const *values = column.values;
+        uint8_t const *types = column.types.data();
+        for (uint64_t row = 0; row < column.rowCount; row++)
+        {
+            bool isLong = types[row] == ARGUMENT_TYPE_LONG;
+            bool isDouble = types[row] == ARGUMENT_TYPE_DOUBLE;
+            bool longMatches = compare(static_cast<Value>(values[row].asLong), value);
+            bool doubleMatches = compare(values[row].asDouble, static_cast<double>(value));
+            mask[row] &= static_cast<uint8_t>((isLong & longMatches) | (isDouble & doubleMatches));
+        }
+    }
+
+    template <typename Value>
+    void filterNumbers(
+        TableColumn const &column,
+        TableQuery::Comparison comparison,
+        Value value,
+        uint8_t *mask
+    ) {
+        switch (comparison)
+        {
+            case TableQuery::Comparison::Less:
+                return filterNumbers(column, value, [](auto a, auto b) { return a < b; }, mask);
+            case TableQuery::Comparison::LessOrEqual:
+                return filterNumbers(column, value, [](auto a, auto b) { return a <= b; }, mask);
+            case TableQuery::Comparison::Greater:
+                return filterNumbers(column, value, [](auto a, auto b) { return a > b; }, mask);
+            case TableQuery::Comparison::GreaterOrEqual:
+                return filterNumbers(column, value, [](auto a, auto b) { return a >= b; }, mask);
+            case TableQuery::Comparison::Equal:
+                return filterNumbers(column, value, [](auto a, auto b) { return a == b; }, mask);
+            case TableQuery::Comparison::NotEqual:
+                return filterNumbers(column, value, [](auto a, auto b) { return a != b; }, mask);
+        }
+    }
+
+    void filterStrings(
+        TableColumn const &column,
+        bool equal,
+        std::string const &value,
+        uint8_t *mask
+    ) {
+        for (uint64_t row = 0; row < column.rowCount; row++)
+        {
+            uint8_t type = column.types[row];
+            bool isString = type == ARGUMENT_TYPE_STRING || type == ARGUMENT_TYPE_SYMBOL;
+            bool matches = isString && (value == column.strings + column.values[row].asString) == equal;
+            mask[row] &= static_cast<uint8_t>(matches);
+        }
+    }
+
+    void appendBytes(
+        std::string &output,
+        void const *data,
+        size_t bytes
+    ) {
+        output.append(reinterpret_cast<char const *>(data), bytes);
+    }
+
+    void appendRows(
+        TableColumn const &column,
+        std::vector<uint64_t> const &selectedRows,
+        std::string &output
+    ) {
+        uint32_t nameBytes = static_cast<uint32_t>(column.name.size());
+        appendBytes(output, &nameBytes, sizeof(nameBytes));
+        output += column.name;
+
+        std::string strings;
+        std::vector<uint8_t> types(selectedRows.size());
+        std::vector<uint64_t> values(selectedRows.size());
+        for (size_t i = 0; i < selectedRows.size(); i++)
+        {
+            uint64_t row = selectedRows[i];
+            types[i] = column.types[row];
+            values[i] = static_cast<uint64_t>(column.values[row].asLong);
+            if (types[i] == ARGUMENT_TYPE_STRING || types[i] == ARGUMENT_TYPE_SYMBOL)
+            {
+                values[i] = strings.size();
+                strings.append(column.strings + column.values[row].asString);
+                strings.push_back('\0');
+            }
+        }
+        appendBytes(output, types.data(), types.size());
+        appendBytes(output, values.data(), values.size() * sizeof(uint64_t));
+        uint64_t stringBytes = strings.size();
+        appendBytes(output, &stringBytes, sizeof(stringBytes));
+        output += strings;
+    }
+
+    // over the long and double values of the selected rows, null if none
+    json aggregateColumn(
+        TableColumn const &column,
+        std::vector<uint64_t> const &selectedRows,
+        std::string const &aggregate
+    ) {
+        uint64_t count = 0;
+        bool allLongs = true;
+        int64_t longSum = 0;
+        double sum = 0.0;
+        double minimum = std::numeric_limits<double>::infinity();
+        double maximum = -std::numeric_limits<double>::infinity();
+        for (uint64_t row : selectedRows)
+        {
+            uint8_t type = column.types[row];
+            if (type != ARGUMENT_TYPE_LONG && type != ARGUMENT_TYPE_DOUBLE)
+            {
+                continue;
+            }
+            double value = type == ARGUMENT_TYPE_LONG
+                ? static_cast<double>(column.values[row].asLong)
+                : column.values[row].asDouble;
+            allLongs &= type == ARGUMENT_TYPE_LONG;
+            longSum += type == ARGUMENT_TYPE_LONG ? column.values[row].asLong : 0;
+            sum += value;
+            minimum = std::min(minimum, value);
+            maximum = std::max(maximum, value);
+            count++;
+        }
+        if (aggregate == "count")
+        {
+            return count;
+        }
+        if (count == 0)
+        {
+            return nullptr;
+        }
+        if (aggregate == "sum")
+        {
+            return allLongs ? json(longSum) : json(sum);
+        }
+        double extreme = aggregate == "min" ? minimum : maximum;
+        return allLongs ? json(static_cast<int64_t>(extreme)) : json(extreme);
+    }
+}
+
+Result<TableQuery> TableQuery::parse(std::string const &body)
+{
+    Result<TableQuery> result;
+    json request = json::parse(body, nullptr, false);
+    if (request.is_discarded() || !request.is_object())
+    {
+        result.setError("query is not a JSON object");
+        return result;
+    }
+
+    TableQuery query;
+    std::stringstream tablePath(request.value("table", std::string()));
+    for (std::string step; std::getline(tablePath, step, '/');)
+    {
+        if (!step.empty())
+        {
+            query.tablePath.push_back(step);
+        }
+    }
+    if (!request.contains("columns") || !request["columns"].is_array() || request["columns"].empty())
+    {
+        result.setError("query needs a non-empty \"columns\" array");
+        return result;
+    }
+    for (json const &column : request["columns"])
+    {
+        if (!column.is_string())
+        {
+            result.setError("column names must be strings");
+            return result;
+        }
+        query.columns.push_back(column.get<std::string>());
+    }
+
+    static std::vector<std::pair<std::string, Comparison>> const comparisons = {
+        {"<", Comparison::Less}, {"<=", Comparison::LessOrEqual},
+        {">", Comparison::Greater}, {">=", Comparison::GreaterOrEqual},
+        {"==", Comparison::Equal}, {"!=", Comparison::NotEqual}
+    };
+    for (json const &where : request.value("where", json::array()))
+    {
+        Predicate predicate;
+        predicate.column = where.value("column", std::string());
+        predicate.value = where.value("value", json());
+        std::string op = where.value("op", std::string());
+        auto comparison = std::find_if(comparisons.begin(), comparisons.end(),
+            [&op](auto const &entry) { return entry.first == op; });
+        if (predicate.column.empty() || comparison == comparisons.end())
+        {
+            result.setError("predicates need a \"column\" and an \"op\" (<, <=, >, >=, ==, !=)");
+            return result;
+        }
+        predicate.comparison = comparison->second;
+        bool isEquality = predicate.comparison == Comparison::Equal || predicate.comparison == Comparison::NotEqual;
+        if (!predicate.value.is_number() && !(predicate.value.is_string() && isEquality))
+        {
+            result.setError("predicate on '" + predicate.column + "' needs a number (or a string for == and !=)");
+            return result;
+        }
+        query.predicates.push_back(std::move(predicate));
+    }
+
+    query.aggregate = request.value("aggregate", std::string());
+    if (!query.aggregate.empty() && query.aggregate != "sum" && query.aggregate != "min" &&
+        query.aggregate != "max" && query.aggregate != "count")
+    {
+        result.setError("unknown aggregate: " + query.aggregate);
+        return result;
+    }
+    result.setValue(std::move(query));
+    return result;
+}
+
+Result<TableQueryResult> runTableQuery(
+    WisentRootExpression const *root,
+    TableQuery const &query
+) {
+    Result<TableQueryResult> result;
+    TreeView tree = makeTreeView(root);
+    Result<uint64_t> table = findTable(tree, query.tablePath);
+    if (!table.success())
+    {
+        result.setError(table.getError());
+        return result;
+    }
+
+    std::vector<TableColumn> columns;
+    std::vector<std::string> columnNames = query.columns;
+    for (TableQuery::Predicate const &predicate : query.predicates)
+    {
+        columnNames.push_back(predicate.column);
+    }
+    for (std::string const &columnName : columnNames)
+    {
+        auto loaded = std::find_if(columns.begin(), columns.end(),
+            [&columnName](TableColumn const &column) { return column.name == columnName; });
+        if (loaded != columns.end())
+        {
+            continue;
+        }
+        Result<TableColumn> column = getColumn(tree, table.getValue(), columnName);
+        if (!column.success())
+        {
+            result.setError(column.getError());
+            return result;
+        }
+        if (!columns.empty() && column.getValue().rowCount != columns.front().rowCount)
+        {
+            result.setError("columns differ in length: " + columnName);
+            return result;
+        }
+        columns.push_back(std::move(*column.value));
+    }
+    auto findColumn = [&columns](std::string const &name) -> TableColumn const & {
+        return *std::find_if(columns.begin(), columns.end(),
+            [&name](TableColumn const &column) { return column.name == name; });
+    };
+
+    uint64_t rowCount = columns.front().rowCount;
+    std::vector<uint8_t> mask(rowCount, 1);
+    for (TableQuery::Predicate const &predicate : query.predicates)
+    {
+        TableColumn const &column = findColumn(predicate.column);
+        if (predicate.value.is_string())
+        {
+            bool equal = predicate.comparison == TableQuery::Comparison::Equal;
+            filterStrings(column, equal, predicate.value.get<std::string>(), mask.data());
+        }
+        else if (predicate.value.is_number_integer())
+        {
+            filterNumbers(column, predicate.comparison, predicate.value.get<int64_t>(), mask.data());
+        }
+        else
+        {
+            filterNumbers(column, predicate.comparison, predicate.value.get<double>(), mask.data());
+        }
+    }
+    std::vector<uint64_t> selectedRows;
+    for (uint64_t row = 0; row < rowCount; row++)
+    {
+        if (mask[row])
+        {
+            selectedRows.push_back(row);
+        }
+    }
+
+    TableQueryResult queryResult;
+    queryResult.rowCount = selectedRows.size();
+    if (!query.aggregate.empty())
+    {
+        json values = json::object();
+        for (std::string const &columnName : query.columns)
+        {
+            values[columnName] = aggregateColumn(findColumn(columnName), selectedRows, query.aggregate);
+        }
+        queryResult.aggregates = {{"rows", queryResult.rowCount}, {query.aggregate, values}};
+        result.value = std::move(queryResult);
+        return result;
+    }
+
+    uint64_t columnCount = query.columns.size();
+    appendBytes(queryResult.rows, &queryResult.rowCount, sizeof(uint64_t));
+    appendBytes(queryResult.rows, &columnCount, sizeof(uint64_t));
+    for (std::string const &columnName : query.columns)
+    {
+        appendRows(findColumn(columnName), selectedRows, queryResult.rows);
+    }
+    result.value = std::move(queryResult);     // moved: the rows can be large
+    return result;
+}
+
+Result<TableQueryResult> runTableQuery(
+    std::string const &datasetName,
+    TableQuery const &query
+) {
+    Result<TableQueryResult> result;
+    // looked up only: an unknown name must not leave a segment or a registration behind
+    SharedMemorySegments::SegmentHandle handle = SharedMemorySegments::findMemorySegment(datasetName);
+    if (!handle)
+    {
+        result.setError("Shared memory segment not found: " + datasetName);
+        return result;
+    }
+    if (handle->exists() && !handle->isLoaded())
+    {
+        handle->load();
+    }
+    if (!handle->isLoaded())
+    {
+        result.setError("Shared memory segment is not loaded: " + datasetName);
+        return result;
+    }
+    return runTableQuery(reinterpret_cast<WisentRootExpression const *>(handle->getBaseAddress()), query);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "../Result.hpp"
+#include "../WisentHelpers/WisentHelpers.hpp"
+#include "../../../Include/json.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Projection, filter and aggregation over one table of a loaded dataset,
+ * run on the mapped buffers (POST /query?name=<dataset>):
+ *
+ *   {
+ *     "table": "resources/List/Object/path",   // key path to the table
+ *     "columns": ["DEA2_temperature"],
+ *     "where": [{"column": "DEA2_temperature", "op": ">", "value": 20}],
+ *     "aggregate": "sum"                        // optional: sum, min, max, count
+ *   }
+ *
+ * Each path step matches the head of a child expression ("data" for a key,
+ * "List"/"Object" for containers) or, if none does, is the index of a child
+ * expression; a trailing "Table" may be left out. Predicates (<, <=, >, >=,
+ * ==, !=) are ANDed; numbers compare with long and double values, strings
+ * (== and != only) with strings and symbols. Values of other types (e.g. the
+ * 'Missing symbol) never match a numeric predicate.
+ *
+ * Each predicate is one branchless pass over the column into a row mask, so
+ * the scans vectorise; projection then gathers the selected rows only.
+ * Columns the compressor wrote as pages (see CompressedColumn.hpp) are
+ * decompressed and decoded with their stored encoding first.
+ */
+struct TableQuery
+{
+    enum class Comparison { Less, LessOrEqual, Greater, GreaterOrEqual, Equal, NotEqual };
+
+    struct Predicate
+    {
+        std::string column;
+        Comparison comparison;
+        nlohmann::json value;   // number or string
+    };
+
+    std::vector<std::string> tablePath;
+    std::vector<std::string> columns;
+    std::vector<Predicate> predicates;
+    std::string aggregate;      // empty: the selected rows are returned
+
+    static Result<TableQuery> parse(std::string const &body);
+};
+
+/*
+ * Selected rows, native byte order:
+ *   uint64 rowCount, uint64 columnCount, then per column
+ *     uint32 nameBytes, name,
+ *     uint8 types[rowCount]      (WisentArgumentType of each value),
+ *     uint64 values[rowCount]    (long/double bits, or the offset of a string
+ *                                 or symbol into the column's strings),
+ *     uint64 stringBytes, strings (NUL-terminated)
+ * or, with an aggregate, JSON: {"rows": <matched>, "<aggregate>": {<column>: <value>}}.
+ */
+struct TableQueryResult
+{
+    uint64_t rowCount = 0;
+    std::string rows;
+    nlohmann::json aggregates;
+};
+
+Result<TableQueryResult> runTableQuery(
+    WisentRootExpression const *root,
+    TableQuery const &query
+);
+
+// holds the dataset's segment while scanning
+Result<TableQueryResult> runTableQuery(
+    std::string const &datasetName,
+    TableQuery const &query
+);
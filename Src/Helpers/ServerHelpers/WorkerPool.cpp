@@ -0,0 +1,48 @@
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+WorkerPool::WorkerPool(size_t workerCount)
+    : stopping(false)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(&WorkerPool::runTasks, this);
+    }
+}
+
+// queued tasks still run, so no submitted future is left without a value
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::runTasks()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+            {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
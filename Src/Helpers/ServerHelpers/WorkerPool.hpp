@@ -0,0 +1,51 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed number of threads running dataset builds. The HTTP threads only
+ * submit and wait, so however many requests arrive, at most workerCount
+ * datasets are parsed into shared memory at the same time; the others queue
+ * in submission order.
+ */
+class WorkerPool
+{
+  public:
+    explicit WorkerPool(size_t workerCount);   // 0: one per hardware thread
+    ~WorkerPool();
+
+    WorkerPool(WorkerPool const &other) = delete;
+    WorkerPool &operator=(WorkerPool const &other) = delete;
+
+    template<typename Task>
+    auto submit(Task &&task) -> std::future<decltype(task())>
+    {
+        using ResultType = decltype(task());
+        auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Task>(task));
+        std::future<ResultType> future = packagedTask->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([packagedTask]() { (*packagedTask)(); });
+        }
+        taskAvailable.notify_one();
+        return future;
+    }
+
+    size_t getWorkerCount() const { return workers.size(); }
+
+  private:
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::queue<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+    bool stopping;
+
+    void runTasks();
+};
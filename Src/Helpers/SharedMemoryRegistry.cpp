@@ -0,0 +1,185 @@
+#include "ISharedMemorySegment.hpp"
+#include "Metrics.hpp"
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+/*
+ * One registry per process (the header used to give each translation unit
+ * its own static copy). Lookups take a shared lock, only registration and
+ * removal take it exclusively. Each registered segment is held by a
+ * shared_ptr, whose count doubles as the number of outstanding handles.
+ */
+namespace
+{
+    std::shared_mutex registryMutex;
+    SharedMemorySegments::SharedMemorySegmentMap registry;
+
+    std::atomic<SharedMemorySegments::MemorySegmentFactory> segmentFactory{SharedMemorySegments::makeMemorySegment};
+
+    // per thread, so concurrent builds into different segments do not interfere
+    thread_local ISharedMemorySegment *currentSharedMemory = nullptr;
+}
+
+namespace SharedMemorySegments
+{
+    size_t getMemorySegmentCount()
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        return registry.size();
+    }
+
+    void clearMemorySegments()
+    {
+        std::unique_lock<std::shared_mutex> lock(registryMutex);
+        registry.clear();
+    }
+
+    SegmentHandle findMemorySegment(std::string const &name)
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        auto it = registry.find(name);
+        return it != registry.end() ? SegmentHandle(it->second) : SegmentHandle();
+    }
+
+    SegmentHandle createOrGetMemorySegment(std::string const &name)
+    {
+        SegmentHandle existing = findMemorySegment(name);
+        if (existing)
+        {
+            return existing;
+        }
+        std::unique_lock<std::shared_mutex> lock(registryMutex);
+        // checked again: only the thread that inserts runs the factory (open_or_create)
+        auto it = registry.find(name);
+        if (it == registry.end())
+        {
+            it = registry.emplace(name, segmentFactory.load()(name)).first;
+        }
+        return SegmentHandle(it->second);
+    }
+
+    void setMemorySegmentFactory(MemorySegmentFactory factory)
+    {
+        segmentFactory = factory;
+    }
+
+    SegmentHandle registerMemorySegment(
+        std::string const &name,
+        std::shared_ptr<ISharedMemorySegment> segment
+    ) {
+        std::unique_lock<std::shared_mutex> lock(registryMutex);
+        // keeps the first registration if two threads race for the same name
+        auto [it, inserted] = registry.emplace(name, std::move(segment));
+        return SegmentHandle(it->second);
+    }
+
+    std::shared_ptr<ISharedMemorySegment> takeMemorySegment(std::string const &name)
+    {
+        std::unique_lock<std::shared_mutex> lock(registryMutex);
+        auto it = registry.find(name);
+        if (it == registry.end())
+        {
+            return nullptr;
+        }
+        std::shared_ptr<ISharedMemorySegment> segment = std::move(it->second);
+        registry.erase(it);
+        return segment;
+    }
+
+    long getReferenceCount(std::string const &name)
+    {
+        std::shared_lock<std::shared_mutex> lock(registryMutex);
+        auto it = registry.find(name);
+        return it != registry.end() ? it->second.use_count() - 1 : 0;
+    }
+
+    bool eraseMemorySegment(std::string const &name)
+    {
+        std::unique_lock<std::shared_mutex> lock(registryMutex);
+        auto it = registry.find(name);
+        if (it == registry.end())
+        {
+            return true;
+        }
+        if (it->second.use_count() > 1)
+        {
+            return false;
+        }
+        it->second->erase();
+        registry.erase(it);
+        return true;
+    }
+
+    ISharedMemorySegment *getCurrentSharedMemory()
+    {
+        return currentSharedMemory;
+    }
+
+    void setCurrentSharedMemory(ISharedMemorySegment *sharedMemory)
+    {
+        currentSharedMemory = sharedMemory;
+    }
+
+    void *sharedMemoryMalloc(ISharedMemorySegment *sharedMemory, size_t size)
+    {
+        if (sharedMemory == nullptr)
+        {
+            std::cerr << "Cannot malloc memory as sharedMemory is nullptr" << std::endl;
+            return nullptr;
+        }
+        return sharedMemory->malloc(size);
+    }
+
+    void *sharedMemoryRealloc(ISharedMemorySegment *sharedMemory, void *pointer, size_t size)
+    {
+        if (sharedMemory == nullptr)
+        {
+            std::cerr << "Cannot realloc memory as sharedMemory is nullptr" << std::endl;
+            return nullptr;
+        }
+        static Metrics::Counter &resizes = Metrics::getCounter(
+            "wisent_segment_resizes_total", 
+            "Reallocations of segments while building"
+        );
+        static Metrics::Counter &remaps = Metrics::getCounter(
+            "wisent_segment_remaps_total", 
+            "Reallocations that moved the segment to a new address"
+        );
+        void *resized = sharedMemory->realloc(pointer, size);
+        resizes.add();
+        if (pointer != nullptr && resized != nullptr && resized != pointer)
+        {
+            remaps.add();
+        }
+        return resized;
+    }
+
+    void sharedMemoryFree(ISharedMemorySegment *sharedMemory, void *pointer)
+    {
+        if (sharedMemory == nullptr)
+        {
+            std::cerr << "Cannot free memory as sharedMemory is nullptr" << std::endl;
+            return;
+        }
+        sharedMemory->free(pointer);
+    }
+
+    void *sharedMemoryMalloc(size_t size)
+    {
+        return sharedMemoryMalloc(currentSharedMemory, size);
+    }
+
+    void *sharedMemoryRealloc(void *pointer, size_t size)
+    {
+        return sharedMemoryRealloc(currentSharedMemory, pointer, size);
+    }
+
+    void sharedMemoryFree(void *pointer)
+    {
+        sharedMemoryFree(currentSharedMemory, pointer);
+    }
+}
@@ -2,7 +2,7 @@
 #include <cassert>
 #include <iostream>
 #include <string>
-#include <unordered_map>
+#include <memory>
 #include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/shared_memory_object.hpp>
 
@@ -93,65 +93,8 @@ class SharedMemorySegment : public ISharedMemorySegment
 
 namespace SharedMemorySegments
 {
-    std::unordered_map<std::string, std::unique_ptr<ISharedMemorySegment>> &getSharedMemorySegments() 
+    std::shared_ptr<ISharedMemorySegment> makeMemorySegment(std::string const &name) 
     {
-        return sharedMemorySegmentsList;
-    }
-
-    ISharedMemorySegment *getCurrentSharedMemory() 
-    {
-        return currentSharedMemoryPtr;
-    }
-
-    void setCurrentSharedMemory(ISharedMemorySegment* sharedMemory) 
-    {
-        currentSharedMemoryPtr = sharedMemory;
-    }
-
-    void *sharedMemoryMalloc(size_t size) 
-    {
-        if (currentSharedMemoryPtr == nullptr) 
-        {
-            std::cerr << "Cannot malloc memory as currentSharedMemory is nullptr" << std::endl;
-        }
-        return currentSharedMemoryPtr->malloc(size);
-    }
-
-    void *sharedMemoryRealloc(void *pointer, size_t size) 
-    {
-        if (currentSharedMemoryPtr == nullptr) 
-        {
-            std::cerr << "Cannot realloc memory as currentSharedMemory is nullptr" << std::endl;
-        }
-        return currentSharedMemoryPtr->realloc(pointer, size);
-    }
-
-    void sharedMemoryFree(void *pointer) 
-    {
-        if (currentSharedMemoryPtr == nullptr) 
-        {
-            std::cerr << "Cannot free memory as currentSharedMemory is nullptr" << std::endl;
-        }
-        currentSharedMemoryPtr->free(pointer);
-        if (currentSharedMemoryPtr != nullptr) 
-        {
-            std::cerr << "Free failed" << std::endl;
-        }
-    }
-
-    ISharedMemorySegment *createOrGetMemorySegment(std::string const &name) 
-    {
-        auto it = sharedMemorySegmentsList.find(name);
-        if (it != sharedMemorySegmentsList.end()) 
-        {
-            setCurrentSharedMemory(it->second.get());
-            return it->second.get();
-        }
-        auto newSegment = std::make_unique<SharedMemorySegment>(name); 
-        ISharedMemorySegment *rawPointer = newSegment.get();
-        
-        sharedMemorySegmentsList[name] = std::move(newSegment);
-        setCurrentSharedMemory(rawPointer);
-        return rawPointer;
+        return std::make_shared<SharedMemorySegment>(name);
     }
 }
\ No newline at end of file
@@ -3533,7 +3533,8 @@ struct SerializedBossExpression
                         {
                             encodedData = encodeIntColumn(
                                 std::vector<int64_t>(span.begin(), span.end()), 
-                                columnMetaData
+                                columnMetaData, 
+                                pipeline.getEncoding()
                             );
                         } 
                         else if constexpr (std::is_same_v<T, boss::Span<double>>) 
@@ -3552,10 +3553,12 @@ struct SerializedBossExpression
                         }
                     }, typedSpan);
 
+                    ColumnCodecState columnState;
                     for (size_t i = 0; i < encodedData.size(); ++i)
                     {
                         Result<std::vector<uint8_t>> compressedData = pipeline.compress(
-                            encodedData[i]
+                            encodedData[i], 
+                            &columnState
                         );
                         if (!compressedData.success())
                         {
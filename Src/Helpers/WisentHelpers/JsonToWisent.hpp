@@ -3,7 +3,11 @@
 #include "../CsvLoading.hpp"
 #include "../ISharedMemorySegment.hpp"
 #include "../CompressionHelpers/Algorithms.hpp"
+#include "../LoadProgress.hpp"
+#include "../Metrics.hpp"
+#include <chrono>
 #include <cstdint>
+#include <filesystem>
 #include <string>
 #include <cassert>
 #include <vector>
@@ -70,6 +74,52 @@ class JsonToWisent : public json::json_sax_t
     std::vector<uint64_t> argumentIteratorStack{0};
     uint64_t repeatedArgumentTypeCount; 
 
+    // optional, see LoadProgress.hpp
+    LoadProgressReporter *progressReporter = nullptr;
+    // accumulated per call, recorded once by recordProfile()
+    size_t segmentResizeCount = 0;
+    double segmentResizeSeconds = 0.0;
+
+    LoadProfile *getProfile()
+    {
+        return progressReporter != nullptr ? progressReporter->getProfile() : nullptr;
+    }
+
+    // false aborts the SAX parse (the load was cancelled)
+    bool continueParsing()
+    {
+        if (progressReporter == nullptr) 
+        {
+            return true;
+        }
+        progressReporter->onParseEvent();
+        return !progressReporter->isCancelled();
+    }
+
+    // every allocation goes to this builder's own segment (never to a global
+    // current segment), so builds of different datasets can run concurrently
+    auto allocateInSegment()
+    {
+        return [segment = sharedMemory](size_t size) {
+            return SharedMemorySegments::sharedMemoryMalloc(segment, size);
+        };
+    }
+
+    auto reallocateInSegment()
+    {
+        return [this](void *pointer, size_t size) {
+            segmentResizeCount++;
+            if (getProfile() == nullptr) 
+            {
+                return SharedMemorySegments::sharedMemoryRealloc(sharedMemory, pointer, size);
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            void *resized = SharedMemorySegments::sharedMemoryRealloc(sharedMemory, pointer, size);
+            segmentResizeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return resized;
+        };
+    }
+
   public:
     // Constructor for serializer
     JsonToWisent(
@@ -97,7 +147,7 @@ class JsonToWisent : public json::json_sax_t
         root = allocateExpressionTree(
             cumulArgCountPerLayer.back(),  // sum of all argument counts
             expressionCount, 
-            SharedMemorySegments::sharedMemoryMalloc
+            allocateInSegment()
         );
         wasKeyValue.resize(cumulArgCountPerLayer.size(), false);
     }
@@ -130,13 +180,28 @@ class JsonToWisent : public json::json_sax_t
         root = allocateExpressionTree(
             cumulArgCountPerLayer.back(),
             expressionCount, 
-            SharedMemorySegments::sharedMemoryMalloc
+            allocateInSegment()
         );
         wasKeyValue.resize(cumulArgCountPerLayer.size(), false);
     }
 
     WisentRootExpression *getRoot() { return root; }
 
+    void setProgressReporter(LoadProgressReporter *reporter) { progressReporter = reporter; }
+
+    // after the parse: segment resizes (one per stored string) and final sizes
+    void recordProfile()
+    {
+        LoadProfile *profile = getProfile();
+        if (profile == nullptr || root == nullptr) 
+        {
+            return;
+        }
+        profile->addPhaseTime("segment resize", segmentResizeSeconds, segmentResizeCount);
+        profile->addCounter("string heap bytes", root->stringBufferBytesWritten);
+        profile->addCounter("segment bytes", sharedMemory->getSize());
+    }
+
     bool null() override
     {
         addSymbol("Null");
@@ -178,13 +243,13 @@ class JsonToWisent : public json::json_sax_t
             addString(val);
         }
         handleKeyValueEnd();
-        return true;
+        return continueParsing();
     }
 
     bool start_object(std::size_t /*elements*/) override
     {
         startExpression("Object");
-        return true;
+        return continueParsing();
     }
 
     bool end_object() override
@@ -197,7 +262,7 @@ class JsonToWisent : public json::json_sax_t
     bool start_array(std::size_t /*elements*/) override
     {
         startExpression("List");
-        return true;
+        return continueParsing();
     }
 
     bool end_array() override
@@ -211,7 +276,7 @@ class JsonToWisent : public json::json_sax_t
     {
         startExpression(val);
         wasKeyValue[layerIndex] = true;
-        return true;
+        return continueParsing();
     }
 
     void handleKeyValueEnd()
@@ -297,7 +362,7 @@ class JsonToWisent : public json::json_sax_t
         size_t storedStringOffset = storeString(
             &root, 
             input.c_str(), 
-            SharedMemorySegments::sharedMemoryRealloc
+            reallocateInSegment()
         );
 
         uint64_t argIndex = getNextArgumentIndex();
@@ -312,7 +377,7 @@ class JsonToWisent : public json::json_sax_t
         size_t storedStringOffset = storeString(
             &root, 
             symbol.c_str(), 
-            SharedMemorySegments::sharedMemoryRealloc
+            reallocateInSegment()
         );
 
         uint64_t argIndex = getNextArgumentIndex();
@@ -327,7 +392,7 @@ class JsonToWisent : public json::json_sax_t
         auto storedBytesOffset = storeBytes(
             &root, 
             byteArray,
-            SharedMemorySegments::sharedMemoryRealloc
+            reallocateInSegment()
         );
 
         uint64_t argIndex = getNextArgumentIndex();
@@ -363,7 +428,7 @@ class JsonToWisent : public json::json_sax_t
         size_t storedStringOffset = storeString(
             &root, 
             head.c_str(), 
-            SharedMemorySegments::sharedMemoryRealloc
+            reallocateInSegment()
         );
 
         // make subexpression 
@@ -410,13 +475,20 @@ class JsonToWisent : public json::json_sax_t
             return false;
         }
         startExpression("Table");
+        if (progressReporter != nullptr) 
+        {
+            progressReporter->startCsvFile();
+        }
+        PhaseTimer csvParseTimer(getProfile(), "csv parse");
         auto doc = openCsvFile(csvPrefix + filename);
+        csvParseTimer.stop();
         for (auto const &columnName : doc.GetColumnNames()) 
         {
             if (enableColumnCompression) 
             {
                 if (processedColumns.find(columnName) != processedColumns.end())
                 {
+                    PhaseTimer encodingTimer(getProfile(), "encoding");
                     handleCsvColumnWithCompression(
                         doc, 
                         columnName, 
@@ -447,6 +519,18 @@ class JsonToWisent : public json::json_sax_t
             }
         }
         endExpression();
+        if (progressReporter != nullptr) 
+        {
+            progressReporter->finishCsvFile(csvPrefix + filename, doc.GetRowCount());
+        }
+        static Metrics::Counter &ingestedCsvBytes = Metrics::getCounter(
+            "wisent_ingested_bytes_total", 
+            "Bytes of source files built into datasets", 
+            {{"format", "csv"}}
+        );
+        std::error_code fileSizeError;
+        size_t csvBytes = std::filesystem::file_size(csvPrefix + filename, fileSizeError);
+        ingestedCsvBytes.add(fileSizeError ? 0 : csvBytes);
         return true;
     }
 
@@ -456,8 +540,10 @@ class JsonToWisent : public json::json_sax_t
         std::string const &columnName, 
         Func &&addValueFunc)
     {
+        PhaseTimer encodingTimer(getProfile(), "encoding");
         auto column = loadCsvData<T>(doc, columnName);
         if (column.empty()) {
+            encodingTimer.stopAs("type inference");     // not of type T, the next type is tried
             return false;
         }
         // std::cout << "Handling column: " << columnName << std::endl;
@@ -0,0 +1,70 @@
+#ifndef WISENTFILE_HPP
+#define WISENTFILE_HPP
+
+#include <cstdint>
+#include <cstring>
+
+/***************************************************************/
+/*                                                             */
+/*                    Wisent File Layout                       */
+/*                                                             */
+/* ┌───────────────────────────────────────────────────────┐   */
+/* │   WisentFileHeader (64 bytes)                         │   */
+/* │     magic "WISENT\0\0" (char[8])                      │   */
+/* │     version (uint32_t)                                │   */
+/* │     headerBytes (uint32_t)                            │   */
+/* │     payloadBytes (uint64_t)                           │   */
+/* │     reserved (uint64_t x 5)                           │   */
+/* ├───────────────────────────────────────────────────────┤   */
+/* │   payload [payloadBytes]                              │   */
+/* │     byte-identical copy of the shared memory segment, │   */
+/* │     (i.e. a WisentRootExpression, with                │   */
+/* │      originalAddress set to nullptr)                  │   */
+/* └───────────────────────────────────────────────────────┘   */
+/*                                                             */
+/*  All offsets inside the payload are relative to the root,   */
+/*  so the payload can be used directly from an mmap of the    */
+/*  file at (base + headerBytes), without any parsing.         */
+/*                                                             */
+/***************************************************************/
+
+static char const WisentFile_MAGIC[8] = {'W', 'I', 'S', 'E', 'N', 'T', '\0', '\0'};
+static uint32_t const WisentFile_VERSION = 1;
+static char const *const WisentFile_EXTENSION = ".wisent";
+
+struct WisentFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;   // offset of the payload from the start of the file
+    uint64_t payloadBytes;  // size of the WisentRootExpression allocation
+    uint64_t reserved[5];
+};
+
+static_assert(sizeof(WisentFileHeader) == 64, "WisentFileHeader must stay 64 bytes");
+
+inline WisentFileHeader makeWisentFileHeader(uint64_t payloadBytes)
+{
+    WisentFileHeader header{};
+    memcpy(header.magic, WisentFile_MAGIC, sizeof(WisentFile_MAGIC));
+    header.version = WisentFile_VERSION;
+    header.headerBytes = sizeof(WisentFileHeader);
+    header.payloadBytes = payloadBytes;
+    return header;
+}
+
+inline bool isValidWisentFileHeader(
+    WisentFileHeader const *header,
+    uint64_t fileBytes
+) {
+    if (fileBytes < sizeof(WisentFileHeader))
+    {
+        return false;
+    }
+    return memcmp(header->magic, WisentFile_MAGIC, sizeof(WisentFile_MAGIC)) == 0
+        && header->version == WisentFile_VERSION
+        && header->headerBytes == sizeof(WisentFileHeader)
+        && header->payloadBytes <= fileBytes - header->headerBytes;
+}
+
+#endif /* WISENTFILE_HPP */
@@ -311,10 +311,13 @@ static char *getStringBuffer(PortableBossRootExpression *root)
 
 ////////////////////////////// Memory Management ////////////////////////////////
 
+// allocateFunction: any void *(size_t) callable, e.g. sharedMemoryMalloc or a
+// lambda bound to one segment (see JsonToWisent), so builders need no global state
+template <typename AllocateFunction>
 inline WisentRootExpression* allocateExpressionTree(
     uint64_t argumentCount,
     uint64_t expressionCount,
-    void* (*allocateFunction)(size_t)   // sharedMemoryMalloc(size)
+    AllocateFunction allocateFunction
 ) {
     WisentRootExpression *root = reinterpret_cast<WisentRootExpression*>(allocateFunction(
         sizeof(WisentRootExpression) +
@@ -1024,10 +1027,11 @@ static PortableBossExpression *makeExpression(
 /*                                                                                         */
 /*******************************************************************************************/
 
+template <typename ReallocateFunction>
 inline size_t storeString(
     WisentRootExpression **root,
     char const *inputString,
-    void *(*reallocateFunction)(void *, size_t)
+    ReallocateFunction reallocateFunction
 ) {
     const size_t inputStringLength = strlen(inputString);
     char *stringBufferStart = getStringBuffer(*root); 
@@ -1053,10 +1057,11 @@ inline size_t storeString(
 }
 
 // same as storeString(), but for byte arrays
+template <typename ReallocateFunction>
 inline size_t storeBytes(
     WisentRootExpression **root,
     const std::vector<uint8_t> &inputBytes,
-    void *(*reallocateFunction)(void *, size_t)
+    ReallocateFunction reallocateFunction
 ) {
     const size_t inputBytesLength = inputBytes.size();
     char *stringBufferStart = getStringBuffer(*root); 
@@ -1,10 +1,105 @@
 #include "ServerHelpers.hpp"
 #include "BsonSerializer/BsonSerializer.hpp"
 #include "Helpers/CsvLoading.hpp"
+#include "Helpers/Metrics.hpp"
+#include "Helpers/ServerHelpers/LoadJobs.hpp"
 #include "WisentCompressor/CompressionPipeline.hpp"
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <string>
 #include <filesystem>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// "512M", "4G", ... (plain numbers are bytes)
+static size_t parseByteSize(std::string const &value)
+{
+    size_t bytes = std::strtoull(value.c_str(), nullptr, 10);
+    switch (value.empty() ? '\0' : std::toupper(value.back())) 
+    {
+        case 'K': return bytes << 10;
+        case 'M': return bytes << 20;
+        case 'G': return bytes << 30;
+        default: return bytes;
+    }
+}
+
+ServerConfig parseServerArguments(
+    int argc, 
+    char **argv
+) {
+    ServerConfig config;
+    for (int i = 1; i + 1 < argc; i += 2) 
+    {
+        std::string const option = argv[i];
+        std::string const value = argv[i + 1];
+        if (option == "--host") 
+        {
+            config.host = value;
+        }
+        else if (option == "--port") 
+        {
+            config.port = atoi(value.c_str());
+        }
+        else if (option == "--persist-dir") 
+        {
+            config.persistDirectory = value;
+        }
+        else if (option == "--memory-budget") 
+        {
+            config.memoryBudgetBytes = parseByteSize(value);
+        }
+        else if (option == "--segment-backend") 
+        {
+            config.segmentBackend = value;
+        }
+        else if (option == "--fd-socket") 
+        {
+            config.fdSocketPath = value;
+        }
+        else if (option == "--workers") 
+        {
+            config.workerCount = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (option == "--max-batch") 
+        {
+            config.maxBatchSize = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (option == "--max-jobs") 
+        {
+            config.maxJobs = std::strtoull(value.c_str(), nullptr, 10);
+        }
+        else if (option == "--manifest") 
+        {
+            config.manifestPath = value;
+        }
+        else if (option == "--unix-socket") 
+        {
+            config.unixSocketPath = value;
+        }
+        else if (option == "--unix-socket-mode") 
+        {
+            config.unixSocketMode = static_cast<mode_t>(std::strtoul(value.c_str(), nullptr, 8));
+        }
+        else 
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+        }
+    }
+    if (config.segmentBackend != "shm" && config.segmentBackend != "memfd") 
+    {
+        std::cerr << "Unknown segment backend: " << config.segmentBackend << ", using shm" << std::endl;
+        config.segmentBackend = "shm";
+    }
+    if (config.segmentBackend == "memfd" && config.fdSocketPath.empty()) 
+    {
+        std::cerr << "Warning: memfd datasets are only reachable by consumers through --fd-socket" << std::endl;
+    }
+    return config;
+}
 
 void parseRequestParams(
     const httplib::Params &params, 
@@ -12,7 +107,8 @@ void parseRequestParams(
     std::string &filepath, 
     std::string &csvPrefix,
     bool &disableRLE, 
-    bool &disableCsvHandling
+    bool &disableCsvHandling, 
+    bool &forceReload
 ) {
     filename = params.find("name") != params.end() ? params.find("name")->second : "";
     filepath = params.find("path") != params.end() ? params.find("path")->second : "";
@@ -29,6 +125,107 @@ void parseRequestParams(
         auto const &str = params.find("disableCsvHandling")->second;
         disableCsvHandling = (str.empty() || str == "True" || str == "true" || atoi(str.c_str()) > 0);
     }
+
+    if (params.find("forceReload") != params.end()) 
+    {
+        auto const &str = params.find("forceReload")->second;
+        forceReload = (str.empty() || str == "True" || str == "true" || atoi(str.c_str()) > 0);
+    }
+}
+
+bool isValidPersistName(std::string const &name)
+{
+    return !name.empty()
+        && name.find('/') == std::string::npos
+        && name.find('\\') == std::string::npos
+        && name.find("..") == std::string::npos
+        && name.find('\0') == std::string::npos;
+}
+
+bool bindUnixSocket(
+    httplib::Server &svr, 
+    std::string const &socketPath, 
+    mode_t mode
+) {
+    struct stat existing;
+    if (lstat(socketPath.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) 
+    {
+        unlink(socketPath.c_str());
+    }
+    svr.set_address_family(AF_UNIX);
+    // the umask keeps the socket from being reachable with wider permissions
+    // between bind() and chmod(); the port only has to be non-zero for AF_UNIX
+    mode_t previousMask = umask(~mode & 0777);
+    bool bound = svr.bind_to_port(socketPath, 80);
+    umask(previousMask);
+    return bound && chmod(socketPath.c_str(), mode) == 0;
+}
+
+bool isAsyncRequest(const httplib::Params &params)
+{
+    if (params.find("async") == params.end()) 
+    {
+        return false;
+    }
+    auto const &str = params.find("async")->second;
+    return str.empty() || str == "True" || str == "true" || atoi(str.c_str()) > 0;
+}
+
+// httplib serves a request on one thread from routing to logging
+static thread_local std::chrono::steady_clock::time_point requestStart;
+
+void instrumentServer(
+    httplib::Server &svr, 
+    DatasetCache &datasetCache
+) {
+    svr.set_pre_routing_handler([](const httplib::Request & /*req*/, httplib::Response & /*res*/) 
+    {
+        requestStart = std::chrono::steady_clock::now();
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+    svr.set_logger([](const httplib::Request &req, const httplib::Response &res) 
+    {
+        // unrouted paths (404 without a body) share one label, so scanners 
+        // cannot create a series per path
+        std::string endpoint = res.status == httplib::NotFound_404 && res.body.empty() ? "unmatched" : req.path;
+        Metrics::getCounter(
+            "wisent_http_requests_total", 
+            "HTTP requests by endpoint and status", 
+            {{"endpoint", endpoint}, {"status", std::to_string(res.status)}}
+        ).add();
+        if (requestStart == std::chrono::steady_clock::time_point{}) 
+        {
+            return;     // rejected before routing
+        }
+        Metrics::getHistogram(
+            "wisent_http_request_duration_seconds", 
+            "HTTP request latency by endpoint", 
+            {{"endpoint", endpoint}}
+        ).observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - requestStart).count());
+        requestStart = {};
+    });
+
+    Metrics::setGauge("wisent_datasets", "Datasets mapped by the server", [&datasetCache]() 
+    {
+        return std::vector<std::pair<Metrics::Labels, double>>{
+            {{}, static_cast<double>(datasetCache.getDatasetBytes().size())}
+        };
+    });
+    Metrics::setGauge("wisent_dataset_bytes", "Segment size of every mapped dataset", [&datasetCache]() 
+    {
+        std::vector<std::pair<Metrics::Labels, double>> samples;
+        for (auto const &[name, bytes] : datasetCache.getDatasetBytes()) 
+        {
+            samples.push_back({{{"name", name}}, static_cast<double>(bytes)});
+        }
+        return samples;
+    });
+    Metrics::setGauge("wisent_memory_budget_bytes", "Budget of the mapped datasets, 0 if unlimited", [&datasetCache]() 
+    {
+        return std::vector<std::pair<Metrics::Labels, double>>{
+            {{}, static_cast<double>(datasetCache.getMemoryBudgetBytes())}
+        };
+    });
 }
 
 void parseCompressionPipeline(
@@ -75,3 +272,27 @@ bool WriteBufferToFile(
     outFile.write(data, dataSize);
     return outFile.good();
 }
+
+void handleLoadResponse(
+    httplib::Response &res,
+    Result<WisentRootExpression*> &result, 
+    const std::chrono::high_resolution_clock::time_point &start,
+    const std::chrono::high_resolution_clock::time_point &end,
+    LoadProfile const &profile
+) {
+    if (!result.success()) 
+    {
+        handleResponse(res, result, start, end); 
+        return;
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    nlohmann::json response = {
+        {"status", "success"},
+        {"seconds", seconds},
+        {"warnings", result.warnings},
+        {"profile", makeLoadProfileJson(profile)}
+    };
+    std::cout << "Success in " << seconds << " s." << std::endl;
+    res.set_content(response.dump(), "application/json");
+}
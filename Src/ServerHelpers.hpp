@@ -1,6 +1,33 @@
 #pragma once
 #include "../Include/httplib.h"
 #include "WisentCompressor/CompressionPipeline.hpp"
+#include "WisentSerializer/WisentSerializer.hpp"
+#include "Helpers/ISharedMemorySegment.hpp"
+#include "Helpers/LoadProfile.hpp"
+#include "Helpers/ServerHelpers/DatasetCache.hpp"
+#include <filesystem>
+#include <sys/types.h>
+
+struct ServerConfig 
+{
+    std::string host = "0.0.0.0";
+    int port = 8000;
+    std::string persistDirectory;   // empty: datasets are not persisted to disk
+    size_t memoryBudgetBytes = 0;   // 0: no limit on the mapped datasets
+    std::string segmentBackend = "shm";     // "shm" (named POSIX shm) or "memfd"
+    std::string fdSocketPath;       // empty: memfd descriptors are not handed out
+    size_t workerCount = 0;         // concurrent dataset builds, 0: one per hardware thread
+    size_t maxBatchSize = 64;       // datasets per /batch request, larger ones are refused
+    size_t maxJobs = 256;           // unfinished jobs (a thread each), more are answered 503
+    std::string manifestPath;       // empty: nothing is loaded at startup, see Preloader.hpp
+    std::string unixSocketPath;     // non-empty: served on this Unix domain socket instead of TCP
+    mode_t unixSocketMode = 0660;   // who may connect: the socket file's permissions
+};
+
+ServerConfig parseServerArguments(
+    int argc, 
+    char **argv
+); 
 
 void parseRequestParams(
     const httplib::Params &params, 
@@ -8,7 +35,29 @@ void parseRequestParams(
     std::string &filepath, 
     std::string &csvPrefix,
     bool &disableRLE, 
-    bool &disableCsvHandling
+    bool &disableCsvHandling, 
+    bool &forceReload
+); 
+
+/*
+ * Binds svr to a Unix domain socket (a stale socket file is replaced). The
+ * file is created with mode, so access is granted through its owner, group
+ * and the permissions of the directory. Serve with svr.listen_after_bind().
+ */
+bool bindUnixSocket(
+    httplib::Server &svr, 
+    std::string const &socketPath, 
+    mode_t mode
+); 
+
+// "async=true": the load runs as a job, see LoadJobs.hpp
+bool isAsyncRequest(const httplib::Params &params); 
+
+// request counts & latencies per endpoint and the sizes of the mapped 
+// datasets, for GET /metrics (see Helpers/Metrics.hpp)
+void instrumentServer(
+    httplib::Server &svr, 
+    DatasetCache &datasetCache
 ); 
 
 void parseCompressionPipeline(
@@ -23,6 +72,107 @@ bool WriteBufferToFile(
     size_t dataSize
 ); 
 
+// a dataset name usable as a file name in the persist directory: 
+// no path separators, no "..", no NUL
+bool isValidPersistName(std::string const &name); 
+
+/*
+ * With a persist directory configured, a dataset is mapped from its Wisent 
+ * file when one exists (no re-ingest after a restart), otherwise it is built 
+ * with buildFunction and written to the persist directory afterwards. 
+ * The file is not restored on forceReload, or when sourcePath was modified 
+ * after it was written. Names that are no valid file names are refused.
+ */
+template<typename BuildFunction>
+Result<WisentRootExpression*> loadOrRestorePersisted(
+    ServerConfig const &config,
+    std::string const &sharedMemoryName,
+    std::string const &sourcePath,
+    bool forceReload,
+    BuildFunction &&buildFunction
+) {
+    if (config.persistDirectory.empty()) 
+    {
+        return buildFunction();
+    }
+    // the name becomes a file name in the persist directory
+    if (!isValidPersistName(sharedMemoryName)) 
+    {
+        return makeError<WisentRootExpression*>("invalid dataset name: " + sharedMemoryName);
+    }
+
+    std::string filePath = wisent::serializer::getPersistedFilePath(
+        sharedMemoryName, 
+        config.persistDirectory
+    );
+    std::error_code error;
+    bool restore = !forceReload && std::filesystem::exists(filePath, error);
+    if (restore && std::filesystem::exists(sourcePath, error)) 
+    {
+        restore = std::filesystem::last_write_time(sourcePath, error) 
+            <= std::filesystem::last_write_time(filePath, error);
+    }
+    if (restore) 
+    {
+        Result<WisentRootExpression*> restored = wisent::serializer::loadPersisted(
+            filePath, 
+            sharedMemoryName
+        );
+        if (restored.success()) 
+        {
+            return restored;
+        }
+    }
+
+    Result<WisentRootExpression*> result = buildFunction();
+    if (result.success()) 
+    {
+        Result<std::string> persisted = wisent::serializer::persist(
+            sharedMemoryName, 
+            config.persistDirectory
+        );
+        if (!persisted.success()) 
+        {
+            result.addWarning("not persisted: " + persisted.getError());
+        }
+    }
+    return result;
+}
+
+// records a loaded dataset in the cache, evictions are reported as warnings
+template<typename T>
+void admitToDatasetCache(
+    DatasetCache &datasetCache,
+    std::string const &sharedMemoryName,
+    Result<T> &result
+) {
+    if (!result.success()) 
+    {
+        return;
+    }
+    for (std::string const &evicted : datasetCache.admit(sharedMemoryName)) 
+    {
+        result.addWarning("evicted: " + evicted);
+    }
+}
+
+// memfd datasets are sealed read-only once built, before any consumer receives them
+template<typename T>
+void sealForConsumers(
+    ServerConfig const &config,
+    std::string const &sharedMemoryName,
+    Result<T> &result
+) {
+    if (!result.success() || config.segmentBackend != "memfd") 
+    {
+        return;
+    }
+    if (!SharedMemorySegments::sealMemfdMemorySegment(sharedMemoryName)) 
+    {
+        result.addWarning("not sealed: " + sharedMemoryName);
+    }
+}
+
 template<typename T>
 void handleResponse(
     httplib::Response &res,
@@ -36,6 +186,7 @@ void handleResponse(
         std::cerr << errorMessage << std::endl;
         res.status = httplib::BadRequest_400; 
         res.set_content(errorMessage, "text/plain");
+        return;
     }
 
     auto timeDiff = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
@@ -61,4 +212,13 @@ void handleResponse(
     
     std::cout << successMessage << std::endl;
     res.set_content(successMessage, "text/plain");
-}; 
\ No newline at end of file
+}; 
+
+// for the load endpoints: total time, warnings and the phase breakdown as JSON
+void handleLoadResponse(
+    httplib::Response &res,
+    Result<WisentRootExpression*> &result, 
+    const std::chrono::high_resolution_clock::time_point &start,
+    const std::chrono::high_resolution_clock::time_point &end,
+    LoadProfile const &profile
+); 
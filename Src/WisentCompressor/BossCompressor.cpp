@@ -21,7 +21,7 @@ wisent::compressor::CompressAndLoadBossExpression(
 ) {    
     Result<boss::serialization::SerializedBossExpression<Allocate, Reallocate, Free>*> result;
 
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
     if (!forceReload && sharedMemory->exists() && !sharedMemory->isLoaded()) 
     {
         sharedMemory->load();
@@ -36,10 +36,11 @@ wisent::compressor::CompressAndLoadBossExpression(
             result.setValue(loadedValue);
             return result;
         }
-        sharedMemory->erase();
-        SharedMemorySegments::getSharedMemorySegments().erase(sharedMemoryName);
+        sharedMemory.release();
+        SharedMemorySegments::eraseMemorySegment(sharedMemoryName);
+        sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
     }
-    SharedMemorySegments::setCurrentSharedMemory(sharedMemory);
+    SharedMemorySegments::setCurrentSharedMemory(sharedMemory.get());
 
     using SerializedBossExpression = boss::serialization::SerializedBossExpression<
         SharedMemorySegments::sharedMemoryMalloc, 
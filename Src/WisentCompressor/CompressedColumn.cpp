@@ -0,0 +1,318 @@
+#include "CompressedColumn.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    using wisent::compressor::CompressedColumn;
+    using wisent::compressor::CompressedPage;
+
+    struct TreeView
+    {
+        WisentArgumentValue const *arguments;
+        WisentArgumentType const *types;
+        WisentExpression const *expressions;
+        char const *strings;
+        uint64_t argumentCount;
+        uint64_t expressionCount;
+        uint64_t stringBytes;
+    };
+
+    TreeView makeTreeView(WisentRootExpression const *root)
+    {
+        WisentRootExpression *mutableRoot = const_cast<WisentRootExpression *>(root);
+        return {
+            getArgumentsBuffer(mutableRoot),
+            getArgumentTypesBuffer(mutableRoot),
+            getSubexpressionsBuffer(mutableRoot),
+            getStringBuffer(mutableRoot),
+            root->argumentCount,
+            root->expressionCount,
+            root->stringBufferBytesWritten
+        };
+    }
+
+    bool isValidExpression(
+        TreeView const &tree,
+        uint64_t expressionIndex
+    ) {
+        if (expressionIndex >= tree.expressionCount)
+        {
+            return false;
+        }
+        WisentExpression const &expression = tree.expressions[expressionIndex];
+        return expression.symbolNameOffset < tree.stringBytes
+            && expression.firstChildOffset <= expression.lastChildOffset
+            && expression.lastChildOffset <= tree.argumentCount;
+    }
+
+    // the type of each argument of the expression, type runs expanded
+    std::vector<uint8_t> getArgumentTypes(
+        TreeView const &tree,
+        WisentExpression const &expression
+    ) {
+        std::vector<uint8_t> types;
+        for (uint64_t argument = expression.firstChildOffset; argument < expression.lastChildOffset;)
+        {
+            size_t type = tree.types[argument];
+            uint64_t runLength = 1;
+            if ((type & WisentArgumentType_RLE_BIT) != 0 && argument + 1 < expression.lastChildOffset)
+            {
+                runLength = std::max<uint64_t>(static_cast<uint32_t>(tree.types[argument + 1]), 1);
+                runLength = std::min(runLength, expression.lastChildOffset - argument);
+            }
+            types.insert(types.end(), runLength, static_cast<uint8_t>(type & ~WisentArgumentType_RLE_BIT));
+            argument += runLength;
+        }
+        return types;
+    }
+
+    // the child expression with this head
+    bool findChild(
+        TreeView const &tree,
+        uint64_t expressionIndex,
+        char const *head,
+        uint64_t &childIndex
+    ) {
+        WisentExpression const &expression = tree.expressions[expressionIndex];
+        std::vector<uint8_t> types = getArgumentTypes(tree, expression);
+        for (size_t i = 0; i < types.size(); i++)
+        {
+            uint64_t child = tree.arguments[expression.firstChildOffset + i].asExpression;
+            if (types[i] == ARGUMENT_TYPE_EXPRESSION && isValidExpression(tree, child)
+                && strcmp(tree.strings + tree.expressions[child].symbolNameOffset, head) == 0)
+            {
+                childIndex = child;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the long arguments of the child expression with this head
+    bool readLongs(
+        TreeView const &tree,
+        uint64_t expressionIndex,
+        char const *head,
+        std::vector<int64_t> &values
+    ) {
+        uint64_t child;
+        if (!findChild(tree, expressionIndex, head, child))
+        {
+            return false;
+        }
+        WisentExpression const &expression = tree.expressions[child];
+        std::vector<uint8_t> types = getArgumentTypes(tree, expression);
+        for (size_t i = 0; i < types.size(); i++)
+        {
+            if (types[i] != ARGUMENT_TYPE_LONG)
+            {
+                return false;
+            }
+            values.push_back(tree.arguments[expression.firstChildOffset + i].asLong);
+        }
+        return true;
+    }
+
+    bool readLong(
+        TreeView const &tree,
+        uint64_t expressionIndex,
+        char const *head,
+        int64_t &value
+    ) {
+        std::vector<int64_t> values;
+        if (!readLongs(tree, expressionIndex, head, values) || values.size() != 1)
+        {
+            return false;
+        }
+        value = values.front();
+        return true;
+    }
+
+    bool readPage(
+        TreeView const &tree,
+        uint64_t pageIndex,
+        CompressedPage &page
+    ) {
+        int64_t numberOfValues;
+        int64_t compressedPageSize;
+        uint64_t pageData;
+        if (!readLong(tree, pageIndex, "numberOfValues", numberOfValues) || numberOfValues < 0
+            || !readLong(tree, pageIndex, "compressedPageSize", compressedPageSize) || compressedPageSize < 0
+            || !findChild(tree, pageIndex, "pageData", pageData))
+        {
+            return false;
+        }
+        WisentExpression const &data = tree.expressions[pageData];
+        if (data.lastChildOffset - data.firstChildOffset != 1 || getArgumentTypes(tree, data).front() != ARGUMENT_TYPE_BYTE_ARRAY)
+        {
+            return false;
+        }
+        page.numberOfValues = static_cast<uint64_t>(numberOfValues);
+        page.dataOffset = tree.arguments[data.firstChildOffset].asString;
+        page.dataBytes = static_cast<uint64_t>(compressedPageSize);
+        return page.dataOffset <= tree.stringBytes && page.dataBytes <= tree.stringBytes - page.dataOffset;
+    }
+
+    // a BYTE_ARRAY page: [uint32 length][bytes] per value
+    bool appendStrings(
+        std::vector<uint8_t> const &page,
+        uint64_t numberOfValues,
+        std::vector<std::string> &strings
+    ) {
+        size_t position = 0;
+        for (uint64_t i = 0; i < numberOfValues; i++)
+        {
+            uint32_t length;
+            if (page.size() - position < sizeof(length))
+            {
+                return false;
+            }
+            memcpy(&length, page.data() + position, sizeof(length));
+            position += sizeof(length);
+            if (page.size() - position < length)
+            {
+                return false;
+            }
+            strings.emplace_back(reinterpret_cast<char const *>(page.data() + position), length);
+            position += length;
+        }
+        return position == page.size();
+    }
+}
+
+bool wisent::compressor::isCompressedColumn(
+    WisentRootExpression const *root,
+    uint64_t expressionIndex
+) {
+    TreeView tree = makeTreeView(root);
+    uint64_t pages;
+    return isValidExpression(tree, expressionIndex) && findChild(tree, expressionIndex, "pages", pages)
+        && findChild(tree, expressionIndex, "encodingType", pages);
+}
+
+Result<CompressedColumn> wisent::compressor::readCompressedColumn(
+    WisentRootExpression const *root,
+    uint64_t expressionIndex
+) {
+    Result<CompressedColumn> result;
+    TreeView tree = makeTreeView(root);
+    int64_t numberOfValues;
+    int64_t physicalType;
+    int64_t encodingType;
+    std::vector<int64_t> compressionTypes;
+    uint64_t pages;
+    if (!isValidExpression(tree, expressionIndex)
+        || !readLong(tree, expressionIndex, "numberOfValues", numberOfValues) || numberOfValues < 0
+        || !readLong(tree, expressionIndex, "physicalType", physicalType)
+        || !readLong(tree, expressionIndex, "encodingType", encodingType)
+        || !readLongs(tree, expressionIndex, "compressionType", compressionTypes)
+        || !findChild(tree, expressionIndex, "pages", pages))
+    {
+        return makeError<CompressedColumn>("not a compressed column");
+    }
+    // the enums are persisted as their numbers
+    if (physicalType < 0 || physicalType > static_cast<int64_t>(PhysicalType::BOOLEAN)
+        || encodingType < 0 || encodingType > static_cast<int64_t>(EncodingType::AUTO))
+    {
+        return makeError<CompressedColumn>("unknown physical type or encoding");
+    }
+
+    CompressedColumn column;
+    column.physicalType = static_cast<PhysicalType>(physicalType);
+    column.encodingType = static_cast<EncodingType>(encodingType);
+    column.numberOfValues = static_cast<uint64_t>(numberOfValues);
+    for (int64_t compressionType : compressionTypes)
+    {
+        if (compressionType < 0 || compressionType > static_cast<int64_t>(CompressionType::RLE_STRING)
+            || compressionType == static_cast<int64_t>(CompressionType::CUSTOM))
+        {
+            return makeError<CompressedColumn>("unknown compression type: " + std::to_string(compressionType));
+        }
+        column.compressionTypes.push_back(static_cast<CompressionType>(compressionType));
+    }
+
+    WisentExpression const &pagesExpression = tree.expressions[pages];
+    std::vector<uint8_t> pageTypes = getArgumentTypes(tree, pagesExpression);
+    for (size_t i = 0; i < pageTypes.size(); i++)
+    {
+        uint64_t pageIndex = tree.arguments[pagesExpression.firstChildOffset + i].asExpression;
+        CompressedPage page;
+        if (pageTypes[i] != ARGUMENT_TYPE_EXPRESSION || !isValidExpression(tree, pageIndex) || !readPage(tree, pageIndex, page))
+        {
+            return makeError<CompressedColumn>("corrupt page header " + std::to_string(i));
+        }
+        column.pages.push_back(page);
+    }
+    result.value = std::move(column);
+    return result;
+}
+
+Result<wisent::compressor::DecodedColumn> wisent::compressor::decodeCompressedColumn(
+    WisentRootExpression const *root,
+    uint64_t expressionIndex
+) {
+    Result<DecodedColumn> result;
+    Result<CompressedColumn> column = readCompressedColumn(root, expressionIndex);
+    if (!column.success())
+    {
+        return makeError<DecodedColumn>(column.getError());
+    }
+
+    DecompressionPipeline pipeline = column.value->getDecompressionPipeline();
+    ColumnCodecState columnState;
+    char const *strings = getStringBuffer(const_cast<WisentRootExpression *>(root));
+    DecodedColumn decoded;
+    decoded.physicalType = column.value->physicalType;
+    for (size_t i = 0; i < column.value->pages.size(); i++)
+    {
+        CompressedPage const &page = column.value->pages[i];
+        std::vector<uint8_t> data(strings + page.dataOffset, strings + page.dataOffset + page.dataBytes);
+        std::string pageError = "page " + std::to_string(i) + ": ";
+        if (decoded.physicalType == PhysicalType::INT64)
+        {
+            Result<std::vector<int64_t>> values = pipeline.decompressIntPage(data, &columnState);
+            if (!values.success() || values.value->size() != page.numberOfValues)
+            {
+                return makeError<DecodedColumn>(pageError + (values.success() ? "wrong value count" : values.getError()));
+            }
+            decoded.longs.insert(decoded.longs.end(), values.value->begin(), values.value->end());
+            continue;
+        }
+
+        Result<std::vector<uint8_t>> bytes = pipeline.decompress(data, &columnState);
+        if (!bytes.success())
+        {
+            return makeError<DecodedColumn>(pageError + bytes.getError());
+        }
+        if (decoded.physicalType == PhysicalType::DOUBLE)
+        {
+            if (bytes.value->size() % sizeof(double) != 0 || bytes.value->size() / sizeof(double) != page.numberOfValues)
+            {
+                return makeError<DecodedColumn>(pageError + "wrong value count");
+            }
+            size_t first = decoded.doubles.size();
+            decoded.doubles.resize(first + page.numberOfValues);
+            memcpy(decoded.doubles.data() + first, bytes.value->data(), bytes.value->size());
+        }
+        else if (decoded.physicalType == PhysicalType::BYTE_ARRAY)
+        {
+            if (!appendStrings(*bytes.value, page.numberOfValues, decoded.strings))
+            {
+                return makeError<DecodedColumn>(pageError + "not a page of length-prefixed strings");
+            }
+        }
+        else
+        {
+            return makeError<DecodedColumn>("unsupported physical type");
+        }
+    }
+
+    uint64_t valueCount = decoded.longs.size() + decoded.doubles.size() + decoded.strings.size();
+    if (valueCount != column.value->numberOfValues)
+    {
+        return makeError<DecodedColumn>("pages do not add up to the column's value count");
+    }
+    result.value = std::move(decoded);
+    return result;
+}
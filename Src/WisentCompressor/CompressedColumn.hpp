@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../Helpers/Result.hpp"
+#include "../Helpers/WisentHelpers/WisentHelpers.hpp"
+#include "CompressionPipeline.hpp"
+
+/*
+ * Reading back the columns CompressAndLoadJson writes as metadata and pages
+ * (see addColumnMetaDataExpressions in JsonToWisent.hpp) instead of values:
+ *
+ *   (<column> (numberOfValues n) ... (physicalType t) (encodingType e)
+ *             (compressionType c1 c2 ...) (pages (Page ... (pageData <bytes>)) ...))
+ *
+ * Pages are undone by a DecompressionPipeline built from the stored steps and
+ * encoding, with one codec state for the whole column (FSE tables repeat from
+ * page to page), so int pages come back whatever their encoding.
+ */
+namespace wisent::compressor
+{
+    struct CompressedPage
+    {
+        uint64_t numberOfValues;
+        uint64_t dataOffset;    // of the page bytes, in the string buffer
+        uint64_t dataBytes;
+    };
+
+    struct CompressedColumn
+    {
+        PhysicalType physicalType;
+        EncodingType encodingType;
+        std::vector<CompressionType> compressionTypes;
+        uint64_t numberOfValues;
+        std::vector<CompressedPage> pages;
+
+        DecompressionPipeline getDecompressionPipeline() const
+        {
+            return DecompressionPipeline(compressionTypes, {}, encodingType);
+        }
+    };
+
+    // the values of one column, in the vector of its physical type
+    struct DecodedColumn
+    {
+        PhysicalType physicalType;
+        std::vector<int64_t> longs;
+        std::vector<double> doubles;
+        std::vector<std::string> strings;
+    };
+
+    // true if the expression is a column written as metadata and pages
+    bool isCompressedColumn(
+        WisentRootExpression const *root,
+        uint64_t expressionIndex
+    );
+
+    // the metadata, checked against the buffers of the tree
+    Result<CompressedColumn> readCompressedColumn(
+        WisentRootExpression const *root,
+        uint64_t expressionIndex
+    );
+
+    Result<DecodedColumn> decodeCompressedColumn(
+        WisentRootExpression const *root,
+        uint64_t expressionIndex
+    );
+}
@@ -5,23 +5,54 @@
 #include <functional>
 #include "../Helpers/CompressionHelpers/Algorithms.hpp"
 #include "../Helpers/Result.hpp"
+#include "../Helpers/Metrics.hpp"
 
 using namespace wisent::algorithms;
 
+// one per column: the state each step carries from page to page
+using ColumnCodecState = std::vector<PageCodecState>;
+
 class CompressionPipeline 
 {
   private:
     std::vector<CompressionType> pipeline;
     std::vector<std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>> customFunctions;
+    EncodingType encoding = EncodingType::PLAIN;    // of int columns
+
+    struct CodecCounters
+    {
+        Metrics::Counter &inputBytes;
+        Metrics::Counter &outputBytes;
+    };
+
+    // looked up once per codec rather than per page and step
+    static CodecCounters const &getCodecCounters(CompressionType type) 
+    {
+        static std::vector<CodecCounters> const counters = [] {
+            std::vector<CodecCounters> byType;
+            for (size_t index = 0; index <= static_cast<size_t>(CompressionType::RLE_STRING); ++index) 
+            {
+                Metrics::Labels codec = {{"codec", compressionTypeToString(static_cast<CompressionType>(index))}};
+                byType.push_back({
+                    Metrics::getCounter("wisent_codec_input_bytes_total", "Bytes given to a compression step", codec),
+                    Metrics::getCounter("wisent_codec_output_bytes_total", "Bytes produced by a compression step", codec)
+                });
+            }
+            return byType;
+        }();
+        return counters[static_cast<size_t>(type)];
+    }
 
   public:
     CompressionPipeline() = default;
     CompressionPipeline(
         const std::vector<CompressionType>& steps,
-        const std::vector<std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>>& customFunctions
+        const std::vector<std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>>& customFunctions,
+        EncodingType encoding = EncodingType::PLAIN
     ) 
     : pipeline(steps)
     , customFunctions(customFunctions)
+    , encoding(encoding)
     {}
 
     void log() const 
@@ -38,14 +69,26 @@ class CompressionPipeline
         return pipeline;
     }
 
+    EncodingType getEncoding() const 
+    {
+        return encoding;
+    }
+
+    // pass the column's state to let later pages build on earlier ones
     Result<std::vector<uint8_t>> compress(
-        const std::vector<uint8_t>& data
+        const std::vector<uint8_t>& data,
+        ColumnCodecState* columnState = nullptr
     ) const {
         Result<std::vector<uint8_t>> result; 
         std::vector<uint8_t> current = data;
+        if (columnState != nullptr) 
+        {
+            columnState->resize(pipeline.size());
+        }
 
-        for (CompressionType type : pipeline) 
+        for (size_t step = 0; step < pipeline.size(); ++step) 
         {
+            CompressionType type = pipeline[step];
             std::vector<uint8_t> compressed;
             if (type == CompressionType::CUSTOM) 
             {
@@ -60,8 +103,12 @@ class CompressionPipeline
             } 
             else 
             {
-                compressed = performCompression(type, current);
+                compressed = performCompression(type, current, columnState != nullptr ? &(*columnState)[step] : nullptr);
             }
+            // ratio per codec = output / input
+            CodecCounters const &counters = getCodecCounters(type);
+            counters.inputBytes.add(current.size());
+            counters.outputBytes.add(compressed.size());
             if (compressed.size() >= current.size()*2) 
             {
                 result.addWarning("Custom compression " + compressionTypeToString(type) + " did not reduce size, skipping.");
@@ -78,6 +125,7 @@ class CompressionPipeline
       private:
         std::vector<CompressionType> steps;
         std::vector<std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>> customFunctions;
+        EncodingType encoding = EncodingType::PLAIN;
 
       public:
         Builder& addStep(CompressionType type) {
@@ -85,11 +133,24 @@ class CompressionPipeline
             return *this;
         }
 
+        // an encoding name ("delta_binary_packed") sets the encoding instead
         Builder& addStep(const std::string& typeString) {
+            std::string name = typeString;
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            auto it = encodingAliases.find(name);
+            if (it != encodingAliases.end()) 
+            {
+                return setEncoding(it->second);
+            }
             steps.push_back(stringToCompressionType(typeString));
             return *this;
         }
 
+        Builder& setEncoding(EncodingType type) {
+            encoding = type;
+            return *this;
+        }
+
         Builder& addStep(std::function<std::vector<uint8_t>(
             const std::vector<uint8_t>&)> customFunction
         ) {
@@ -99,13 +160,15 @@ class CompressionPipeline
         }
 
         CompressionPipeline build() {
-            return CompressionPipeline(steps, customFunctions);
+            return CompressionPipeline(steps, customFunctions, encoding);
         }
     };
 };
 
 
-// same builder implementation but calls decompress functions
+// same builder implementation but calls decompress functions: the steps are 
+// given in compression order (as stored in the column metadata) and undone in 
+// reverse, int pages are then decoded with the column's encoding
 #pragma region decompression_pipeline
 
 class DecompressionPipeline 
@@ -113,15 +176,18 @@ class DecompressionPipeline
   private:
     std::vector<CompressionType> pipeline;
     std::vector<std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>> customFunctions;
+    EncodingType encoding = EncodingType::PLAIN;    // of int columns
 
   public:
     DecompressionPipeline() = default;
     DecompressionPipeline(
         const std::vector<CompressionType>& steps,
-        const std::vector<std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>>& customFunctions
+        const std::vector<std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>>& customFunctions,
+        EncodingType encoding = EncodingType::PLAIN
     ) 
     : pipeline(steps)
     , customFunctions(customFunctions)
+    , encoding(encoding)
     {}
 
     void log() const 
@@ -138,14 +204,26 @@ class DecompressionPipeline
         return pipeline;
     }
 
+    EncodingType getEncoding() const 
+    {
+        return encoding;
+    }
+
+    // the pages of a column compressed with a state decompress in order, with one
     Result<std::vector<uint8_t>> decompress(
-        const std::vector<uint8_t>& data
+        const std::vector<uint8_t>& data,
+        ColumnCodecState* columnState = nullptr
     ) const {
         Result<std::vector<uint8_t>> result; 
         std::vector<uint8_t> current = data;
+        if (columnState != nullptr) 
+        {
+            columnState->resize(pipeline.size());
+        }
 
-        for (CompressionType type : pipeline) 
+        for (size_t step = pipeline.size(); step-- > 0;) 
         {
+            CompressionType type = pipeline[step];
             std::vector<uint8_t> compressed;
             if (type == CompressionType::CUSTOM) 
             {
@@ -160,11 +238,15 @@ class DecompressionPipeline
             } 
             else 
             {
-                compressed = performDecompression(type, current);
-            }
-            if (compressed.size() >= current.size()*2) 
-            {
-                result.addWarning("Custom compression " + compressionTypeToString(type) + " did not reduce size, skipping.");
+                try 
+                {
+                    compressed = performDecompression(type, current, columnState != nullptr ? &(*columnState)[step] : nullptr);
+                }
+                catch (const std::exception& e) 
+                {
+                    result.setError(compressionTypeToString(type) + ": " + e.what());
+                    return result; 
+                }
             }
             current = compressed;
         }
@@ -173,11 +255,32 @@ class DecompressionPipeline
         return result;
     }
 
+    // a page of an int column: decompressed, then decoded with the encoding
+    Result<std::vector<int64_t>> decompressIntPage(
+        const std::vector<uint8_t>& data,
+        ColumnCodecState* columnState = nullptr
+    ) const {
+        Result<std::vector<uint8_t>> page = decompress(data, columnState);
+        if (!page.success()) 
+        {
+            return makeError<std::vector<int64_t>>(page.getError());
+        }
+        try 
+        {
+            return decodeIntPage(page.getValue(), encoding);
+        }
+        catch (const std::exception& e) 
+        {
+            return makeError<std::vector<int64_t>>(std::string("decodeIntPage: ") + e.what());
+        }
+    }
+
     class Builder 
     {
       private:
         std::vector<CompressionType> steps;
         std::vector<std::function<std::vector<uint8_t>(const std::vector<uint8_t>&)>> customFunctions;
+        EncodingType encoding = EncodingType::PLAIN;
 
       public:
         Builder& addStep(CompressionType type) {
@@ -185,11 +288,24 @@ class DecompressionPipeline
             return *this;
         }
 
+        // an encoding name ("delta_binary_packed") sets the encoding instead
         Builder& addStep(const std::string& typeString) {
+            std::string name = typeString;
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            auto it = encodingAliases.find(name);
+            if (it != encodingAliases.end()) 
+            {
+                return setEncoding(it->second);
+            }
             steps.push_back(stringToCompressionType(typeString));
             return *this;
         }
 
+        Builder& setEncoding(EncodingType type) {
+            encoding = type;
+            return *this;
+        }
+
         Builder& addStep(std::function<std::vector<uint8_t>(
             const std::vector<uint8_t>&)> customFunction
         ) {
@@ -198,8 +314,8 @@ class DecompressionPipeline
             return *this;
         }
 
-        CompressionPipeline build() {
-            return CompressionPipeline(steps, customFunctions);
+        DecompressionPipeline build() {
+            return DecompressionPipeline(steps, customFunctions, encoding);
         }
     };
 };
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <string>
 #include <unistd.h>
+#include <filesystem>
 #include <fstream> 
 #include <unordered_map>
 
@@ -28,7 +29,8 @@ void handleCsvColumnWithCompression(
         {
             encodedData = encodeIntColumn(
                 data, 
-                metadata
+                metadata, 
+                pipeline.getEncoding()
             );
         } 
         else if constexpr (std::is_same_v<T, std::vector<double>>) 
@@ -52,10 +54,12 @@ void handleCsvColumnWithCompression(
         }
     }, *columnData);
 
+    ColumnCodecState columnState;
     for (size_t i = 0; i < encodedData.size(); ++i)
     {
         Result<std::vector<uint8_t>> compressedData = pipeline.compress(
-            encodedData[i]
+            encodedData[i], 
+            &columnState
         );
         if (!compressedData.success()) 
         {
@@ -79,30 +83,44 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
     bool disableRLE,
     bool disableCsvHandling, 
     bool forceReload, 
-    bool verbose
+    bool verbose, 
+    LoadProgress *progress
 ) {
     Result<WisentRootExpression*> result; 
 
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(filename);
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetPublishedMemorySegment(filename);
     if (!forceReload && sharedMemory->exists() && !sharedMemory->isLoaded()) 
     {
         sharedMemory->load();
     }
-    if (sharedMemory->isLoaded()) 
+    static Metrics::Counter &cacheHits = Metrics::getCounter(
+        "wisent_load_cache_hits_total", 
+        "Loads answered by the already loaded segment", 
+        {{"loader", "compressor"}}
+    );
+    static Metrics::Counter &builds = Metrics::getCounter(
+        "wisent_load_builds_total", 
+        "Loads that parsed the source files", 
+        {{"loader", "compressor"}}
+    );
+    if (sharedMemory->isLoaded() && !forceReload) 
     {
-        if (!forceReload) 
-        {
-            WisentRootExpression *loadedValue = reinterpret_cast<WisentRootExpression *>(
-                sharedMemory->getBaseAddress()
-            );
-            result.setValue(loadedValue);
-            return result;
-        }
-        sharedMemory->erase();
-        SharedMemorySegments::getSharedMemorySegments().erase(filename);
-        sharedMemory = SharedMemorySegments::createOrGetMemorySegment(filename);
+        cacheHits.add();
+        WisentRootExpression *loadedValue = reinterpret_cast<WisentRootExpression *>(
+            sharedMemory->getBaseAddress()
+        );
+        result.setValue(loadedValue);
+        return result;
+    }
+    // built aside as the next generation and published once complete (see 
+    // SegmentDirectory.cpp), readers keep the current one until it is switched
+    bool published = sharedMemory->exists();
+    sharedMemory.release();
+    if (!published) 
+    {
+        // only registered by the lookup above: don't keep it if the build fails
+        SharedMemorySegments::eraseMemorySegment(filename);
     }
-    SharedMemorySegments::setCurrentSharedMemory(sharedMemory);
 
     std::ifstream ifs(filepath);
     if (!ifs.good()) 
@@ -111,6 +129,9 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
         result.setError(errorMessage);
         return result;
     }
+    std::error_code fileSizeError;
+    size_t fileSize = std::filesystem::file_size(filepath, fileSizeError);
+    LoadProgressReporter progressReporter(progress, ifs, fileSizeError ? 0 : fileSize);
 
     // compress columns
     // count & calculate the total size needed
@@ -118,6 +139,7 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
     std::vector<uint64_t> argumentCountPerLayer;
     argumentCountPerLayer.reserve(16);
     std::unordered_map<std::string, ColumnMetaData> processedColumns; 
+    progressReporter.startTraversal(LoadPhase::Counting);
     json _ = json::parse(
         ifs, 
         [                   // lambda captures
@@ -127,6 +149,7 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
             &argumentCountPerLayer, 
             &compressionPipelineMap,
             &processedColumns, 
+            &progressReporter, 
             layerIndex = uint64_t{0},
             wasKeyValue = std::vector<bool>(16), 
             result,
@@ -136,6 +159,11 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
             json::parse_event_t event, 
             json &parsed
         ) mutable {
+            if (progressReporter.isCancelled()) 
+            {
+                return false;   // skips the rest, the load is abandoned below
+            }
+            progressReporter.onParseEvent();
             if (wasKeyValue.size() <= depth) 
             {
                 wasKeyValue.resize(wasKeyValue.size() * 2, false);
@@ -182,20 +210,24 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
                             {
                                 std::cout << "Handling csv file: " << filename << std::endl;
                             }
+                            progressReporter.startCsvFile();
+                            PhaseTimer csvParseTimer(progressReporter.getProfile(), "csv parse");
                             rapidcsv::Document doc = openCsvFile(csvPrefix + filename);
+                            csvParseTimer.stop();
                             size_t rows = doc.GetRowCount();
                             size_t cols = doc.GetColumnCount();
 
-                            expressionCount++; // Table expression
-                            argumentCountPerLayer[layerIndex + 1] += cols; // Columns layer
-                            expressionCount += cols;
-
+                            // the layers exist before they are counted into
                             const size_t NumTableLayers = 2; // ColumnName & Data
                             if (argumentCountPerLayer.size() <= layerIndex + NumTableLayers) 
                             {
                                 argumentCountPerLayer.resize(layerIndex + NumTableLayers + 1, 0);
                             }
 
+                            expressionCount++; // Table expression
+                            argumentCountPerLayer[layerIndex + 1] += cols; // Columns layer
+                            expressionCount += cols;
+
                             size_t matchedColumns = 0;
                             for (size_t col = 0; col < cols; ++col) 
                             {
@@ -212,6 +244,8 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
                                     CompressionPipeline pipeline = compressionPipelineMap[columnName]; 
 
                                     ColumnMetaData columnMetaData; 
+                                    progressReporter.startCompressing();
+                                    PhaseTimer compressTimer(progressReporter.getProfile(), "compress " + columnName);
                                     handleCsvColumnWithCompression(
                                         doc, 
                                         columnName, 
@@ -219,6 +253,7 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
                                         columnMetaData, 
                                         result
                                     ); 
+                                    compressTimer.stop();
                                     if (verbose) 
                                     {
                                         std::cout << "Handling column: " << columnName << std::endl;
@@ -257,6 +292,7 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
                                 // else: no compression found for this column, simply add flat data
                                 argumentCountPerLayer[layerIndex + 2] += rows; 
                             }
+                            progressReporter.finishCsvFile(csvPrefix + filename, rows);
                         }
                     }
                     if (wasKeyValue[depth]) 
@@ -278,21 +314,53 @@ Result<WisentRootExpression*> wisent::compressor::CompressAndLoadJson(
         return result; 
     }
 
+    progressReporter.finishTraversal(fileSize);
+    if (progressReporter.isCancelled()) 
+    {
+        result.setError("load cancelled: " + filename);
+        return result;
+    }
+
+    sharedMemory = SharedMemorySegments::createStagingMemorySegment(filename);
+
     JsonToWisent jsonToWisent(
         expressionCount,
         std::move(argumentCountPerLayer),
-        sharedMemory,
+        sharedMemory.get(),
         csvPrefix,
         disableRLE,
         disableCsvHandling,
         processedColumns
     );
+    jsonToWisent.setProgressReporter(&progressReporter);
 
     // 2nd traversal: parse and populate 
+    progressReporter.startTraversal(LoadPhase::Building);
     ifs.seekg(0);
     json::sax_parse(ifs, &jsonToWisent);
     ifs.close();
+    jsonToWisent.recordProfile();
+    progressReporter.finishTraversal(fileSize);
 
+    if (progressReporter.isCancelled()) 
+    {
+        sharedMemory.release();
+        SharedMemorySegments::discardUnpublishedMemorySegment(filename);
+        result.setError("load cancelled: " + filename);
+        return result;
+    }
+    if (!SharedMemorySegments::publishMemorySegment(filename)) 
+    {
+        result.setError("failed to publish: " + filename);
+        return result;
+    }
+    builds.add();
+    static Metrics::Counter &ingestedJsonBytes = Metrics::getCounter(
+        "wisent_ingested_bytes_total", 
+        "Bytes of source files built into datasets", 
+        {{"format", "json"}}
+    );
+    ingestedJsonBytes.add(fileSizeError ? 0 : fileSize);
     result.setValue(jsonToWisent.getRoot());
     return result; 
 }
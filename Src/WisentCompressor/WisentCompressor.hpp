@@ -2,6 +2,7 @@
 #include <string>
 #include <unordered_map>
 #include "../Helpers/Result.hpp"
+#include "../Helpers/LoadProgress.hpp"
 #include "../Helpers/WisentHelpers/WisentHelpers.hpp"
 #include "CompressionPipeline.hpp"
 
@@ -17,7 +18,8 @@ namespace wisent
             bool disableRLE = false,
             bool disableCsvHandling = false, 
             bool forceReload = false, 
-            bool verbose = false
+            bool verbose = false, 
+            LoadProgress *progress = nullptr    // optional: progress reporting & cancellation
         ); 
     }
 }
@@ -16,7 +16,7 @@ wisent::serializer::load(
 ) {
     Result<boss::serialization::SerializedBossExpression<Allocate, Reallocate, Free>*> result;
     
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
     if (!forceReload && sharedMemory->exists() && !sharedMemory->isLoaded()) 
     {
         sharedMemory->load();
@@ -31,10 +31,11 @@ wisent::serializer::load(
             result.setValue(loadedValue);
             return result;
         }
-        sharedMemory->erase();
-        SharedMemorySegments::getSharedMemorySegments().erase(sharedMemoryName);
+        sharedMemory.release();
+        SharedMemorySegments::eraseMemorySegment(sharedMemoryName);
+        sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
     }
-    SharedMemorySegments::setCurrentSharedMemory(sharedMemory);
+    SharedMemorySegments::setCurrentSharedMemory(sharedMemory.get());
 
     using SerializedBossExpression = boss::serialization::SerializedBossExpression<
         SharedMemorySegments::sharedMemoryMalloc, 
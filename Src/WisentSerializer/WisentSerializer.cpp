@@ -1,9 +1,16 @@
 #include "WisentSerializer.hpp"
 #include "../Helpers/WisentHelpers/JsonToWisent.hpp"
+#include "../Helpers/WisentHelpers/WisentFile.hpp"
 #include <cstdint>
 #include <string>
 #include <cassert>
 #include <vector>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
 
 Result<WisentRootExpression*> wisent::serializer::load(
     std::string const &filepath,
@@ -11,30 +18,45 @@ Result<WisentRootExpression*> wisent::serializer::load(
     std::string const &csvPrefix, 
     bool disableRLE,
     bool disableCsvHandling, 
-    bool forceReload
+    bool forceReload, 
+    LoadProgress *progress
 ) {
     Result<WisentRootExpression*> result; 
 
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetPublishedMemorySegment(sharedMemoryName);
     if (!forceReload && sharedMemory->exists() && !sharedMemory->isLoaded()) 
     {
         sharedMemory->load();
     }
-    if (sharedMemory->isLoaded()) 
+    static Metrics::Counter &cacheHits = Metrics::getCounter(
+        "wisent_load_cache_hits_total", 
+        "Loads answered by the already loaded segment", 
+        {{"loader", "wisent"}}
+    );
+    static Metrics::Counter &builds = Metrics::getCounter(
+        "wisent_load_builds_total", 
+        "Loads that parsed the source files", 
+        {{"loader", "wisent"}}
+    );
+    if (sharedMemory->isLoaded() && !forceReload) 
     {
-        if (!forceReload) 
-        {
-            result.setValue(
-                reinterpret_cast<WisentRootExpression *>(
-                    sharedMemory->getBaseAddress()
-                )
-            );
-            return result; 
-        }
-        free(sharedMemoryName);
-        sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+        cacheHits.add();
+        result.setValue(
+            reinterpret_cast<WisentRootExpression *>(
+                sharedMemory->getBaseAddress()
+            )
+        );
+        return result; 
+    }
+    // built aside as the next generation and published once complete (see 
+    // SegmentDirectory.cpp), readers keep the current one until it is switched
+    bool published = sharedMemory->exists();
+    sharedMemory.release();
+    if (!published) 
+    {
+        // only registered by the lookup above: don't keep it if the build fails
+        SharedMemorySegments::eraseMemorySegment(sharedMemoryName);
     }
-    SharedMemorySegments::setCurrentSharedMemory(sharedMemory);
 
     std::ifstream ifs(filepath);
     if (!ifs.good()) 
@@ -43,8 +65,12 @@ Result<WisentRootExpression*> wisent::serializer::load(
         result.setError(errorMessage);
         return result;
     }
+    std::error_code fileSizeError;
+    size_t fileSize = std::filesystem::file_size(filepath, fileSizeError);
+    LoadProgressReporter progressReporter(progress, ifs, fileSizeError ? 0 : fileSize);
 
     // 1st traversal: count & calculate the total size needed
+    progressReporter.startTraversal(LoadPhase::Counting);
     uint64_t expressionCount = 0;
     std::vector<uint64_t> argumentCountPerLayer;
     argumentCountPerLayer.reserve(16);
@@ -55,6 +81,7 @@ Result<WisentRootExpression*> wisent::serializer::load(
             &disableCsvHandling, 
             &expressionCount,
             &argumentCountPerLayer, 
+            &progressReporter, 
             layerIndex = uint64_t{0},
             wasKeyValue = std::vector<bool>(16)
         ](                  // lambda params
@@ -62,6 +89,11 @@ Result<WisentRootExpression*> wisent::serializer::load(
             json::parse_event_t event, 
             json &parsed
         ) mutable {
+            if (progressReporter.isCancelled()) 
+            {
+                return false;   // skips the rest, the load is abandoned below
+            }
+            progressReporter.onParseEvent();
             if (wasKeyValue.size() <= depth) 
             {
                 wasKeyValue.resize(wasKeyValue.size() * 2, false);
@@ -107,9 +139,13 @@ Result<WisentRootExpression*> wisent::serializer::load(
                         filename.substr(extPos) == ".csv") 
                     {
                         // std::cout << "Handling csv file: " << filename << std::endl;
+                        progressReporter.startCsvFile();
+                        PhaseTimer csvParseTimer(progressReporter.getProfile(), "csv parse");
                         auto doc = openCsvFile(csvPrefix + filename);
+                        csvParseTimer.stop();
                         auto rows = doc.GetRowCount();
                         auto cols = doc.GetColumnCount();
+                        progressReporter.finishCsvFile(csvPrefix + filename, rows);
                         static const size_t numTableLayers = 2; // Column/Data
                         if (argumentCountPerLayer.size() <= layerIndex + numTableLayers) 
                         {
@@ -132,29 +168,61 @@ Result<WisentRootExpression*> wisent::serializer::load(
         }
     );
 
+    progressReporter.finishTraversal(fileSize);
+    if (progressReporter.isCancelled()) 
+    {
+        result.setError("load cancelled: " + sharedMemoryName);
+        return result;
+    }
+
+    sharedMemory = SharedMemorySegments::createStagingMemorySegment(sharedMemoryName);
+
     // initialise Wisent expression tree
     JsonToWisent jsonToWisent(
         expressionCount,
         std::move(argumentCountPerLayer),
-        sharedMemory,
+        sharedMemory.get(),
         csvPrefix,
         disableRLE,
         disableCsvHandling
     );
+    jsonToWisent.setProgressReporter(&progressReporter);
 
     // 2nd traversal: parse and populate 
+    progressReporter.startTraversal(LoadPhase::Building);
     ifs.seekg(0);
     json::sax_parse(ifs, &jsonToWisent);
     ifs.close();
+    jsonToWisent.recordProfile();
+    progressReporter.finishTraversal(fileSize);
 
+    if (progressReporter.isCancelled()) 
+    {
+        sharedMemory.release();
+        SharedMemorySegments::discardUnpublishedMemorySegment(sharedMemoryName);
+        result.setError("load cancelled: " + sharedMemoryName);
+        return result;
+    }
+    if (!SharedMemorySegments::publishMemorySegment(sharedMemoryName)) 
+    {
+        result.setError("failed to publish: " + sharedMemoryName);
+        return result;
+    }
     // std::cout << "loaded: " << filepath << std::endl;
+    builds.add();
+    static Metrics::Counter &ingestedJsonBytes = Metrics::getCounter(
+        "wisent_ingested_bytes_total", 
+        "Bytes of source files built into datasets", 
+        {{"format", "json"}}
+    );
+    ingestedJsonBytes.add(fileSizeError ? 0 : fileSize);
     result.setValue(jsonToWisent.getRoot());
     return result; 
 }
 
 void wisent::serializer::unload (std::string const &sharedMemoryName)
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetPublishedMemorySegment(sharedMemoryName);
     if (!sharedMemory->isLoaded()) 
     {
         std::cerr << "Error: Shared memory segment is not loaded." << std::endl;
@@ -166,8 +234,139 @@ void wisent::serializer::unload (std::string const &sharedMemoryName)
 
 void wisent::serializer::free(std::string const &sharedMemoryName)
 {
-    ISharedMemorySegment *sharedMemory = SharedMemorySegments::createOrGetMemorySegment(sharedMemoryName);
-    sharedMemory->erase();
-    SharedMemorySegments::getSharedMemorySegments().erase(sharedMemoryName);
+    SharedMemorySegments::createOrGetPublishedMemorySegment(sharedMemoryName);
+    if (!SharedMemorySegments::eraseMemorySegment(sharedMemoryName)) 
+    {
+        std::cerr << "Error: Shared memory segment is still referenced." << std::endl;
+        return;
+    }
+    SharedMemorySegments::freePublishedMemorySegments(sharedMemoryName);
     // std::cout << "Shared memory segment erased from list." << std::endl;
 }
+
+// flushes a written file, or a directory's entries, to the disk
+static bool syncToDisk(std::string const &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) 
+    {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+std::string wisent::serializer::getPersistedFilePath(
+    std::string const &sharedMemoryName,
+    std::string const &folderPath
+) {
+    return (std::filesystem::path(folderPath) / (sharedMemoryName + WisentFile_EXTENSION)).string();
+}
+
+Result<std::string> wisent::serializer::persist(
+    std::string const &sharedMemoryName,
+    std::string const &folderPath
+) {
+    Result<std::string> result;
+
+    // held while writing, so the segment cannot be erased underneath; looked up only,
+    // so an unknown name leaves nothing behind
+    SharedMemorySegments::SegmentHandle handle = SharedMemorySegments::findMemorySegment(sharedMemoryName);
+    ISharedMemorySegment *sharedMemory = handle.get();
+    if (sharedMemory == nullptr) 
+    {
+        result.setError("Shared memory segment not found: " + sharedMemoryName);
+        return result;
+    }
+    if (sharedMemory->exists() && !sharedMemory->isLoaded()) 
+    {
+        sharedMemory->load();
+    }
+    if (!sharedMemory->isLoaded()) 
+    {
+        result.setError("Shared memory segment is not loaded: " + sharedMemoryName);
+        return result;
+    }
+
+    char const *payload = reinterpret_cast<char const *>(sharedMemory->getBaseAddress());
+    size_t payloadBytes = sharedMemory->getSize();
+    WisentFileHeader header = makeWisentFileHeader(payloadBytes);
+
+    // originalAddress is the only absolute pointer in the tree: 
+    // it is meaningless once mapped from a file, so store it as nullptr
+    std::vector<char> rootHeader(payload, payload + sizeof(WisentRootExpression));
+    *reinterpret_cast<void **>(&rootHeader[offsetof(WisentRootExpression, originalAddress)]) = nullptr;
+
+    std::filesystem::create_directories(folderPath);
+    std::string filePath = getPersistedFilePath(sharedMemoryName, folderPath);
+    std::string temporaryFilePath = filePath + ".tmp";
+    {
+        std::ofstream outFile(temporaryFilePath, std::ios::binary | std::ios::trunc);
+        outFile.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        outFile.write(rootHeader.data(), rootHeader.size());
+        outFile.write(payload + sizeof(WisentRootExpression), payloadBytes - sizeof(WisentRootExpression));
+        if (!outFile.good()) 
+        {
+            std::filesystem::remove(temporaryFilePath);
+            result.setError("failed to write: " + temporaryFilePath);
+            return result;
+        }
+    }
+
+    // the data is on disk before the rename, so a crash cannot leave a truncated file in place
+    if (!syncToDisk(temporaryFilePath)) 
+    {
+        std::filesystem::remove(temporaryFilePath);
+        result.setError("failed to sync: " + temporaryFilePath);
+        return result;
+    }
+
+    // readers either see the previous file or the complete new one
+    if (std::rename(temporaryFilePath.c_str(), filePath.c_str()) != 0) 
+    {
+        std::filesystem::remove(temporaryFilePath);
+        result.setError("failed to rename: " + temporaryFilePath);
+        return result;
+    }
+    // and the rename itself survives a crash
+    if (!syncToDisk(folderPath)) 
+    {
+        result.addWarning("failed to sync the directory: " + folderPath);
+    }
+    result.setValue(filePath);
+    return result;
+}
+
+Result<WisentRootExpression*> wisent::serializer::loadPersisted(
+    std::string const &filePath,
+    std::string const &sharedMemoryName
+) {
+    Result<WisentRootExpression*> result;
+
+    SharedMemorySegments::SegmentHandle sharedMemory = SharedMemorySegments::createOrGetFileMemorySegment(
+        sharedMemoryName, 
+        filePath
+    );
+    if (!sharedMemory->isLoaded()) 
+    {
+        if (!sharedMemory->exists()) 
+        {
+            result.setError("failed to read: " + filePath);
+            return result;
+        }
+        sharedMemory->load();
+    }
+    if (!sharedMemory->isLoaded()) 
+    {
+        result.setError("invalid Wisent file: " + filePath);
+        return result;
+    }
+
+    result.setValue(
+        reinterpret_cast<WisentRootExpression *>(
+            sharedMemory->getBaseAddress()
+        )
+    );
+    return result;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "../Helpers/WisentHelpers/WisentHelpers.hpp"
 #include "../Helpers/Result.hpp"
+#include "../Helpers/LoadProgress.hpp"
 #include <string>
 #include <cassert>
 #include <sys/resource.h>
@@ -15,7 +16,8 @@ namespace wisent
             std::string const& csvPrefix, 
             bool disableRLE = false,
             bool disableCsvHandling = false, 
-            bool forceReload = false
+            bool forceReload = false, 
+            LoadProgress *progress = nullptr    // optional: progress reporting & cancellation
         );
 
         void unload(
@@ -25,5 +27,23 @@ namespace wisent
         void free(
             std::string const& sharedMemoryName
         );
+
+        // writes a loaded segment to <folderPath>/<sharedMemoryName>.wisent,
+        // returns the path of the written file
+        Result<std::string> persist(
+            std::string const& sharedMemoryName,
+            std::string const& folderPath
+        );
+
+        // maps a file written by persist() (no parsing involved)
+        Result<WisentRootExpression*> loadPersisted(
+            std::string const& filePath,
+            std::string const& sharedMemoryName
+        );
+
+        std::string getPersistedFilePath(
+            std::string const& sharedMemoryName,
+            std::string const& folderPath
+        );
     }
 }
@@ -6,14 +6,162 @@
 #include "WisentCompressor/CompressionPipeline.hpp"
 #include "WisentCompressor/WisentCompressor.hpp"
 #include "ServerHelpers.hpp"
+#include "Helpers/ServerHelpers/FdPassingServer.hpp"
+#include "Helpers/Metrics.hpp"
+#include "Helpers/ServerHelpers/LoadJobs.hpp"
+#include "Helpers/ServerHelpers/Preloader.hpp"
+#include "Helpers/ServerHelpers/SegmentStream.hpp"
+#include "Helpers/ServerHelpers/SingleFlight.hpp"
+#include "Helpers/ServerHelpers/TableQuery.hpp"
+#include "Helpers/ServerHelpers/WorkerPool.hpp"
 #include <chrono>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <string>
+#include <unistd.h>
+#include <vector>
+
+using LoadFunction = std::function<Result<WisentRootExpression*>(LoadProgress *progress)>;
 
 int main(int argc, char **argv)
 {
-    int httpPort = 8000;
+    ServerConfig config = parseServerArguments(argc, argv);
+    if (config.segmentBackend == "memfd") 
+    {
+        SharedMemorySegments::setMemorySegmentFactory(SharedMemorySegments::makeMemfdMemorySegment);
+    }
+    FdPassingServer fdPassingServer;
+    if (!config.fdSocketPath.empty() && !fdPassingServer.start(config.fdSocketPath)) 
+    {
+        return 1;
+    }
+    DatasetCache datasetCache(config.memoryBudgetBytes, config.persistDirectory);
+    // builds run here, the HTTP threads only wait for them
+    WorkerPool workerPool(config.workerCount);
+    // concurrent requests for the same dataset share one build
+    SingleFlight<Result<WisentRootExpression*>> loadFlights;
+    LoadJobs loadJobs(256, config.maxJobs);
+
+    /*
+     * Shared by the blocking requests and the async jobs. A request joining a
+     * build already in flight gets its result, but not its progress: only the
+     * job that started the build reports progress and can cancel it.
+     */
+    auto runLoad = [&](
+        std::string const &filename, 
+        LoadFunction const &loadFunction, 
+        LoadProgress *progress
+    ) {
+        DatasetCache::Lease lease = datasetCache.lease(filename);
+        Result<WisentRootExpression*> result = loadFlights.run(filename, [&]() {
+            return workerPool.submit([&]() {
+                if (progress != nullptr && progress->isCancelRequested()) 
+                {
+                    return makeError<WisentRootExpression*>("load cancelled: " + filename);
+                }
+                return loadFunction(progress);
+            }).get();
+        });
+        sealForConsumers(config, filename, result);
+        admitToDatasetCache(datasetCache, filename, result);
+        return result;
+    };
+
+    auto respondWithLoad = [&](
+        const httplib::Request &req, 
+        httplib::Response &res, 
+        std::string const &filename, 
+        LoadFunction loadFunction
+    ) {
+        if (isAsyncRequest(req.params)) 
+        {
+            uint64_t id = loadJobs.start(filename, [runLoad, filename, loadFunction](LoadProgress &progress) {
+                return runLoad(filename, loadFunction, &progress);
+            });
+            if (id == 0) 
+            {
+                res.status = httplib::ServiceUnavailable_503; 
+                res.set_content("Error: too many jobs running", "text/plain");
+                return;
+            }
+            res.status = httplib::Accepted_202;
+            res.set_content(loadJobs.getStatus(id), "application/json");
+            return;
+        }
+        LoadProgress progress;
+        progress.start();
+        const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        Result<WisentRootExpression*> loadResult = runLoad(filename, loadFunction, &progress);
+        const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+        handleLoadResponse(
+            res, 
+            loadResult, 
+            start, 
+            end, 
+            progress.getProfile()
+        );
+    };
+
+    // a dataset of the startup manifest or of a /batch request; holds runLoad by
+    // value as the jobs it is handed to may outlive it
+    auto loadEntry = [runLoad, &config](PreloadEntry const &entry, LoadProgress &progress) {
+        std::string csvPrefix = entry.path.substr(0, entry.path.find_last_of("/\\") + 1);
+        if (entry.loader == "serialize") 
+        {
+            return runLoad(entry.name, [&](LoadProgress *progress) {
+                return loadOrRestorePersisted(config, entry.name, entry.path, false, [&]() {
+                    return wisent::serializer::load(
+                        entry.path, 
+                        entry.name, 
+                        csvPrefix, 
+                        entry.disableRLE,
+                        entry.disableCsvHandling, 
+                        false, 
+                        progress
+                    );
+                });
+            }, &progress);
+        }
+        Result<std::unordered_map<std::string, CompressionPipeline>> pipelines;
+        parseCompressionPipeline(entry.pipeline.dump(), pipelines);
+        if (!pipelines.success()) 
+        {
+            return makeError<WisentRootExpression*>(pipelines.getError());
+        }
+        return runLoad(entry.name, [&](LoadProgress *progress) {
+            return loadOrRestorePersisted(config, entry.name, entry.path, false, [&]() {
+                return wisent::compressor::CompressAndLoadJson(
+                    entry.path, 
+                    entry.name, 
+                    csvPrefix, 
+                    *pipelines.value, 
+                    entry.disableRLE,
+                    entry.disableCsvHandling, 
+                    false, 
+                    false, 
+                    progress
+                );
+            });
+        }, &progress);
+    };
+
+    Preloader preloader;
+    PreloadManifest manifest;
+    if (!config.manifestPath.empty()) 
+    {
+        Result<PreloadManifest> manifestResult = PreloadManifest::read(config.manifestPath);
+        if (!manifestResult.success()) 
+        {
+            std::cerr << "Error: " << manifestResult.getError() << std::endl;
+            return 1;
+        }
+        manifest = manifestResult.getValue();
+    }
+
     httplib::Server svr;
+    instrumentServer(svr, datasetCache);
     svr.Get("/serialize", [&](const httplib::Request &req, httplib::Response &res) 
     {
         std::string filename;
@@ -21,31 +169,36 @@ int main(int argc, char **argv)
         std::string csvPrefix;
         bool disableRLE = false;
         bool disableCsvHandling = false;
+        bool forceReload = false;
         parseRequestParams(
             req.params, 
             filename, 
             filepath, 
             csvPrefix,
             disableRLE, 
-            disableCsvHandling
+            disableCsvHandling, 
+            forceReload
         );
 
-        const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
-        Result<WisentRootExpression*> serializeResult = wisent::serializer::load(
-            filepath, 
-            filename, 
-            csvPrefix, 
-            disableRLE,
-            disableCsvHandling
-        );
-        const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
-
-        handleResponse(
-            res, 
-            serializeResult, 
-            start, 
-            end
-        );
+        respondWithLoad(req, res, filename, [=, &config](LoadProgress *progress) {
+            return loadOrRestorePersisted(
+                config, 
+                filename, 
+                filepath, 
+                forceReload, 
+                [&]() {
+                    return wisent::serializer::load(
+                        filepath, 
+                        filename, 
+                        csvPrefix, 
+                        disableRLE,
+                        disableCsvHandling, 
+                        forceReload, 
+                        progress
+                    );
+                }
+            );
+        });
         return;
     });
 
@@ -56,13 +209,15 @@ int main(int argc, char **argv)
         std::string csvPrefix; 
         bool disableRLE = false;
         bool disableCsvHandling = false;
+        bool forceReload = false;
         parseRequestParams(
             req.params, 
             filename, 
             filepath, 
             csvPrefix,
             disableRLE, 
-            disableCsvHandling
+            disableCsvHandling, 
+            forceReload
         );
 
         Result<std::unordered_map<std::string, CompressionPipeline>> CompressionPipelineMapResult; 
@@ -77,23 +232,28 @@ int main(int argc, char **argv)
             return;
         }
         
-        const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
-        Result<WisentRootExpression*> compressResult = wisent::compressor::CompressAndLoadJson(
-            filename, 
-            filepath, 
-            csvPrefix, 
-            CompressionPipelineMapResult.value.value(), 
-            disableRLE,
-            disableCsvHandling
-        );
-        const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
-
-        handleResponse(
-            res, 
-            compressResult, 
-            start, 
-            end
-        );
+        std::unordered_map<std::string, CompressionPipeline> compressionPipelineMap = CompressionPipelineMapResult.value.value();
+        respondWithLoad(req, res, filename, [=, &config](LoadProgress *progress) mutable {
+            return loadOrRestorePersisted(
+                config, 
+                filename, 
+                filepath, 
+                forceReload, 
+                [&]() {
+                    return wisent::compressor::CompressAndLoadJson(
+                        filepath, 
+                        filename, 
+                        csvPrefix, 
+                        compressionPipelineMap, 
+                        disableRLE,
+                        disableCsvHandling, 
+                        forceReload, 
+                        false, 
+                        progress
+                    );
+                }
+            );
+        });
         return;
     });
 
@@ -104,41 +264,328 @@ int main(int argc, char **argv)
         std::string csvPrefix;
         bool disableRLE = false;
         bool disableCsvHandling = false;
+        bool forceReload = false;
         parseRequestParams(
             req.params, 
             filename, 
             filepath, 
             csvPrefix,
             disableRLE, 
-            disableCsvHandling
+            disableCsvHandling, 
+            forceReload
         );
 
+        respondWithLoad(req, res, filename, [=](LoadProgress *progress) {
+            return wisent::serializer::load(
+                filepath, 
+                filename, 
+                csvPrefix, 
+                disableRLE,
+                disableCsvHandling, 
+                forceReload, 
+                progress
+            );
+        });
+        return;
+    });
+
+    /*
+     * Many datasets in one call, the body lists them as the startup manifest
+     * does (see Preloader.hpp). Up to "parallelism" of them are built side by
+     * side on the WorkerPool, the others wait and start by descending priority
+     * (see BatchTurns). Each dataset becomes a job of its own; with async=true
+     * their ids are returned right away, otherwise the call waits for all of
+     * them. A batch that would exceed --max-jobs is refused with 503.
+     */
+    svr.Post("/batch", [&](const httplib::Request &req, httplib::Response &res) 
+    {
+        Result<PreloadManifest> batch = PreloadManifest::parse(req.body);
+        if (!batch.success()) 
+        {
+            res.status = httplib::BadRequest_400; 
+            res.set_content("Error: " + batch.getError(), "text/plain");
+            return;
+        }
+        std::vector<PreloadEntry> const &entries = batch.value->datasets;
+        if (entries.size() > config.maxBatchSize) 
+        {
+            res.status = httplib::PayloadTooLarge_413; 
+            res.set_content("Error: more than " + std::to_string(config.maxBatchSize) + " datasets in one batch", "text/plain");
+            return;
+        }
+        std::shared_ptr<BatchTurns> turns = std::make_shared<BatchTurns>(batch.value->parallelism, entries.size());
+        auto loadInTurn = [loadEntry, turns](PreloadEntry const &entry, size_t index) {
+            return [loadEntry, turns, entry, index](LoadProgress &progress) -> Result<WisentRootExpression*> {
+                if (!turns->waitForTurn(index, progress)) 
+                {
+                    return makeError<WisentRootExpression*>("load cancelled: " + entry.name);
+                }
+                Result<WisentRootExpression*> result;
+                try 
+                {
+                    result = loadEntry(entry, progress);
+                }
+                catch (...) 
+                {
+                    turns->finish();
+                    throw;
+                }
+                turns->finish();
+                return result;
+            };
+        };
+        if (isAsyncRequest(req.params)) 
+        {
+            nlohmann::json jobIds = nlohmann::json::array();
+            for (size_t index = 0; index < entries.size(); index++) 
+            {
+                uint64_t id = loadJobs.start(entries[index].name, loadInTurn(entries[index], index));
+                if (id == 0) 
+                {
+                    // the batch is refused as a whole: the jobs started so far end waiting
+                    turns->cancel();
+                    res.status = httplib::ServiceUnavailable_503; 
+                    res.set_content("Error: too many jobs running", "text/plain");
+                    return;
+                }
+                jobIds.push_back(id);
+            }
+            res.status = httplib::Accepted_202;
+            res.set_content(nlohmann::json({{"jobs", jobIds}}).dump(), "application/json");
+            return;
+        }
+
         const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
-        Result<WisentRootExpression*> loadResult = wisent::serializer::load(
-            filepath, 
+        std::vector<std::shared_future<std::string>> loads;
+        for (size_t index = 0; index < entries.size(); index++) 
+        {
+            loads.push_back(loadJobs.startAndWatch(entries[index].name, loadInTurn(entries[index], index)));
+            if (!loads.back().valid()) 
+            {
+                turns->cancel();
+                res.status = httplib::ServiceUnavailable_503; 
+                res.set_content("Error: too many jobs running", "text/plain");
+                return;
+            }
+        }
+        nlohmann::json datasets = nlohmann::json::array();
+        size_t failedCount = 0;
+        for (std::shared_future<std::string> const &load : loads) 
+        {
+            nlohmann::json status = nlohmann::json::parse(load.get());
+            nlohmann::json dataset = {
+                {"name", status["name"]},
+                {"status", status.contains("error") ? "error" : "success"},
+                {"seconds", status["elapsedSeconds"]},
+                {"warnings", status["warnings"]},
+                {"profile", status["profile"]}
+            };
+            if (status.contains("error")) 
+            {
+                dataset["error"] = status["error"];
+                failedCount++;
+            }
+            datasets.push_back(dataset);
+        }
+        const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        nlohmann::json response = {
+            {"seconds", std::chrono::duration<double>(end - start).count()},
+            {"failed", failedCount},
+            {"datasets", datasets}
+        };
+        res.set_content(response.dump(), "application/json");
+    });
+
+    // status of one job (?id=), or of all known jobs
+    svr.Get("/jobs", [&](const httplib::Request &req, httplib::Response &res) 
+    {
+        if (!req.has_param("id")) 
+        {
+            res.set_content(loadJobs.getStatuses(), "application/json");
+            return;
+        }
+        std::string status = loadJobs.getStatus(std::strtoull(req.get_param_value("id").c_str(), nullptr, 10));
+        if (status.empty()) 
+        {
+            res.status = httplib::NotFound_404; 
+            res.set_content("Error: unknown job", "text/plain");
+            return;
+        }
+        res.set_content(status, "application/json");
+    });
+
+    svr.Get("/jobs/cancel", [&](const httplib::Request &req, httplib::Response &res) 
+    {
+        uint64_t id = req.has_param("id") ? std::strtoull(req.get_param_value("id").c_str(), nullptr, 10) : 0;
+        if (!loadJobs.cancel(id)) 
+        {
+            res.status = httplib::NotFound_404; 
+            res.set_content("Error: unknown job", "text/plain");
+            return;
+        }
+        res.set_content(loadJobs.getStatus(id), "application/json");
+    });
+
+    svr.Get("/persist", [&](const httplib::Request &req, httplib::Response &res) 
+    {
+        std::string filename = req.has_param("name") ? req.get_param_value("name") : "";
+        if (config.persistDirectory.empty()) 
+        {
+            res.status = httplib::BadRequest_400; 
+            res.set_content("Error: no --persist-dir configured", "text/plain");
+            return;
+        }
+        // files are only ever written to the persist directory, named after the dataset
+        if (req.has_param("path") || !isValidPersistName(filename)) 
+        {
+            res.status = httplib::BadRequest_400; 
+            res.set_content("Error: invalid dataset name or path given", "text/plain");
+            return;
+        }
+
+        const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        Result<std::string> persistResult = wisent::serializer::persist(
             filename, 
-            csvPrefix, 
-            disableRLE,
-            disableCsvHandling
+            config.persistDirectory
         );
         const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
 
         handleResponse(
             res, 
-            loadResult, 
+            persistResult, 
             start, 
             end
         );
         return;
     });
 
+    // a loaded dataset as the bytes of its .wisent file, written from the 
+    // mapping; HTTP Range requests are served, ?section= narrows the stream
+    svr.Get("/segment", [&](const httplib::Request &req, httplib::Response &res) 
+    {
+        std::string filename = req.has_param("name") ? req.get_param_value("name") : "";
+        Result<std::shared_ptr<SegmentStream>> opened = SegmentStream::open(filename);
+        if (!opened.success()) 
+        {
+            res.status = httplib::NotFound_404; 
+            res.set_content("Error: " + opened.getError(), "text/plain");
+            return;
+        }
+        std::shared_ptr<SegmentStream> stream = opened.getValue();
+        SegmentStream::ByteRange range{0, stream->getFileBytes()};
+        if (req.has_param("section")) 
+        {
+            Result<SegmentStream::ByteRange> section = stream->getSection(req.get_param_value("section"));
+            if (!section.success()) 
+            {
+                res.status = httplib::BadRequest_400; 
+                res.set_content("Error: " + section.getError(), "text/plain");
+                return;
+            }
+            range = section.getValue();
+        }
+        res.set_content_provider(
+            range.bytes, 
+            "application/octet-stream", 
+            [stream, range](size_t offset, size_t length, httplib::DataSink &sink) {
+                return stream->write(range.offset + offset, length, [&sink](char const *data, size_t bytes) {
+                    return sink.write(data, bytes);
+                });
+            }
+        );
+    });
+
+    // byte ranges of the sections and tables of /segment
+    svr.Get("/segment/layout", [&](const httplib::Request &req, httplib::Response &res) 
+    {
+        std::string filename = req.has_param("name") ? req.get_param_value("name") : "";
+        Result<std::shared_ptr<SegmentStream>> opened = SegmentStream::open(filename);
+        if (!opened.success()) 
+        {
+            res.status = httplib::NotFound_404; 
+            res.set_content("Error: " + opened.getError(), "text/plain");
+            return;
+        }
+        res.set_content(opened.getValue()->getLayout().dump(), "application/json");
+    });
+
+    // projection, filter & aggregation over a table of a loaded dataset, see TableQuery.hpp
+    svr.Post("/query", [&](const httplib::Request &req, httplib::Response &res) 
+    {
+        std::string filename = req.has_param("name") ? req.get_param_value("name") : "";
+        Result<TableQuery> query = TableQuery::parse(req.body);
+        if (!query.success()) 
+        {
+            res.status = httplib::BadRequest_400; 
+            res.set_content("Error: " + query.getError(), "text/plain");
+            return;
+        }
+        if (!SharedMemorySegments::findMemorySegment(filename)) 
+        {
+            res.status = httplib::NotFound_404; 
+            res.set_content("Error: Shared memory segment not found: " + filename, "text/plain");
+            return;
+        }
+        Result<TableQueryResult> queried = runTableQuery(filename, query.getValue());
+        if (!queried.success()) 
+        {
+            res.status = httplib::BadRequest_400; 
+            res.set_content("Error: " + queried.getError(), "text/plain");
+            return;
+        }
+        if (!query.value->aggregate.empty()) 
+        {
+            res.set_content(queried.value->aggregates.dump(), "application/json");
+            return;
+        }
+        res.set_content(std::move(queried.value->rows), "application/octet-stream");
+    });
+
+    // 200 once the manifest finished loading (or ?name= is warm), 503 until then
+    svr.Get("/ready", [&](const httplib::Request &req, httplib::Response &res) 
+    {
+        bool ready = req.has_param("name") ? preloader.isWarm(req.get_param_value("name")) : preloader.isFinished();
+        res.status = ready ? httplib::OK_200 : httplib::ServiceUnavailable_503;
+        res.set_content(preloader.getStatus().dump(), "application/json");
+    });
+
+    svr.Get("/metrics", [&](const httplib::Request & /*req*/, httplib::Response &res) 
+    {
+        res.set_content(Metrics::renderPrometheus(), "text/plain; version=0.0.4");
+    });
+
     svr.Get("/stop", [&](const httplib::Request & /*req*/, httplib::Response & /*res*/) 
     { 
         svr.stop(); 
     });
 
-    std::cout << "Server running on port " << httpPort << "..." << std::endl;
+    bool bound = config.unixSocketPath.empty() 
+        ? svr.bind_to_port(config.host, config.port) 
+        : bindUnixSocket(svr, config.unixSocketPath, config.unixSocketMode);
+    if (!bound) 
+    {
+        std::cerr << "Error: cannot listen on " 
+                  << (config.unixSocketPath.empty() ? config.host + ":" + std::to_string(config.port) : config.unixSocketPath) 
+                  << std::endl;
+        return 1;
+    }
+
+    // the manifest warms up in the background while the server answers; started
+    // after binding, as the Unix socket is bound under a narrowed umask
+    preloader.start(manifest, loadEntry);
 
-    svr.listen("0.0.0.0", httpPort);
+    if (config.unixSocketPath.empty()) 
+    {
+        std::cout << "Server running on port " << config.port << "..." << std::endl;
+    }
+    else 
+    {
+        std::cout << "Server running on " << config.unixSocketPath << "..." << std::endl;
+    }
+    svr.listen_after_bind();
+    if (!config.unixSocketPath.empty()) 
+    {
+        unlink(config.unixSocketPath.c_str());
+    }
     return 0;
 }
\ No newline at end of file